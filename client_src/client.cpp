@@ -1,54 +1,127 @@
 #include "client.h"
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
-#include <sstream>
 #include <stdexcept>
 #include <utility>
 
+#include <unistd.h>
+
 #include "../common_src/common_constants.h"
 
+#include "client_script.h"
+
 Client::Client(const std::string& hostname, const std::string& port,
-               const std::string& commands_file):
-        socket(hostname.c_str(), port.c_str()), protocol(std::move(socket)) {
-    load_and_execute_commands(commands_file);
+               const std::string& commands_file, bool report_stats):
+        out(STDOUT_FILENO),
+        socket(connect_to_server(hostname, port)),
+        protocol(std::move(socket)),
+        session_reply_pending(false),
+        batch_size(0),
+        cache_market(false),
+        validate_purchases_locally(true),
+        market_subscribed(false),
+        report_stats(report_stats) {
+    try {
+        load_and_execute_commands(commands_file);
+    } catch (const std::exception&) {
+        // Los últimos mensajes de la conexión, para ver en qué quedó
+        out.flush();
+        protocol.dump_flight_recorder(std::cerr);
+        throw;
+    }
 }
 
-void Client::load_and_execute_commands(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open commands file: " + filename);
+Socket Client::connect_to_server(const std::string& hostname, const std::string& port) {
+    if (hostname == SHM_HOSTNAME) {
+        return Socket::connect_shm(port.c_str());
     }
+    return Socket(hostname.c_str(), port.c_str());
+}
 
-    // PRIMERO: encontrar y enviar el comando username
-    std::string line;
-    bool username_sent = false;
+/*
+ * Una sola pasada sobre el script: `username` y `session` configuran el
+ * registro, que se hace antes del primer pedido. Si hay pedidos antes del
+ * `username` esperan (en orden) a que aparezca, así el resultado es el
+ * mismo esté donde esté; `session` sí debe ir antes del primer pedido.
+ * */
+void Client::load_and_execute_commands(const std::string& filename) {
+    ScriptReader script(filename);
+    auto start = std::chrono::steady_clock::now();
 
-    while (std::getline(file, line)) {
-        if (!line.empty()) {
-            std::istringstream iss(line);
-            std::string command;
-            iss >> command;
+    std::string_view command;
+    std::string_view parameter;
+    std::string username;
+    bool username_found = false;
+    bool registered = false;
+    std::vector<std::pair<std::string_view, std::string_view>> before_username;
+    size_t executed = 0;
 
-            if (command == "username") {
-                std::string username_param;
-                iss >> username_param;
+    while (script.next(command, parameter)) {
+        if (command == "username") {
+            if (!username_found) {
+                username = ScriptReader::first_word(parameter);
+                username_found = true;
+            }
+            continue;
+        }
+        if (command == "session") {
+            session_file = ScriptReader::first_word(parameter);
+            continue;
+        }
 
-                // NUEVO: Trabajar con DTOs
-                UserDto user(username_param);
-                protocol.send_user_registration(user);
-                username_sent = true;
-                break;
+        if (!username_found) {
+            before_username.emplace_back(command, parameter);
+            continue;
+        }
+        if (!registered) {
+            register_user(username);
+            registered = true;
+            for (const auto& [early_command, early_parameter]: before_username) {
+                queue_command(early_command, early_parameter);
             }
+            executed += before_username.size();
         }
+        queue_command(command, parameter);
+        executed++;
     }
 
-    if (!username_sent) {
+    if (!username_found) {
         throw std::runtime_error("No username command found in file");
     }
+    if (!registered) {
+        register_user(username);
+    }
+    flush_batch();
+
+    if (session_reply_pending) {
+        finish_session_handshake();
+    }
 
-    // SEGUNDO: recibir dinero inicial del servidor
+    if (report_stats) {
+        out.flush();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double seconds = std::max(elapsed.count(), 1e-9);
+        std::cerr << "Executed " << executed << " commands in " << seconds << " s ("
+                  << static_cast<uint64_t>(executed / seconds) << " commands/s)" << std::endl;
+    }
+}
+
+void Client::register_user(const std::string& username) {
+    if (!session_file.empty()) {
+        // Sin esperar la respuesta: se lee junto con la del primer pedido
+        start_session(username);
+        return;
+    }
+
+    // NUEVO: Trabajar con DTOs
+    UserDto user(username);
+    protocol.send_user_registration(user);
+
+    // Recibir dinero inicial del servidor
     uint8_t response = protocol.receive_command();
     if (response != SEND_INITIAL_MONEY) {
         throw std::runtime_error("Expected initial money from server");
@@ -56,47 +129,244 @@ void Client::load_and_execute_commands(const std::string& filename) {
 
     // NUEVO: Recibir como DTO
     MoneyDto initial_money = protocol.receive_initial_balance();
-    std::cout << "Initial balance: " << initial_money.amount << std::endl;
+    balance = initial_money.amount;
+    out << "Initial balance: " << initial_money.amount << '\n';
+}
 
-    // TERCERO: reiniciar y ejecutar todos los comandos
-    file.clear();
-    file.seekg(0);
+// ==== SESIÓN QUE SE PUEDE RETOMAR ====
 
-    while (std::getline(file, line)) {
-        if (!line.empty()) {
-            std::istringstream iss(line);
-            std::string command;
-            iss >> command;
+void Client::start_session(const std::string& username) {
+    SessionResumeDto resume(load_session_token(session_file), username);
 
-            if (command == "username")
-                continue;  // Ya procesado
+    // Retenido hasta el primer pedido, así salen en el mismo paquete
+    protocol.set_cork(true);
+    protocol.send_session_resume(resume);
+    session_reply_pending = true;
+}
 
-            std::string parameter;
-            std::getline(iss, parameter);
-            parameter.erase(0, parameter.find_first_not_of(" \t"));
+void Client::finish_session_handshake() {
+    session_reply_pending = false;
+    protocol.set_cork(false);
 
-            execute_command(command, parameter);
+    if (protocol.receive_command() != SEND_SESSION_TOKEN) {
+        throw std::runtime_error("Expected session from server");
+    }
+    SessionDto session = protocol.receive_session();
+    balance = session.money;
+    out << (session.resumed ? "Resumed balance: " : "Initial balance: ") << session.money << '\n';
+    save_session_token(session_file, session.token);
+}
+
+SessionToken Client::load_session_token(const std::string& filename) {
+    // Sin archivo (o ilegible) se presenta un token vacío: sesión nueva
+    SessionToken token{};
+    std::ifstream file(filename);
+    std::string hex;
+    if (!(file >> hex) || hex.size() != 2 * token.size()) {
+        return token;
+    }
+
+    for (size_t i = 0; i < token.size(); i++) {
+        try {
+            token[i] = std::stoi(hex.substr(2 * i, 2), nullptr, 16);
+        } catch (const std::exception&) {
+            return SessionToken{};
+        }
+    }
+    return token;
+}
+
+void Client::save_session_token(const std::string& filename, const SessionToken& token) {
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to write session file: " + filename);
+    }
+
+    file << std::hex << std::setfill('0');
+    for (uint8_t byte: token) {
+        file << std::setw(2) << static_cast<int>(byte);
+    }
+    file << std::endl;
+}
+
+// ==== LOTES ====
+
+// Cuánto ocupa a lo sumo el pedido en el lote (comando + nombre del auto o
+// versión del catálogo), 0 si no va en uno
+static size_t batched_request_size(std::string_view command, std::string_view parameter) {
+    if (command == "get_current_car") {
+        return sizeof(uint8_t);
+    }
+    if (command == "get_market") {
+        return sizeof(uint8_t) + sizeof(uint32_t);
+    }
+    if (command == "buy_car") {
+        return sizeof(uint8_t) + sizeof(uint16_t) + parameter.size();
+    }
+    return 0;
+}
+
+void Client::queue_command(std::string_view command, std::string_view parameter) {
+    if (cache_market && answer_locally(command, parameter)) {
+        return;
+    }
+
+    size_t size = batched_request_size(command, parameter);
+    if (size == 0) {
+        flush_batch();
+        execute_command(command, parameter);
+        return;
+    }
+
+    if (batch_size + size > MAX_BATCH_SIZE) {
+        flush_batch();
+    }
+    batch.emplace_back(command, parameter);
+    batch_size += size;
+    if (command == "get_market" || batch.size() == MAX_BATCH_COMMANDS) {
+        flush_batch();
+    }
+}
+
+void Client::flush_batch() {
+    if (batch.size() == 1) {
+        // Solo no hace falta el lote
+        execute_command(batch[0].first, batch[0].second);
+    } else if (batch.size() > 1) {
+        protocol.begin_batch();
+        for (const auto& [command, parameter]: batch) {
+            if (command == "get_current_car") {
+                protocol.send_current_car_request();
+            } else if (command == "get_market" && cache_market) {
+                protocol.send_market_sync_request(MarketVersionDto(market_catalog.version()));
+            } else if (command == "get_market") {
+                protocol.send_market_info_request();
+            } else {
+                protocol.send_car_purchase_request(parameter);
+            }
+        }
+        protocol.send_batch_request();
+
+        if (receive_reply() != SEND_BATCH_REPLY) {
+            throw std::runtime_error("Expected batch reply from server");
+        }
+        // Las respuestas vienen en el mismo orden, sin pushes en el medio
+        protocol.receive_batch_size();
+        for (const auto& [command, parameter]: batch) {
+            uint8_t reply = protocol.receive_command();
+            if (command == "get_current_car") {
+                print_current_car_reply(reply);
+            } else if (command == "get_market" && cache_market) {
+                receive_market_sync_reply(reply);
+                print_market_info(market_catalog.get_cars());
+            } else if (command == "get_market") {
+                print_market_info_reply(reply);
+            } else {
+                print_buy_car_reply(reply);
+            }
         }
     }
+    batch.clear();
+    batch_size = 0;
 }
 
-void Client::execute_command(const std::string& command, const std::string& parameter) {
+void Client::execute_command(std::string_view command, std::string_view parameter) {
     if (command == "get_current_car") {
         request_current_car();
+    } else if (command == "get_market" && cache_market) {
+        // Lo mismo que una sincronización: sólo viaja lo que cambió
+        request_market_sync();
     } else if (command == "get_market") {
         request_market_info();
     } else if (command == "buy_car") {
         request_buy_car(parameter);
+    } else if (command == "sync_market") {
+        request_market_sync();
+    } else if (command == "subscribe_market") {
+        request_market_subscription();
+    } else if (command == "market_encoding") {
+        request_market_encoding(parameter);
+    } else if (command == "market_cache") {
+        set_market_cache(parameter);
+    } else if (command == "validate_purchases") {
+        set_purchase_validation(parameter);
     } else {
+        out.flush();
         std::cerr << "Unknown command: " << command << std::endl;
     }
 }
 
+// ==== CACHÉ DEL CATÁLOGO ====
+
+/*
+ * Responde sin el servidor lo que la copia local ya sabe. Lo pendiente
+ * en el lote se envía antes, así la salida queda en el orden del script.
+ * */
+bool Client::answer_locally(std::string_view command, std::string_view parameter) {
+    if (command == "get_market" && market_subscribed) {
+        // Suscripto, la copia está al día salvo un push todavía en viaje
+        flush_batch();
+        print_market_info(market_catalog.get_cars());
+        return true;
+    }
+
+    // Sin suscripción la copia puede estar vieja: un auto nuevo o más barato se rechazaría mal
+    if (command == "buy_car" && validate_purchases_locally && market_subscribed) {
+        const char* error = local_purchase_error(parameter);
+        if (error != nullptr) {
+            flush_batch();
+            out << "Error: " << error << '\n';
+            return true;
+        }
+    }
+    return false;
+}
+
+// El mismo error que daría el servidor, o nullptr si hay que preguntarle
+const char* Client::local_purchase_error(std::string_view car_name) const {
+    const CarDto* car = market_catalog.find(car_name);
+    if (car == nullptr) {
+        return "Car not found";
+    }
+
+    // Con compras en el lote sin respuesta todavía no se sabe el saldo
+    bool pending_purchase = std::any_of(batch.begin(), batch.end(), [](const auto& queued) {
+        return queued.first == "buy_car";
+    });
+    if (balance.has_value() && !pending_purchase && *balance < car->price / 100) {
+        return "Insufficient funds";
+    }
+    return nullptr;
+}
+
+void Client::set_market_cache(std::string_view mode) {
+    if (mode == "on") {
+        cache_market = true;
+    } else if (mode == "off") {
+        cache_market = false;
+    } else {
+        out.flush();
+        std::cerr << "Unknown market cache mode: " << mode << std::endl;
+    }
+}
+
+void Client::set_purchase_validation(std::string_view mode) {
+    if (mode == "local") {
+        validate_purchases_locally = true;
+    } else if (mode == "server") {
+        validate_purchases_locally = false;
+    } else {
+        out.flush();
+        std::cerr << "Unknown purchase validation: " << mode << std::endl;
+    }
+}
+
 void Client::request_current_car() {
     protocol.send_current_car_request();
+    print_current_car_reply(receive_reply());
+}
 
-    uint8_t command = protocol.receive_command();
-
+void Client::print_current_car_reply(uint8_t command) {
     if (command == SEND_CURRENT_CAR) {
         // NUEVO: Recibir como DTO
         CarDto current_car = protocol.receive_current_car_info();
@@ -104,7 +374,7 @@ void Client::request_current_car() {
     } else if (command == SEND_ERROR_MESSAGE) {
         // NUEVO: Recibir error como DTO
         ErrorDto error = protocol.receive_error_notification();
-        std::cout << "Error: " << error.message << std::endl;
+        out << "Error: " << error.message << '\n';
     } else {
         throw std::runtime_error("Unexpected response from server");
     }
@@ -112,35 +382,122 @@ void Client::request_current_car() {
 
 void Client::request_market_info() {
     protocol.send_market_info_request();
+    print_market_info_reply(receive_reply());
+}
 
-    uint8_t command = protocol.receive_command();
-    if (command != SEND_MARKET_INFO) {
-        throw std::runtime_error("Expected market info from server");
+void Client::print_market_info_reply(uint8_t command) {
+    // El formato plain se imprime directo desde el buffer, sin copiar los autos
+    if (command == SEND_MARKET_INFO) {
+        print_market_info(protocol.receive_market_catalog_view());
+        return;
+    }
+    // Con el server sobrecargado el catálogo se rechaza ("Server busy")
+    if (command == SEND_ERROR_MESSAGE) {
+        ErrorDto error = protocol.receive_error_notification();
+        out << "Error: " << error.message << '\n';
+        return;
     }
 
-    // NUEVO: Recibir como DTO
-    MarketDto market = protocol.receive_market_catalog();
+    // NUEVO: Recibir como DTO (en la codificación negociada)
+    MarketDto market;
+    if (command == SEND_MARKET_INFO_COMPACT) {
+        market = protocol.receive_market_catalog_compact();
+    } else if (command == SEND_MARKET_INFO_COLUMNS) {
+        market = protocol.receive_market_catalog_columns();
+    } else {
+        throw std::runtime_error("Expected market info from server");
+    }
     print_market_info(market.cars);
 }
 
-void Client::request_buy_car(const std::string& car_name) {
-    protocol.send_car_purchase_request(car_name);
+void Client::request_market_sync() {
+    // Enviamos la versión que ya tenemos; el servidor decide qué mandar
+    protocol.send_market_sync_request(MarketVersionDto(market_catalog.version()));
+    receive_market_sync_reply(receive_reply());
+    print_market_info(market_catalog.get_cars());
+}
+
+void Client::request_market_subscription() {
+    // La respuesta a la suscripción es la misma que la de una sincronización;
+    // los cambios posteriores llegan por push
+    protocol.send_market_subscription_request(MarketVersionDto(market_catalog.version()));
+    receive_market_sync_reply(receive_reply());
+    market_subscribed = true;
+    print_market_info(market_catalog.get_cars());
+}
+
+void Client::request_market_encoding(std::string_view encoding) {
+    uint8_t supported = MARKET_ENCODING_PLAIN;
+    if (encoding == "compact") {
+        supported |= MARKET_ENCODING_COMPACT;
+    } else if (encoding == "columns") {
+        supported |= MARKET_ENCODING_COLUMNS;
+    } else if (encoding != "plain") {
+        out.flush();
+        std::cerr << "Unknown market encoding: " << encoding << std::endl;
+        return;
+    }
+
+    protocol.send_market_encoding_request(MarketEncodingDto(supported));
+    if (receive_reply() != SEND_MARKET_ENCODING) {
+        throw std::runtime_error("Expected market encoding from server");
+    }
+    protocol.receive_market_encoding();
+}
+
+void Client::receive_market_sync_reply(uint8_t command) {
+    if (command == SEND_MARKET_UP_TO_DATE) {
+        protocol.receive_market_up_to_date();
+    } else if (command == SEND_MARKET_DELTA) {
+        market_catalog.apply(protocol.receive_market_delta());
+    } else if (command == SEND_MARKET_SNAPSHOT) {
+        market_catalog.replace(protocol.receive_market_snapshot());
+    } else {
+        throw std::runtime_error("Expected market sync response from server");
+    }
+}
+
+uint8_t Client::receive_reply() {
+    if (session_reply_pending) {
+        finish_session_handshake();
+    }
 
     uint8_t command = protocol.receive_command();
+    while (Protocol::is_push_message(command)) {
+        handle_push_message(command);
+        command = protocol.receive_command();
+    }
+    return command;
+}
+
+void Client::handle_push_message(uint8_t command) {
+    if (command != PUSH_MARKET_UPDATE) {
+        throw std::runtime_error("Unexpected push message from server");
+    }
+
+    market_catalog.apply(protocol.receive_market_update());
+    out << "Market updated to version " << market_catalog.version() << '\n';
+}
+
+void Client::request_buy_car(std::string_view car_name) {
+    protocol.send_car_purchase_request(car_name);
+    print_buy_car_reply(receive_reply());
+}
 
+void Client::print_buy_car_reply(uint8_t command) {
     if (command == SEND_CAR_BOUGHT) {
         // NUEVO: Recibir como DTO
         CarPurchaseDto purchase = protocol.receive_purchase_confirmation();
+        balance = purchase.remaining_money;
 
-        std::cout << "Car bought: " << purchase.car.name << ", year: " << purchase.car.year
-                  << ", price: " << std::fixed << std::setprecision(2)
-                  << (purchase.car.price / 100.0f) << std::endl;
-        std::cout << "Remaining balance: " << purchase.remaining_money << std::endl;
+        out << "Car bought: " << purchase.car.name << ", year: " << purchase.car.year
+            << ", price: " << Cents{purchase.car.price} << '\n';
+        out << "Remaining balance: " << purchase.remaining_money << '\n';
 
     } else if (command == SEND_ERROR_MESSAGE) {
         // NUEVO: Recibir error como DTO
         ErrorDto error = protocol.receive_error_notification();
-        std::cout << "Error: " << error.message << std::endl;
+        out << "Error: " << error.message << '\n';
     } else {
         throw std::runtime_error("Unexpected response from server");
     }
@@ -148,14 +505,20 @@ void Client::request_buy_car(const std::string& car_name) {
 
 void Client::print_market_info(const std::vector<CarDto>& cars) {
     for (const auto& car: cars) {
-        std::cout << car.name << ", year: " << car.year << ", price: " << std::fixed
-                  << std::setprecision(2) << (car.price / 100.0f) << std::endl;
+        out << car.name << ", year: " << car.year << ", price: " << Cents{car.price} << '\n';
+    }
+}
+
+void Client::print_market_info(const MarketView& market) {
+    for (const CarView car: market) {
+        out << car.name() << ", year: " << car.year() << ", price: " << Cents{car.price()}
+            << '\n';
     }
 }
 
 void Client::print_car_info(const CarDto& car, const std::string& prefix) {
-    std::cout << prefix << car.name << ", year: " << car.year << ", price: " << std::fixed
-              << std::setprecision(2) << (car.price / 100.0f) << std::endl;
+    out << prefix << car.name << ", year: " << car.year << ", price: " << Cents{car.price}
+        << '\n';
 }
 
 void Client::run() {}
@@ -1,29 +1,107 @@
 #ifndef CLIENT_H
 #define CLIENT_H
 
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "../common_src/common_protocol.h"
 #include "../common_src/common_socket.h"
+#include "../common_src/common_views.h"
+
+#include "client_catalog.h"
+#include "client_output.h"
 
 class Client {
 private:
+    // Toda la salida por stdout; se escribe en bloque (véase `ConsoleOutput`)
+    ConsoleOutput out;
     Socket socket;
     Protocol protocol;
+    LocalCatalog market_catalog;
+
+    /*
+     * Sesión que se puede retomar: con una línea `session <archivo>` el
+     * token se lee de (y se guarda en) ese archivo. El registro sale junto
+     * con el primer pedido y su respuesta se lee antes que la de éste.
+     * */
+    std::string session_file;
+    bool session_reply_pending;
+
+    void start_session(const std::string& username);
+    void finish_session_handshake();
+    static SessionToken load_session_token(const std::string& filename);
+    static void save_session_token(const std::string& filename, const SessionToken& token);
+
+    /*
+     * Comandos consecutivos que se pueden agrupar (auto actual, catálogo y
+     * compras) se envían en un solo lote, y sus respuestas llegan juntas.
+     * Un lote termina con un catálogo, que ya es una respuesta grande, o
+     * al llegar a `MAX_BATCH_COMMANDS` o `MAX_BATCH_SIZE` bytes.
+     * */
+    static constexpr size_t MAX_BATCH_COMMANDS = 32;
+    static constexpr size_t MAX_BATCH_SIZE = Protocol::MAX_INCOMING_MESSAGE / 2;
+    std::vector<std::pair<std::string_view, std::string_view>> batch;
+    size_t batch_size;
 
+    /*
+     * Caché del catálogo (`market_cache on`): `get_market` revalida la copia
+     * local con su versión (GET_MARKET_SYNC) y sólo recibe lo que cambió;
+     * suscripto al mercado ni siquiera consulta, porque los cambios llegan
+     * por push. Suscripto, las compras de autos que no están en la copia,
+     * o que no alcanza el saldo, se rechazan sin enviarlas, salvo con
+     * `validate_purchases server`.
+     * */
+    bool cache_market;
+    bool validate_purchases_locally;
+    bool market_subscribed;
+    // Saldo según la última respuesta del servidor
+    std::optional<uint32_t> balance;
+
+    // Al terminar el script informa por stderr cuántos comandos por segundo ejecutó
+    bool report_stats;
+
+    // Los comandos son vistas sobre el script (véase `ScriptReader`)
     void load_and_execute_commands(const std::string& filename);
-    void execute_command(const std::string& command, const std::string& parameter);
+    void register_user(const std::string& username);
+    void queue_command(std::string_view command, std::string_view parameter);
+    void flush_batch();
+    void execute_command(std::string_view command, std::string_view parameter);
+    bool answer_locally(std::string_view command, std::string_view parameter);
+    const char* local_purchase_error(std::string_view car_name) const;
 
     void request_current_car();
     void request_market_info();
-    void request_buy_car(const std::string& car_name);
+    void request_buy_car(std::string_view car_name);
+    void print_current_car_reply(uint8_t command);
+    void print_market_info_reply(uint8_t command);
+    void print_buy_car_reply(uint8_t command);
+    void request_market_sync();
+    void request_market_subscription();
+    void request_market_encoding(std::string_view encoding);
+    void set_market_cache(std::string_view mode);
+    void set_purchase_validation(std::string_view mode);
+
+    // Lee el próximo mensaje que no sea push, atendiendo los push que lleguen antes
+    uint8_t receive_reply();
+    void handle_push_message(uint8_t command);
+    void receive_market_sync_reply(uint8_t command);
+
+    /*
+     * Con hostname `shm` se conecta por memoria compartida al server de
+     * la misma máquina que escucha en `port` (véase `ShmChannel`).
+     * */
+    static Socket connect_to_server(const std::string& hostname, const std::string& port);
 
     void print_car_info(const CarDto& car, const std::string& prefix = "");
     void print_market_info(const std::vector<CarDto>& cars);
+    void print_market_info(const MarketView& market);
 
 public:
-    Client(const std::string& hostname, const std::string& port, const std::string& commands_file);
+    Client(const std::string& hostname, const std::string& port, const std::string& commands_file,
+           bool report_stats = false);
 
     void run();
     Client(const Client&) = delete;
@@ -0,0 +1,71 @@
+#include "client_catalog.h"
+
+#include <stdexcept>
+#include <utility>
+
+void LocalCatalog::rebuild_index() {
+    index.clear();
+    for (size_t i = 0; i < cars.size(); i++) {
+        index.emplace(cars[i].name, i);
+    }
+}
+
+void LocalCatalog::replace(MarketSnapshotDto&& snapshot) {
+    current_version = snapshot.version;
+    cars = std::move(snapshot.cars);
+    rebuild_index();
+}
+
+void LocalCatalog::apply(MarketDeltaDto&& delta) {
+    if (delta.from_version != current_version) {
+        throw std::runtime_error("Market delta does not match local catalog version");
+    }
+
+    // Las bajas se marcan y la lista se compacta una sola vez, sin cambiar el orden
+    if (!delta.removed.empty()) {
+        std::vector<bool> removed(cars.size(), false);
+        for (const auto& name: delta.removed) {
+            auto it = index.find(std::string_view(name));
+            if (it != index.end()) {
+                removed[it->second] = true;
+            }
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < cars.size(); i++) {
+            if (!removed[i]) {
+                if (kept != i) {
+                    cars[kept] = std::move(cars[i]);
+                }
+                kept++;
+            }
+        }
+        cars.erase(cars.begin() + kept, cars.end());
+        rebuild_index();
+    }
+
+    // Las altas son upserts: un auto existente se reemplaza en su lugar
+    for (auto& added: delta.added) {
+        auto it = index.find(std::string_view(added.name));
+        if (it != index.end()) {
+            cars[it->second] = std::move(added);
+        } else {
+            index.emplace(added.name, cars.size());
+            cars.push_back(std::move(added));
+        }
+    }
+
+    for (const auto& change: delta.repriced) {
+        auto it = index.find(std::string_view(change.name));
+        if (it != index.end()) {
+            cars[it->second].price = change.price;
+        }
+    }
+
+    current_version = delta.to_version;
+}
+
+const CarDto* LocalCatalog::find(std::string_view name) const {
+    auto it = index.find(name);
+    return (it != index.end()) ? &cars[it->second] : nullptr;
+}
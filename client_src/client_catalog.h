@@ -0,0 +1,52 @@
+#ifndef CLIENT_CATALOG_H
+#define CLIENT_CATALOG_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../common_src/common_protocol.h"
+
+/*
+ * Copia local del catálogo del mercado.
+ *
+ * Se reemplaza completa con un snapshot del servidor o se parchea
+ * con los deltas que este envía. La versión 0 indica que todavía
+ * no se recibió ningún catálogo.
+ *
+ * Un índice por nombre resuelve las búsquedas (y los deltas) sin
+ * recorrer la lista, que conserva el orden en que la envía el servidor.
+ * */
+class LocalCatalog {
+private:
+    uint32_t current_version;
+    std::vector<CarDto> cars;
+    /*
+     * Posición de cada auto en `cars`. Con `std::less<>` se busca
+     * directamente con el `std::string_view` del nombre, sin armar un
+     * `std::string` (y reservar memoria) en cada búsqueda.
+     * */
+    std::map<std::string, size_t, std::less<>> index;
+
+    void rebuild_index();
+
+public:
+    LocalCatalog(): current_version(0) {}
+
+    void replace(MarketSnapshotDto&& snapshot);
+
+    // Lanza excepción si el delta no parte de la versión local
+    // Los autos agregados se mueven desde el delta
+    void apply(MarketDeltaDto&& delta);
+
+    // nullptr si el auto no está en la copia local
+    const CarDto* find(std::string_view name) const;
+
+    uint32_t version() const { return current_version; }
+    const std::vector<CarDto>& get_cars() const { return cars; }
+};
+
+#endif  // CLIENT_CATALOG_H
@@ -1,11 +1,15 @@
 #include <exception>
 #include <iostream>
+#include <string>
 
 #include "client.h"
 
 int main(int argc, const char* argv[]) {
-    if (argc != 4) {
-        std::cerr << "Usage: " << argv[0] << " <hostname> <port> <commands-file>" << std::endl;
+    // Con --stats informa por stderr cuántos comandos por segundo ejecutó
+    bool report_stats = argc == 5 && std::string(argv[4]) == "--stats";
+    if (argc != 4 && !report_stats) {
+        std::cerr << "Usage: " << argv[0] << " <hostname> <port> <commands-file> [--stats]"
+                  << std::endl;
         return 1;
     }
 
@@ -14,7 +18,7 @@ int main(int argc, const char* argv[]) {
     std::string commands_file = argv[3];
 
     try {
-        Client client(hostname, port, commands_file);
+        Client client(hostname, port, commands_file, report_stats);
         client.run();
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
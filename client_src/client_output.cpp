@@ -0,0 +1,90 @@
+#include "client_output.h"
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <utility>
+
+#include <unistd.h>
+
+#include "../common_src/liberror.h"
+
+ConsoleOutput::ConsoleOutput(int fd): fd(fd), buffer(BUFFER_SIZE), used(0) {}
+
+ConsoleOutput::ConsoleOutput(ConsoleOutput&& other) noexcept:
+        fd(other.fd), buffer(std::move(other.buffer)), used(std::exchange(other.used, 0)) {}
+
+ConsoleOutput& ConsoleOutput::operator=(ConsoleOutput&& other) {
+    if (this != &other) {
+        flush();
+        fd = other.fd;
+        buffer = std::move(other.buffer);
+        used = std::exchange(other.used, 0);
+    }
+    return *this;
+}
+
+ConsoleOutput::~ConsoleOutput() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // Un destructor no lanza: lo que no se pudo escribir se pierde
+    }
+}
+
+char* ConsoleOutput::room(size_t size) {
+    if (buffer.size() - used < size) {
+        flush();
+    }
+    return buffer.data() + used;
+}
+
+ConsoleOutput& ConsoleOutput::operator<<(std::string_view text) {
+    if (text.size() > buffer.size()) {
+        // No entra en el buffer: sale directo, después de lo acumulado
+        flush();
+        write_all(text.data(), text.size());
+        return *this;
+    }
+    std::memcpy(room(text.size()), text.data(), text.size());
+    used += text.size();
+    return *this;
+}
+
+ConsoleOutput& ConsoleOutput::operator<<(char c) {
+    *room(1) = c;
+    used++;
+    return *this;
+}
+
+ConsoleOutput& ConsoleOutput::operator<<(Cents price) {
+    // Pesos, punto y siempre dos dígitos de centavos
+    char* out = room(MAX_DIGITS + 3);
+    char* end = std::to_chars(out, out + MAX_DIGITS, price.amount / 100).ptr;
+    uint32_t cents = price.amount % 100;
+    end[0] = '.';
+    end[1] = static_cast<char>('0' + cents / 10);
+    end[2] = static_cast<char>('0' + cents % 10);
+    used = end + 3 - buffer.data();
+    return *this;
+}
+
+void ConsoleOutput::flush() {
+    size_t size = used;
+    used = 0;
+    write_all(buffer.data(), size);
+}
+
+void ConsoleOutput::write_all(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw LibError(errno, "console write failed");
+        }
+        data += n;
+        size -= n;
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef CLIENT_OUTPUT_H
+#define CLIENT_OUTPUT_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Precio en centavos, que se imprime en pesos con dos decimales exactos
+struct Cents {
+    uint32_t amount;
+};
+
+/*
+ * Salida por consola con un buffer propio, para listados grandes (p. ej.
+ * un catálogo entero) sin el costo de `std::cout` y un flush por línea.
+ *
+ * Los números se formatean con `std::to_chars` y los precios (`Cents`)
+ * con aritmética entera: "1234.56" sale igual al `std::fixed` con
+ * `setprecision(2)` de `precio / 100.0f` que se usaba, salvo para precios
+ * desde 131072.01, donde el `float` ya no representa los centavos y éste
+ * sí los imprime bien.
+ *
+ * Lo acumulado se escribe en `fd` cuando se llena el buffer, con `flush`
+ * y al destruirse. Quien escriba en la consola por otro lado (p. ej. con
+ * `std::cerr`) debe llamar antes a `flush` para no alterar el orden.
+ * */
+class ConsoleOutput {
+private:
+    static constexpr size_t BUFFER_SIZE = 256 * 1024;
+    // Lo más largo que ocupa un número: uint64_t en decimal, con signo
+    static constexpr size_t MAX_DIGITS = 21;
+
+    int fd;
+    std::vector<char> buffer;
+    size_t used;
+
+    // Lugar para `size` bytes a partir de `buffer.data() + used`
+    char* room(size_t size);
+    void write_all(const char* data, size_t size);
+
+public:
+    explicit ConsoleOutput(int fd);
+
+    ConsoleOutput& operator<<(std::string_view text);
+    ConsoleOutput& operator<<(char c);
+    ConsoleOutput& operator<<(Cents price);
+
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T> &&
+                                                      !std::is_same_v<T, char> &&
+                                                      !std::is_same_v<T, bool>>>
+    ConsoleOutput& operator<<(T value) {
+        char* out = room(MAX_DIGITS);
+        used = std::to_chars(out, out + MAX_DIGITS, value).ptr - buffer.data();
+        return *this;
+    }
+
+    void flush();
+
+    ~ConsoleOutput();
+
+    ConsoleOutput(const ConsoleOutput&) = delete;
+    ConsoleOutput& operator=(const ConsoleOutput&) = delete;
+    // Lo acumulado pasa al nuevo; el asignado antes escribe lo suyo
+    ConsoleOutput(ConsoleOutput&& other) noexcept;
+    ConsoleOutput& operator=(ConsoleOutput&& other);
+};
+
+#endif  // CLIENT_OUTPUT_H
@@ -0,0 +1,93 @@
+#include "client_script.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ScriptReader::ScriptReader(const std::string& filename):
+        data(nullptr), size(0), offset(0), mapping(nullptr) {
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open commands file: " + filename);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            // Se recorre una sola vez de principio a fin
+            madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+            mapping = mapped;
+            data = static_cast<const char*>(mapped);
+            size = info.st_size;
+            ::close(fd);
+            return;
+        }
+    }
+
+    char buf[64 * 1024];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) != 0) {
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ::close(fd);
+            throw std::runtime_error("Failed to read commands file: " + filename);
+        }
+        contents.insert(contents.end(), buf, buf + n);
+    }
+    ::close(fd);
+    data = contents.data();
+    size = contents.size();
+}
+
+ScriptReader::~ScriptReader() {
+    if (mapping != nullptr) {
+        munmap(mapping, size);
+    }
+}
+
+// Los mismos que saltea `>>` con el locale "C"
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f' || c == '\n';
+}
+
+std::string_view ScriptReader::first_word(std::string_view text) {
+    size_t start = 0;
+    while (start < text.size() && is_space(text[start])) {
+        start++;
+    }
+    size_t end = start;
+    while (end < text.size() && !is_space(text[end])) {
+        end++;
+    }
+    return text.substr(start, end - start);
+}
+
+bool ScriptReader::next(std::string_view& command, std::string_view& parameter) {
+    std::string_view line;
+    while (line.empty()) {
+        if (offset >= size) {
+            return false;
+        }
+        const char* start = data + offset;
+        const void* newline = std::memchr(start, '\n', size - offset);
+        size_t length = newline ? static_cast<const char*>(newline) - start : size - offset;
+        line = std::string_view(start, length);
+        offset += length + 1;
+    }
+
+    command = first_word(line);
+    size_t rest = command.empty() ? line.size() : command.data() + command.size() - line.data();
+    parameter = line.substr(rest);
+
+    size_t first = parameter.find_first_not_of(" \t");
+    parameter.remove_prefix(first == std::string_view::npos ? parameter.size() : first);
+    return true;
+}
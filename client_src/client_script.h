@@ -0,0 +1,47 @@
+#ifndef CLIENT_SCRIPT_H
+#define CLIENT_SCRIPT_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Lector del archivo de comandos en una sola pasada y sin copias.
+ *
+ * El archivo se mapea en memoria y cada línea se entrega como vistas
+ * sobre el mapeo, válidas mientras viva el lector: no hay una reserva de
+ * memoria por línea. Si el archivo no se puede mapear (p. ej. un pipe) se
+ * lee entero a memoria.
+ *
+ * Las líneas se separan igual que con `std::getline` y `>>`: el comando
+ * es la primera palabra y el parámetro el resto de la línea, sin los
+ * espacios y tabs del principio. Las líneas vacías se saltean.
+ * */
+class ScriptReader {
+private:
+    const char* data;
+    size_t size;
+    size_t offset;
+
+    void* mapping;  // nullptr si se leyó a `contents`
+    std::vector<char> contents;
+
+public:
+    explicit ScriptReader(const std::string& filename);
+
+    // Próxima línea no vacía; false al llegar al final del archivo
+    bool next(std::string_view& command, std::string_view& parameter);
+
+    // Primera palabra de `text`, como la leería `>>`
+    static std::string_view first_word(std::string_view text);
+
+    ~ScriptReader();
+
+    ScriptReader(const ScriptReader&) = delete;
+    ScriptReader& operator=(const ScriptReader&) = delete;
+    ScriptReader(ScriptReader&&) = delete;
+    ScriptReader& operator=(ScriptReader&&) = delete;
+};
+
+#endif  // CLIENT_SCRIPT_H
@@ -0,0 +1,37 @@
+#ifndef COMMON_ARENA_H
+#define COMMON_ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+
+#include "common_buffer_pool.h"
+
+/*
+ * Arena monotónica para lo que vive durante un solo pedido.
+ *
+ * Las reservas se toman de bloques del `BufferPool`, sin pasar por el
+ * `new` global; liberar no hace nada hasta `reset()`, que devuelve los
+ * bloques al pool. Así una conexión inactiva no retiene memoria.
+ *
+ * Nada de lo reservado en la arena puede sobrevivir al `reset()`.
+ * */
+class RequestArena {
+private:
+    static const size_t BLOCK_SIZE = 4096;
+
+    std::pmr::monotonic_buffer_resource resource;
+
+public:
+    RequestArena(): resource(BLOCK_SIZE, BufferPool::get()) {}
+
+    std::pmr::memory_resource* get() { return &resource; }
+
+    void reset() { resource.release(); }
+
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+    RequestArena(RequestArena&&) = delete;
+    RequestArena& operator=(RequestArena&&) = delete;
+};
+
+#endif  // COMMON_ARENA_H
@@ -0,0 +1,8 @@
+#include "common_buffer_pool.h"
+
+std::pmr::memory_resource* BufferPool::get() {
+    // La implementación de libstdc++ ya mantiene un pool por hilo
+    static std::pmr::synchronized_pool_resource pool(
+            std::pmr::pool_options{0, LARGEST_POOLED_BLOCK}, std::pmr::new_delete_resource());
+    return &pool;
+}
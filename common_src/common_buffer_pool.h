@@ -0,0 +1,26 @@
+#ifndef COMMON_BUFFER_POOL_H
+#define COMMON_BUFFER_POOL_H
+
+#include <cstddef>
+#include <memory_resource>
+
+/*
+ * Pool global de memoria para buffers de mensajes.
+ *
+ * Agrupa los bloques por clases de tamaño y los recicla entre todas las
+ * conexiones: un buffer se toma para armar un mensaje y se devuelve al
+ * terminar de enviarlo, así las conexiones inactivas no retienen memoria.
+ * Cada hilo tiene su propio cache de bloques libres, y sólo se sincroniza
+ * cuando se le acaban.
+ *
+ * Los bloques más grandes que `LARGEST_POOLED_BLOCK` (p. ej. un catálogo
+ * muy grande) no se guardan en el pool: se piden y se devuelven al heap.
+ * */
+class BufferPool {
+public:
+    static const size_t LARGEST_POOLED_BLOCK = 64 * 1024;
+
+    static std::pmr::memory_resource* get();
+};
+
+#endif  // COMMON_BUFFER_POOL_H
@@ -0,0 +1,140 @@
+#include "common_byteswap.h"
+
+#include <cstring>
+
+#include <arpa/inet.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTESWAP_X86 1
+#endif
+
+namespace {
+
+typedef void (*SwapKernel)(const uint8_t* src, uint8_t* dst, size_t count);
+
+struct SwapKernels {
+    SwapKernel swap16;
+    SwapKernel swap32;
+    const char* name;
+};
+
+// ==== ESCALAR (y cola de las versiones vectoriales) ====
+
+void swap16_scalar(const uint8_t* src, uint8_t* dst, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint16_t value;
+        std::memcpy(&value, src + i * 2, sizeof(value));
+        value = htons(value);
+        std::memcpy(dst + i * 2, &value, sizeof(value));
+    }
+}
+
+void swap32_scalar(const uint8_t* src, uint8_t* dst, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t value;
+        std::memcpy(&value, src + i * 4, sizeof(value));
+        value = htonl(value);
+        std::memcpy(dst + i * 4, &value, sizeof(value));
+    }
+}
+
+void copy_native(const uint8_t* src, uint8_t* dst, size_t bytes) { std::memcpy(dst, src, bytes); }
+
+void copy16_native(const uint8_t* src, uint8_t* dst, size_t count) {
+    copy_native(src, dst, count * 2);
+}
+
+void copy32_native(const uint8_t* src, uint8_t* dst, size_t count) {
+    copy_native(src, dst, count * 4);
+}
+
+#ifdef BYTESWAP_X86
+
+// ==== SSSE3: pshufb de 16 bytes ====
+
+__attribute__((target("ssse3"))) void swap16_ssse3(const uint8_t* src, uint8_t* dst,
+                                                   size_t count) {
+    const __m128i mask = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), _mm_shuffle_epi8(v, mask));
+    }
+    swap16_scalar(src + i * 2, dst + i * 2, count - i);
+}
+
+__attribute__((target("ssse3"))) void swap32_ssse3(const uint8_t* src, uint8_t* dst,
+                                                   size_t count) {
+    const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_shuffle_epi8(v, mask));
+    }
+    swap32_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+// ==== AVX2: pshufb de 32 bytes (el shuffle opera por mitades de 16) ====
+
+__attribute__((target("avx2"))) void swap16_avx2(const uint8_t* src, uint8_t* dst,
+                                                 size_t count) {
+    const __m256i mask = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                          1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 2),
+                            _mm256_shuffle_epi8(v, mask));
+    }
+    swap16_scalar(src + i * 2, dst + i * 2, count - i);
+}
+
+__attribute__((target("avx2"))) void swap32_avx2(const uint8_t* src, uint8_t* dst,
+                                                 size_t count) {
+    const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4),
+                            _mm256_shuffle_epi8(v, mask));
+    }
+    swap32_scalar(src + i * 4, dst + i * 4, count - i);
+}
+
+#endif  // BYTESWAP_X86
+
+SwapKernels select_kernels() {
+    if (htons(1) == 1) {
+        // Host big endian: no hay nada que intercambiar
+        return {copy16_native, copy32_native, "native"};
+    }
+#ifdef BYTESWAP_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {swap16_avx2, swap32_avx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return {swap16_ssse3, swap32_ssse3, "ssse3"};
+    }
+#endif
+    return {swap16_scalar, swap32_scalar, "scalar"};
+}
+
+const SwapKernels& kernels() {
+    static const SwapKernels selected = select_kernels();
+    return selected;
+}
+
+}  // namespace
+
+void ByteSwap::copy_big_endian_16(const void* src, void* dst, size_t count) {
+    kernels().swap16(static_cast<const uint8_t*>(src), static_cast<uint8_t*>(dst), count);
+}
+
+void ByteSwap::copy_big_endian_32(const void* src, void* dst, size_t count) {
+    kernels().swap32(static_cast<const uint8_t*>(src), static_cast<uint8_t*>(dst), count);
+}
+
+const char* ByteSwap::implementation() { return kernels().name; }
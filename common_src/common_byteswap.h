@@ -0,0 +1,27 @@
+#ifndef COMMON_BYTESWAP_H
+#define COMMON_BYTESWAP_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Conversión en bloque de arrays de enteros entre el orden del host
+ * y big endian (orden de red).
+ *
+ * Intercambiar bytes es su propia inversa, así que la misma función
+ * sirve para codificar y para decodificar. Los punteros no necesitan
+ * estar alineados y `src` y `dst` no se pueden solapar.
+ *
+ * La implementación (AVX2, SSSE3 o escalar) se elige una sola vez en
+ * tiempo de ejecución según lo que soporte el procesador.
+ * */
+class ByteSwap {
+public:
+    static void copy_big_endian_16(const void* src, void* dst, size_t count);
+    static void copy_big_endian_32(const void* src, void* dst, size_t count);
+
+    // Nombre de la implementación elegida ("avx2", "ssse3", "scalar" o "native")
+    static const char* implementation();
+};
+
+#endif  // COMMON_BYTESWAP_H
@@ -0,0 +1,202 @@
+#include "common_catalog_codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <arpa/inet.h>
+
+#include "common_byteswap.h"
+
+namespace {
+
+// Lector con chequeo de límites sobre un payload ya recibido
+class ByteReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+
+public:
+    ByteReader(const uint8_t* data, size_t size): data(data), size(size), offset(0) {}
+
+    uint32_t read_varint() {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (offset >= size) {
+                throw std::runtime_error("Malformed compact market: truncated varint");
+            }
+            uint8_t byte = data[offset++];
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Malformed compact market: varint too long");
+    }
+
+    const char* read_bytes(size_t count) {
+        if (count > size - offset) {
+            throw std::runtime_error("Malformed compact market: truncated data");
+        }
+        const char* bytes = reinterpret_cast<const char*>(data + offset);
+        offset += count;
+        return bytes;
+    }
+
+    uint16_t read_uint16() {
+        uint16_t value;
+        std::memcpy(&value, read_bytes(sizeof(value)), sizeof(value));
+        return ntohs(value);
+    }
+
+    uint32_t read_uint32() {
+        uint32_t value;
+        std::memcpy(&value, read_bytes(sizeof(value)), sizeof(value));
+        return ntohl(value);
+    }
+
+    bool at_end() const { return offset == size; }
+};
+
+}  // namespace
+
+void CatalogCodec::append_varint(MessageBuffer& buffer, uint32_t value) {
+    while (value >= 0x80) {
+        buffer.append_byte(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    buffer.append_byte(static_cast<uint8_t>(value));
+}
+
+void CatalogCodec::encode(const std::vector<CarDto>& cars, MessageBuffer& buffer) {
+    append_varint(buffer, cars.size());
+
+    // Columna de nombres con front coding respecto del anterior
+    const std::pmr::string* previous = nullptr;
+    for (const auto& car: cars) {
+        size_t shared = 0;
+        if (previous != nullptr) {
+            size_t limit = std::min(previous->size(), car.name.size());
+            while (shared < limit && (*previous)[shared] == car.name[shared]) {
+                shared++;
+            }
+        }
+        append_varint(buffer, shared);
+        append_varint(buffer, car.name.size() - shared);
+        buffer.append_bytes(car.name.data() + shared, car.name.size() - shared);
+        previous = &car.name;
+    }
+
+    // Columnas numéricas como diferencias respecto del anterior. La resta
+    // en uint32_t da la diferencia módulo 2^32, que zigzag preserva.
+    uint32_t previous_year = 0;
+    for (const auto& car: cars) {
+        append_varint(buffer, zigzag_encode(static_cast<int32_t>(car.year - previous_year)));
+        previous_year = car.year;
+    }
+
+    uint32_t previous_price = 0;
+    for (const auto& car: cars) {
+        append_varint(buffer, zigzag_encode(static_cast<int32_t>(car.price - previous_price)));
+        previous_price = car.price;
+    }
+}
+
+std::vector<CarDto> CatalogCodec::decode(const uint8_t* data, size_t size) {
+    ByteReader reader(data, size);
+
+    uint32_t num_cars = reader.read_varint();
+    // Cada auto ocupa al menos 4 bytes: evita reservas absurdas con datos corruptos
+    if (num_cars > size / 4) {
+        throw std::runtime_error("Malformed compact market: bad car count");
+    }
+
+    std::vector<CarDto> cars(num_cars);
+
+    const std::pmr::string* previous = nullptr;
+    for (auto& car: cars) {
+        uint32_t shared = reader.read_varint();
+        uint32_t suffix_length = reader.read_varint();
+        if (shared > 0 && (previous == nullptr || shared > previous->size())) {
+            throw std::runtime_error("Malformed compact market: bad name prefix");
+        }
+        // El sufijo se valida contra lo que queda antes de reservar para él
+        const char* suffix = reader.read_bytes(suffix_length);
+        car.name.reserve(static_cast<size_t>(shared) + suffix_length);
+        if (shared > 0) {
+            car.name.assign(*previous, 0, shared);
+        }
+        car.name.append(suffix, suffix_length);
+        previous = &car.name;
+    }
+
+    uint32_t year = 0;
+    for (auto& car: cars) {
+        year += static_cast<uint32_t>(zigzag_decode(reader.read_varint()));
+        car.year = static_cast<uint16_t>(year);
+    }
+
+    uint32_t price = 0;
+    for (auto& car: cars) {
+        price += static_cast<uint32_t>(zigzag_decode(reader.read_varint()));
+        car.price = price;
+    }
+
+    if (!reader.at_end()) {
+        throw std::runtime_error("Malformed compact market: trailing bytes");
+    }
+    return cars;
+}
+
+void CatalogCodec::encode_columns(const std::vector<CarDto>& cars, MessageBuffer& buffer) {
+    size_t num_cars = cars.size();
+    buffer.append_uint32(num_cars);
+
+    std::vector<uint16_t> years(num_cars);
+    std::vector<uint32_t> prices(num_cars);
+    for (size_t i = 0; i < num_cars; i++) {
+        buffer.append_string(cars[i].name);
+        years[i] = cars[i].year;
+        prices[i] = cars[i].price;
+    }
+
+    // Un solo pasaje por columna en lugar de un htons/htonl + insert por campo
+    ByteSwap::copy_big_endian_16(years.data(), buffer.extend(num_cars * sizeof(uint16_t)),
+                                 num_cars);
+    ByteSwap::copy_big_endian_32(prices.data(), buffer.extend(num_cars * sizeof(uint32_t)),
+                                 num_cars);
+}
+
+std::vector<CarDto> CatalogCodec::decode_columns(const uint8_t* data, size_t size) {
+    ByteReader reader(data, size);
+
+    uint32_t num_cars = reader.read_uint32();
+    // Cada auto ocupa al menos 8 bytes (largo del nombre, año y precio)
+    if (num_cars > size / 8) {
+        throw std::runtime_error("Malformed compact market: bad car count");
+    }
+
+    std::vector<CarDto> cars(num_cars);
+    for (auto& car: cars) {
+        uint16_t length = reader.read_uint16();
+        car.name.assign(reader.read_bytes(length), length);
+    }
+
+    std::vector<uint16_t> years(num_cars);
+    std::vector<uint32_t> prices(num_cars);
+    ByteSwap::copy_big_endian_16(reader.read_bytes(num_cars * sizeof(uint16_t)), years.data(),
+                                 num_cars);
+    ByteSwap::copy_big_endian_32(reader.read_bytes(num_cars * sizeof(uint32_t)), prices.data(),
+                                 num_cars);
+    for (size_t i = 0; i < num_cars; i++) {
+        cars[i].year = years[i];
+        cars[i].price = prices[i];
+    }
+
+    if (!reader.at_end()) {
+        throw std::runtime_error("Malformed compact market: trailing bytes");
+    }
+    return cars;
+}
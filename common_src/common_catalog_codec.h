@@ -0,0 +1,52 @@
+#ifndef COMMON_CATALOG_CODEC_H
+#define COMMON_CATALOG_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common_protocol.h"
+
+/*
+ * Codificación compacta (por columnas) del catálogo.
+ *
+ *   varint cantidad de autos
+ *   nombres: por cada uno varint prefijo compartido con el anterior,
+ *            varint largo del sufijo y los bytes del sufijo (front coding)
+ *   años:    varint del primero y luego diferencias zigzag + varint
+ *   precios: ídem años
+ *
+ * Los catálogos grandes repiten prefijos de marca y tienen años y precios
+ * cercanos, así que la mayoría de los números entran en 1 o 2 bytes.
+ * No depende de ninguna biblioteca externa.
+  *
+ * Hay además una variante por columnas de ancho fijo, pensada para
+ * decodificar rápido en lugar de ocupar poco:
+ *
+ *   uint32 cantidad de autos
+ *   nombres: uint16 largo + bytes (como `MessageBuffer::append_string`)
+ *   años:    cantidad * uint16 big endian
+ *   precios: cantidad * uint32 big endian
+ *
+ * Las columnas numéricas se convierten en bloque con `ByteSwap`.
+ * */
+class CatalogCodec {
+public:
+    static void encode(const std::vector<CarDto>& cars, MessageBuffer& buffer);
+
+    // Lanza excepción si los datos están truncados o mal formados
+    static std::vector<CarDto> decode(const uint8_t* data, size_t size);
+
+    static void encode_columns(const std::vector<CarDto>& cars, MessageBuffer& buffer);
+    static std::vector<CarDto> decode_columns(const uint8_t* data, size_t size);
+
+    static void append_varint(MessageBuffer& buffer, uint32_t value);
+    static uint32_t zigzag_encode(int32_t value) {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+    static int32_t zigzag_decode(uint32_t value) {
+        return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+    }
+};
+
+#endif  // COMMON_CATALOG_CODEC_H
@@ -11,4 +11,40 @@
 #define SEND_CAR_BOUGHT 0x08
 #define SEND_ERROR_MESSAGE 0x09
 
+// Sincronización incremental del catálogo (versiones + deltas)
+#define GET_MARKET_SYNC 0x0A
+#define SEND_MARKET_UP_TO_DATE 0x0B
+#define SEND_MARKET_DELTA 0x0C
+#define SEND_MARKET_SNAPSHOT 0x0D
+
+// Suscripción a cambios del catálogo
+#define SUBSCRIBE_MARKET 0x0E
+
+// Negociación de la codificación del catálogo (SEND_MARKET_INFO)
+#define NEGOTIATE_MARKET_ENCODING 0x0F
+#define SEND_MARKET_ENCODING 0x10
+#define SEND_MARKET_INFO_COMPACT 0x11
+#define SEND_MARKET_INFO_COLUMNS 0x12
+
+// Registro que se puede retomar al reconectarse, con un token de sesión
+#define RESUME_SESSION 0x13
+#define SEND_SESSION_TOKEN 0x14
+
+// Lote de pedidos: varios mensajes en uno, y sus respuestas también en uno
+#define SEND_BATCH 0x15
+#define SEND_BATCH_REPLY 0x16
+
+// Codificaciones soportadas (máscara de bits)
+#define MARKET_ENCODING_PLAIN 0x01
+#define MARKET_ENCODING_COMPACT 0x02
+#define MARKET_ENCODING_COLUMNS 0x04
+
+// Mensajes que el servidor envía sin que medie un pedido (push).
+// Se distinguen de las respuestas por tener el bit alto en 1.
+#define PUSH_MESSAGE_FLAG 0x80
+#define PUSH_MARKET_UPDATE 0x81
+
+// Hostname con el que el cliente se conecta por memoria compartida
+#define SHM_HOSTNAME "shm"
+
 #endif
@@ -0,0 +1,318 @@
+#ifndef COMMON_DTO_SERIALIZER_H
+#define COMMON_DTO_SERIALIZER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <arpa/inet.h>
+
+#include "common_protocol.h"
+#include "common_socket.h"
+
+/*
+ * Serializadores de DTOs generados en tiempo de compilación.
+ *
+ * Cada DTO describe sus campos (en orden de envío) especializando
+ * `DtoFields`. A partir de esa descripción se generan el encoder y el
+ * decoder, con el mismo formato que se usaba a mano:
+ *
+ *   uint8_t / uint16_t / uint32_t  big endian
+ *   std::string / std::pmr::string uint16 largo + bytes
+ *   otro DTO                       sus campos, en línea
+ *
+ * Las partes de tamaño fijo se calculan en tiempo de compilación. Al
+ * codificar se reserva el tamaño exacto una sola vez y se escribe sin
+ * más chequeos; al decodificar se hace un `recvall` por cada tramo que
+ * llega hasta el próximo largo de string (o hasta el final), en lugar
+ * de uno por campo.
+ * */
+template <typename Dto>
+struct DtoFields;  // static constexpr auto members = std::make_tuple(&Dto::a, &Dto::b, ...);
+
+// ==== DESCRIPCIÓN DE LOS CAMPOS DE CADA DTO ====
+
+template <>
+struct DtoFields<UserDto> {
+    static constexpr auto members = std::make_tuple(&UserDto::username);
+};
+
+template <>
+struct DtoFields<CarDto> {
+    static constexpr auto members = std::make_tuple(&CarDto::name, &CarDto::year, &CarDto::price);
+};
+
+template <>
+struct DtoFields<MoneyDto> {
+    static constexpr auto members = std::make_tuple(&MoneyDto::amount);
+};
+
+template <>
+struct DtoFields<CarPurchaseDto> {
+    static constexpr auto members =
+            std::make_tuple(&CarPurchaseDto::car, &CarPurchaseDto::remaining_money);
+};
+
+template <>
+struct DtoFields<ErrorDto> {
+    static constexpr auto members = std::make_tuple(&ErrorDto::message);
+};
+
+namespace dto_detail {
+
+// Tamaño en el cable de cada campo "hoja". Los strings se marcan con 0:
+// ocupan 2 bytes de largo más una cantidad variable.
+constexpr uint8_t STRING_LEAF = 0;
+constexpr size_t STRING_PREFIX = sizeof(uint16_t);
+
+template <typename T, typename = void>
+struct is_dto: std::false_type {};
+
+template <typename T>
+struct is_dto<T, std::void_t<decltype(DtoFields<T>::members)>>: std::true_type {};
+
+// Cualquier std::basic_string<char>, sin importar el allocator
+template <typename T>
+struct is_string: std::false_type {};
+
+template <typename Alloc>
+struct is_string<std::basic_string<char, std::char_traits<char>, Alloc>>: std::true_type {};
+
+template <typename C, typename T>
+T member_type_of(T C::*);
+
+template <typename M>
+using member_t = decltype(member_type_of(std::declval<M>()));
+
+template <size_t N, size_t M>
+constexpr std::array<uint8_t, N + M> concat(const std::array<uint8_t, N>& a,
+                                            const std::array<uint8_t, M>& b) {
+    std::array<uint8_t, N + M> result{};
+    for (size_t i = 0; i < N; i++) result[i] = a[i];
+    for (size_t i = 0; i < M; i++) result[N + i] = b[i];
+    return result;
+}
+
+// Secuencia aplanada de hojas de un tipo (los DTOs anidados se expanden)
+template <typename T>
+constexpr auto leaves();
+
+template <typename Tuple, size_t... I>
+constexpr auto dto_leaves(std::index_sequence<I...>);
+
+template <typename T>
+constexpr auto leaves() {
+    if constexpr (is_dto<T>::value) {
+        using Members = std::decay_t<decltype(DtoFields<T>::members)>;
+        return dto_leaves<Members>(std::make_index_sequence<std::tuple_size<Members>::value>{});
+    } else if constexpr (is_string<T>::value) {
+        return std::array<uint8_t, 1>{STRING_LEAF};
+    } else {
+        static_assert(std::is_same<T, uint8_t>::value || std::is_same<T, uint16_t>::value ||
+                              std::is_same<T, uint32_t>::value,
+                      "Unsupported DTO field type");
+        return std::array<uint8_t, 1>{sizeof(T)};
+    }
+}
+
+template <typename Tuple>
+constexpr std::array<uint8_t, 0> concat_all() {
+    return {};
+}
+
+template <typename Tuple, typename First, typename... Rest>
+constexpr auto concat_all() {
+    return concat(leaves<member_t<First>>(), concat_all<Tuple, Rest...>());
+}
+
+template <typename Tuple, size_t... I>
+constexpr auto dto_leaves(std::index_sequence<I...>) {
+    return concat_all<Tuple, std::tuple_element_t<I, Tuple>...>();
+}
+
+template <size_t N>
+constexpr size_t fixed_size(const std::array<uint8_t, N>& leaf) {
+    size_t size = 0;
+    for (size_t i = 0; i < N; i++) size += (leaf[i] == STRING_LEAF) ? STRING_PREFIX : leaf[i];
+    return size;
+}
+
+/*
+ * Para cada hoja i, cuántos bytes fijos siguen desde la hoja i+1 hasta el
+ * largo del próximo string inclusive (o hasta el final del mensaje). Es lo
+ * que se puede pedir en un solo `recvall` una vez conocido el largo de i.
+ * `runs[N]` es el primer tramo del mensaje.
+ * */
+template <size_t N>
+constexpr std::array<size_t, N + 1> fixed_runs(const std::array<uint8_t, N>& leaf) {
+    std::array<size_t, N + 1> runs{};
+    for (size_t start = 0; start <= N; start++) {
+        size_t first = (start == N) ? 0 : start + 1;
+        size_t run = 0;
+        for (size_t i = first; i < N; i++) {
+            if (leaf[i] == STRING_LEAF) {
+                run += STRING_PREFIX;
+                break;
+            }
+            run += leaf[i];
+        }
+        runs[start] = run;
+    }
+    return runs;
+}
+
+// Escritura/lectura sin chequeos: el tamaño ya se verificó para todo el mensaje
+inline void store(uint8_t*& out, uint8_t value) { *out++ = value; }
+
+inline void store(uint8_t*& out, uint16_t value) {
+    uint16_t network_value = htons(value);
+    std::memcpy(out, &network_value, sizeof(network_value));
+    out += sizeof(network_value);
+}
+
+inline void store(uint8_t*& out, uint32_t value) {
+    uint32_t network_value = htonl(value);
+    std::memcpy(out, &network_value, sizeof(network_value));
+    out += sizeof(network_value);
+}
+
+template <typename Alloc>
+void store(uint8_t*& out, const std::basic_string<char, std::char_traits<char>, Alloc>& value) {
+    store(out, static_cast<uint16_t>(value.size()));
+    std::memcpy(out, value.data(), value.size());
+    out += value.size();
+}
+
+/*
+ * Lee de `Source` (un `Socket` o un `Protocol`: cualquier cosa con
+ * `recvall`) por tramos. `fetch` trae exactamente los bytes que se
+ * van a consumir a continuación; `take` no vuelve a chequear límites.
+ * */
+template <typename Source>
+class SocketReader {
+private:
+    Source& socket;
+    std::vector<uint8_t>& buffer;
+    size_t offset;
+
+public:
+    SocketReader(Source& socket, std::vector<uint8_t>& buffer):
+            socket(socket), buffer(buffer), offset(0) {
+        buffer.clear();
+    }
+
+    void fetch(size_t size) {
+        if (size == 0) {
+            return;
+        }
+        size_t old_size = buffer.size();
+        buffer.resize(old_size + size);
+        if (socket.recvall(buffer.data() + old_size, size) == 0) {
+            throw std::runtime_error("Connection closed in the middle of a message");
+        }
+    }
+
+    const uint8_t* take_bytes(size_t size) {
+        const uint8_t* data = buffer.data() + offset;
+        offset += size;
+        return data;
+    }
+
+    void take(uint8_t& value) { value = *take_bytes(1); }
+
+    void take(uint16_t& value) {
+        std::memcpy(&value, take_bytes(sizeof(value)), sizeof(value));
+        value = ntohs(value);
+    }
+
+    void take(uint32_t& value) {
+        std::memcpy(&value, take_bytes(sizeof(value)), sizeof(value));
+        value = ntohl(value);
+    }
+};
+
+}  // namespace dto_detail
+
+template <typename Dto>
+class DtoSerializer {
+private:
+    static constexpr auto LEAVES = dto_detail::leaves<Dto>();
+    static constexpr size_t LEAF_COUNT = LEAVES.size();
+    static constexpr auto RUNS = dto_detail::fixed_runs(LEAVES);
+
+    template <typename T>
+    static void add_variable_size(const T& value, size_t& size) {
+        if constexpr (dto_detail::is_dto<T>::value) {
+            std::apply([&](auto... member) { (add_variable_size(value.*member, size), ...); },
+                       DtoFields<T>::members);
+        } else if constexpr (dto_detail::is_string<T>::value) {
+            if (value.size() > UINT16_MAX) {
+                throw std::runtime_error("String too long for protocol");
+            }
+            size += value.size();
+        }
+    }
+
+    template <typename T>
+    static void write(const T& value, uint8_t*& out) {
+        if constexpr (dto_detail::is_dto<T>::value) {
+            std::apply([&](auto... member) { (write(value.*member, out), ...); },
+                       DtoFields<T>::members);
+        } else {
+            dto_detail::store(out, value);
+        }
+    }
+
+    template <typename T, typename Reader>
+    static void read(T& value, Reader& reader, size_t& leaf) {
+        if constexpr (dto_detail::is_dto<T>::value) {
+            std::apply([&](auto... member) { (read(value.*member, reader, leaf), ...); },
+                       DtoFields<T>::members);
+        } else if constexpr (dto_detail::is_string<T>::value) {
+            // El largo ya llegó en el tramo anterior: traemos el string y los
+            // campos fijos que le siguen con un solo recvall
+            uint16_t length;
+            reader.take(length);
+            reader.fetch(length + RUNS[leaf]);
+            value.assign(reinterpret_cast<const char*>(reader.take_bytes(length)), length);
+            leaf++;
+        } else {
+            reader.take(value);
+            leaf++;
+        }
+    }
+
+public:
+    // Tamaño fijo del mensaje (campos numéricos y largos de strings)
+    static constexpr size_t FIXED_SIZE = dto_detail::fixed_size(LEAVES);
+
+    static size_t encoded_size(const Dto& dto) {
+        size_t size = FIXED_SIZE;
+        add_variable_size(dto, size);
+        return size;
+    }
+
+    static void encode(const Dto& dto, MessageBuffer& buffer) {
+        uint8_t* out = buffer.extend(encoded_size(dto));
+        write(dto, out);
+    }
+
+    template <typename Source>
+    static Dto receive(Source& source, std::vector<uint8_t>& scratch) {
+        dto_detail::SocketReader<Source> reader(source, scratch);
+        reader.fetch(RUNS[LEAF_COUNT]);
+
+        Dto dto;
+        size_t leaf = 0;
+        read(dto, reader, leaf);
+        return dto;
+    }
+};
+
+#endif  // COMMON_DTO_SERIALIZER_H
@@ -0,0 +1,138 @@
+#include "common_flight_recorder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <ios>
+#include <string>
+
+#include "common_constants.h"
+
+FlightRecorder::Entry& FlightRecorder::next_entry(Direction direction, uint8_t command) {
+    Entry& entry = entries[recorded % CAPACITY];
+    recorded++;
+    entry.time = Clock::now();
+    entry.size = sizeof(command);
+    entry.command = command;
+    entry.direction = direction;
+    entry.preview_size = 0;
+    return entry;
+}
+
+void FlightRecorder::record(Direction direction, const uint8_t* message, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    Entry& entry = next_entry(direction, message[0]);
+    entry.size = size;
+    entry.preview_size = std::min(size - 1, PREVIEW_SIZE);
+    std::memcpy(entry.preview, message + 1, entry.preview_size);
+    open = false;
+}
+
+void FlightRecorder::begin(Direction direction, uint8_t command) {
+    next_entry(direction, command);
+    open = true;
+}
+
+void FlightRecorder::extend(const uint8_t* data, size_t size) {
+    if (!open) {
+        return;
+    }
+    Entry& entry = entries[(recorded - 1) % CAPACITY];
+    entry.size += size;
+    size_t copied = std::min(size, PREVIEW_SIZE - entry.preview_size);
+    std::memcpy(entry.preview + entry.preview_size, data, copied);
+    entry.preview_size += copied;
+}
+
+static const char* command_name(uint8_t command) {
+    switch (command) {
+        case SEND_USERNAME:
+            return "SEND_USERNAME";
+        case SEND_INITIAL_MONEY:
+            return "SEND_INITIAL_MONEY";
+        case SEND_CURRENT_CAR:
+            return "SEND_CURRENT_CAR";
+        case GET_CURRENT_CAR:
+            return "GET_CURRENT_CAR";
+        case GET_MARKET_INFO:
+            return "GET_MARKET_INFO";
+        case SEND_MARKET_INFO:
+            return "SEND_MARKET_INFO";
+        case BUY_CAR:
+            return "BUY_CAR";
+        case SEND_CAR_BOUGHT:
+            return "SEND_CAR_BOUGHT";
+        case SEND_ERROR_MESSAGE:
+            return "SEND_ERROR_MESSAGE";
+        case GET_MARKET_SYNC:
+            return "GET_MARKET_SYNC";
+        case SEND_MARKET_UP_TO_DATE:
+            return "SEND_MARKET_UP_TO_DATE";
+        case SEND_MARKET_DELTA:
+            return "SEND_MARKET_DELTA";
+        case SEND_MARKET_SNAPSHOT:
+            return "SEND_MARKET_SNAPSHOT";
+        case SUBSCRIBE_MARKET:
+            return "SUBSCRIBE_MARKET";
+        case NEGOTIATE_MARKET_ENCODING:
+            return "NEGOTIATE_MARKET_ENCODING";
+        case SEND_MARKET_ENCODING:
+            return "SEND_MARKET_ENCODING";
+        case SEND_MARKET_INFO_COMPACT:
+            return "SEND_MARKET_INFO_COMPACT";
+        case SEND_MARKET_INFO_COLUMNS:
+            return "SEND_MARKET_INFO_COLUMNS";
+        case RESUME_SESSION:
+            return "RESUME_SESSION";
+        case SEND_SESSION_TOKEN:
+            return "SEND_SESSION_TOKEN";
+        case SEND_BATCH:
+            return "SEND_BATCH";
+        case SEND_BATCH_REPLY:
+            return "SEND_BATCH_REPLY";
+        case PUSH_MARKET_UPDATE:
+            return "PUSH_MARKET_UPDATE";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+/*
+ * Una línea por mensaje, p. ej.:
+ *
+ *    -1523.417 ms  in   0x05 GET_MARKET_INFO                  1 bytes
+ *       -0.032 ms  out  0x06 SEND_MARKET_INFO             48213 bytes  00 02 00 05 ...
+ * */
+void FlightRecorder::dump(std::ostream& out) const {
+    size_t kept = std::min<uint64_t>(recorded, CAPACITY);
+    out << "Last " << kept << " of " << recorded << " messages (oldest first)" << std::endl;
+
+    Clock::time_point now = Clock::now();
+    std::ios_base::fmtflags flags = out.flags();
+    char fill = out.fill();
+    for (uint64_t i = recorded - kept; i < recorded; i++) {
+        const Entry& entry = entries[i % CAPACITY];
+        auto age = std::chrono::duration_cast<std::chrono::microseconds>(now - entry.time);
+
+        out << std::dec << std::setfill(' ') << std::setw(7)
+            << "-" + std::to_string(age.count() / 1000) << '.' << std::setfill('0')
+            << std::setw(3) << age.count() % 1000 << " ms  "
+            << (entry.direction == Direction::In ? "in   " : "out  ") << "0x" << std::hex
+            << std::setw(2) << static_cast<int>(entry.command) << ' ' << std::setfill(' ')
+            << std::left << std::setw(26) << command_name(entry.command) << std::right
+            << std::dec << std::setw(8) << entry.size << " bytes";
+        out << std::hex << std::setfill('0') << (entry.preview_size > 0 ? " " : "");
+        for (size_t j = 0; j < entry.preview_size; j++) {
+            out << ' ' << std::setw(2) << static_cast<int>(entry.preview[j]);
+        }
+        if (entry.size > sizeof(entry.command) + entry.preview_size) {
+            out << " ...";
+        }
+        out << '\n';
+    }
+    out << std::flush;
+    out.flags(flags);
+    out.fill(fill);
+}
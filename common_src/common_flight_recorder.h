@@ -0,0 +1,68 @@
+#ifndef COMMON_FLIGHT_RECORDER_H
+#define COMMON_FLIGHT_RECORDER_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/*
+ * Registro de vuelo de una conexión: los últimos `CAPACITY` mensajes que
+ * pasaron por ella (en ambos sentidos) con su comando, largo, instante y
+ * los primeros bytes del payload. Es lo que se mira cuando una conexión
+ * se cuelga o termina con error.
+ *
+ * Es un buffer circular de tamaño fijo dentro de la conexión: registrar
+ * no reserva memoria ni toma locks (lo usa sólo quien atiende la
+ * conexión) y cuesta una lectura del reloj y copiar unos pocos bytes.
+ * */
+class FlightRecorder {
+public:
+    enum class Direction : uint8_t { In, Out };
+
+    static constexpr size_t CAPACITY = 32;
+    // Bytes del payload que se guardan de cada mensaje
+    static constexpr size_t PREVIEW_SIZE = 16;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        Clock::time_point time;
+        uint32_t size;  // Comando incluido
+        uint8_t command;
+        Direction direction;
+        uint8_t preview_size;
+        uint8_t preview[PREVIEW_SIZE];
+    };
+
+    std::array<Entry, CAPACITY> entries;
+    // Mensajes registrados desde el principio; el último está en (recorded - 1) % CAPACITY
+    uint64_t recorded;
+    // La última entrada es un mensaje que todavía se está recibiendo (véase `begin`)
+    bool open;
+
+    Entry& next_entry(Direction direction, uint8_t command);
+
+public:
+    FlightRecorder(): entries(), recorded(0), open(false) {}
+
+    // Mensaje completo: comando y payload
+    void record(Direction direction, const uint8_t* message, size_t size);
+
+    /*
+     * Mensaje que se recibe de a partes (recepción bloqueante): el comando
+     * abre la entrada y cada parte del payload la extiende, hasta que se
+     * abre o se registra el siguiente.
+     * */
+    void begin(Direction direction, uint8_t command);
+    void extend(const uint8_t* data, size_t size);
+
+    uint64_t total_recorded() const { return recorded; }
+
+    // Los mensajes guardados, del más viejo al más nuevo, con su antigüedad
+    void dump(std::ostream& out) const;
+};
+
+#endif  // COMMON_FLIGHT_RECORDER_H
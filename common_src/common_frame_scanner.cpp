@@ -0,0 +1,82 @@
+#include "common_frame_scanner.h"
+
+#include <cstring>
+
+#include <arpa/inet.h>
+
+FrameScanner::FrameScanner(): layout{nullptr, 0}, step(0), parsed(0) {}
+
+void FrameScanner::start(const FrameLayout& frame_layout) {
+    layout = frame_layout;
+    step = 0;
+    parsed = 0;
+    loops.clear();
+}
+
+static uint32_t read_length(const uint8_t* data, size_t width) {
+    if (width == sizeof(uint16_t)) {
+        uint16_t length;
+        std::memcpy(&length, data, sizeof(length));
+        return ntohs(length);
+    }
+    uint32_t length;
+    std::memcpy(&length, data, sizeof(length));
+    return ntohl(length);
+}
+
+size_t FrameScanner::advance(const uint8_t* data, size_t size) {
+    for (;;) {
+        // Fin del cuerpo de una repetición: se vuelve a empezar o se sale
+        while (!loops.empty() && step == loops.back().end_step) {
+            if (--loops.back().remaining > 0) {
+                step = loops.back().first_step;
+            } else {
+                loops.pop_back();
+            }
+        }
+
+        if (step == layout.step_count) {
+            return 0;
+        }
+
+        const FrameStep& current = layout.steps[step];
+        size_t needed;
+        switch (current.kind) {
+            case FrameStep::Fixed:
+                needed = current.arg;
+                break;
+            case FrameStep::String16:
+            case FrameStep::Blob32:
+            case FrameStep::Repeat16: {
+                // Un paso con largo se recorre entero o no se recorre
+                size_t width = (current.kind == FrameStep::Blob32) ? sizeof(uint32_t) :
+                                                                      sizeof(uint16_t);
+                if (size < parsed + width) {
+                    return parsed + width - size;
+                }
+                uint32_t length = read_length(data + parsed, width);
+                if (current.kind == FrameStep::Repeat16) {
+                    parsed += width;
+                    step++;
+                    if (length == 0) {
+                        step += current.arg;
+                    } else {
+                        loops.push_back(Loop{step, step + current.arg, length});
+                    }
+                    continue;
+                }
+                needed = width + length;
+                break;
+            }
+            default:
+                needed = 0;
+                break;
+        }
+
+        if (size < parsed + needed) {
+            return parsed + needed - size;
+        }
+        parsed += needed;
+        step++;
+    }
+}
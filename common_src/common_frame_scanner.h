@@ -0,0 +1,68 @@
+#ifndef COMMON_FRAME_SCANNER_H
+#define COMMON_FRAME_SCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Paso de la descripción de un mensaje:
+ *
+ *   Fixed     `arg` bytes fijos
+ *   String16  uint16 largo + bytes
+ *   Blob32    uint32 largo + bytes
+ *   Repeat16  uint16 cantidad, y los `arg` pasos siguientes se repiten
+ *             esa cantidad de veces
+ * */
+struct FrameStep {
+    enum Kind : uint8_t { Fixed, String16, Blob32, Repeat16 };
+
+    Kind kind;
+    uint16_t arg;
+};
+
+// Descripción del payload de un mensaje (todo lo que sigue al comando)
+struct FrameLayout {
+    const FrameStep* steps;
+    size_t step_count;
+};
+
+/*
+ * Determina, a medida que llegan los bytes, dónde termina un mensaje.
+ *
+ * Guarda hasta dónde ya recorrió el payload, así cuando llegan más bytes
+ * continúa desde ahí en lugar de volver a empezar: un mensaje puede
+ * llegar en tantos pedazos como sea sin que nadie tenga que bloquear
+ * esperando el resto.
+ * */
+class FrameScanner {
+private:
+    struct Loop {
+        size_t first_step;
+        size_t end_step;
+        uint32_t remaining;
+    };
+
+    FrameLayout layout;
+    size_t step;    // Próximo paso a recorrer
+    size_t parsed;  // Bytes del payload ya recorridos
+    std::vector<Loop> loops;
+
+public:
+    FrameScanner();
+
+    // Empieza a recorrer un payload nuevo con la descripción dada
+    void start(const FrameLayout& frame_layout);
+
+    /*
+     * Avanza sobre los `size` bytes recibidos hasta ahora del payload
+     * (siempre desde su inicio). Retorna 0 si el mensaje está completo
+     * o cuántos bytes más hacen falta, como mínimo, para seguir.
+     * */
+    size_t advance(const uint8_t* data, size_t size);
+
+    // Largo del payload: el total una vez que `advance` retornó 0
+    size_t parsed_size() const { return parsed; }
+};
+
+#endif  // COMMON_FRAME_SCANNER_H
@@ -1,12 +1,36 @@
 #include "common_protocol.h"
 
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <iomanip>
 #include <stdexcept>
 #include <utility>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "common_buffer_pool.h"
+#include "common_catalog_codec.h"
 #include "common_constants.h"
+#include "common_dto_serializer.h"
+#include "common_views.h"
+
+// Cantidad de una lista del formato plano (2 bytes): si no entra se rechaza, no se trunca
+static uint16_t plain_list_size(size_t size) {
+    if (size > Protocol::MAX_PLAIN_CATALOG_CARS) {
+        throw std::runtime_error("Too many cars for the plain market format");
+    }
+    return static_cast<uint16_t>(size);
+}
 
 // MessageBuffer implementation
+void MessageBuffer::release() {
+    std::pmr::vector<uint8_t> empty(buffer.get_allocator());
+    buffer.swap(empty);
+}
+
 void MessageBuffer::append_byte(uint8_t value) { buffer.push_back(value); }
 
 void MessageBuffer::append_uint16(uint16_t value) {
@@ -21,121 +45,746 @@ void MessageBuffer::append_uint32(uint32_t value) {
     buffer.insert(buffer.end(), bytes, bytes + sizeof(uint32_t));
 }
 
-void MessageBuffer::append_string(const std::string& str) {
+uint8_t* MessageBuffer::extend(size_t size) {
+    size_t offset = buffer.size();
+    buffer.resize(offset + size);
+    return buffer.data() + offset;
+}
+
+void MessageBuffer::patch_byte(size_t offset, uint8_t value) { buffer[offset] = value; }
+
+void MessageBuffer::patch_uint32(size_t offset, uint32_t value) {
+    uint32_t network_value = htonl(value);
+    std::memcpy(buffer.data() + offset, &network_value, sizeof(uint32_t));
+}
+
+void MessageBuffer::append_string(std::string_view str) {
     append_uint16(str.length());
     buffer.insert(buffer.end(), str.begin(), str.end());
 }
 
-void MessageBuffer::append_car(const CarDto& car) {
-    append_string(car.name);
-    append_uint16(car.year);
-    append_uint32(car.price);
+void MessageBuffer::append_bytes(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+void MessageBuffer::append_car(const CarDto& car) { DtoSerializer<CarDto>::encode(car, *this); }
+
+void MessageBuffer::append_market_delta(const MarketDeltaDto& delta) {
+    append_uint32(delta.from_version);
+    append_uint32(delta.to_version);
+
+    append_uint16(plain_list_size(delta.added.size()));
+    for (const auto& car: delta.added) {
+        append_car(car);
+    }
+
+    append_uint16(plain_list_size(delta.removed.size()));
+    for (const auto& name: delta.removed) {
+        append_string(name);
+    }
+
+    append_uint16(plain_list_size(delta.repriced.size()));
+    for (const auto& change: delta.repriced) {
+        append_string(change.name);
+        append_uint32(change.price);
+    }
+}
+
+// SharedMessage implementation
+SharedMessage::SharedMessage(MessageBuffer&& message, MessageTransfer transfer):
+        message(std::move(message)), transfer(transfer), fd(-1) {
+    if (this->message.size() < ZERO_COPY_THRESHOLD) {
+        this->transfer = MessageTransfer::Copy;
+    }
+    if (this->transfer != MessageTransfer::Sendfile) {
+        return;
+    }
+
+    // Sellado contra escrituras: lo que ya se encoló en los sockets no cambia
+    fd = memfd_create("shared-message", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd != -1) {
+        size_t written = 0;
+        while (written < this->message.size()) {
+            ssize_t n = ::write(fd, this->message.data() + written,
+                                this->message.size() - written);
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            written += n;
+        }
+        int seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL;
+        if (written == this->message.size() && fcntl(fd, F_ADD_SEALS, seals) == 0) {
+            return;
+        }
+        ::close(fd);
+        fd = -1;
+    }
+    this->transfer = MessageTransfer::Zerocopy;
+}
+
+SharedMessage::~SharedMessage() {
+    if (fd != -1) {
+        ::close(fd);
+    }
 }
 
 // Protocol implementation
-Protocol::Protocol(Socket&& skt): socket(std::move(skt)) {}
+Protocol::Protocol(Socket&& skt):
+        socket(std::move(skt)),
+        send_buffer(BufferPool::get()),
+        incoming_offset(0),
+        incoming_ready(false),
+        received_total(0),
+        incoming_position(0),
+        receive_error(""),
+        batching(false),
+        batch_buffer(BufferPool::get()),
+        output_queued(false),
+        output_limit(0),
+        output_head(0),
+        output_offset(0),
+        output_bytes(0),
+        output_overflow(false),
+        zerocopy_support(ZerocopySupport::Untested),
+        zerocopy_next_send(0) {}
+
+Protocol::~Protocol() {
+    if (zerocopy_sends.empty()) {
+        return;
+    }
+    // El kernel todavía usa mensajes que se liberan con la conexión: se
+    // cierra ya, descartando lo que no salió, antes de soltarlos
+    try {
+        socket.discard_unsent_on_close();
+        socket.close();
+    } catch (const std::exception&) {
+        // Un destructor no lanza: como mucho el cierre queda como antes
+    }
+}
 
 // ==== ENVÍO - Trabajando con DTOs y UN solo sendall ====
 
 void Protocol::send_user_registration(const UserDto& user) {
-    send_buffer.clear();
+    begin_message();
     serialize_user(user);
     flush_message(SEND_USERNAME);
 }
 
 void Protocol::send_initial_balance(const MoneyDto& money) {
-    send_buffer.clear();
+    begin_message();
     serialize_money(money);
     flush_message(SEND_INITIAL_MONEY);
 }
 
+void Protocol::send_session_resume(const SessionResumeDto& resume) {
+    begin_message();
+    send_buffer.append_bytes(resume.token.data(), resume.token.size());
+    send_buffer.append_string(resume.username);
+    flush_message(RESUME_SESSION);
+}
+
+void Protocol::send_session(const SessionDto& session) {
+    begin_message();
+    send_buffer.append_bytes(session.token.data(), session.token.size());
+    send_buffer.append_uint32(session.money);
+    send_buffer.append_byte(session.resumed);
+    flush_message(SEND_SESSION_TOKEN);
+}
+
 void Protocol::send_current_car_info(const CarDto& car) {
-    send_buffer.clear();
+    begin_message();
     serialize_car(car);
     flush_message(SEND_CURRENT_CAR);
 }
 
 void Protocol::send_market_catalog(const MarketDto& market) {
-    send_buffer.clear();
-    serialize_market(market);
+    begin_message();
+    serialize_market(market, send_buffer);
     flush_message(SEND_MARKET_INFO);
 }
 
 void Protocol::send_purchase_confirmation(const CarPurchaseDto& purchase) {
-    send_buffer.clear();
+    begin_message();
     serialize_car_purchase(purchase);
     flush_message(SEND_CAR_BOUGHT);
 }
 
 void Protocol::send_error_notification(const ErrorDto& error) {
-    send_buffer.clear();
+    begin_message();
     serialize_error(error);
     flush_message(SEND_ERROR_MESSAGE);
 }
 
 void Protocol::send_current_car_request() {
-    send_buffer.clear();  // Asegurar buffer limpio aunque no haya datos
+    begin_message();  // Asegurar buffer limpio aunque no haya datos
     flush_message(GET_CURRENT_CAR);
 }
 
 void Protocol::send_market_info_request() {
-    send_buffer.clear();  // Asegurar buffer limpio aunque no haya datos
+    begin_message();  // Asegurar buffer limpio aunque no haya datos
     flush_message(GET_MARKET_INFO);
 }
 
-void Protocol::send_car_purchase_request(const std::string& car_name) {
-    send_buffer.clear();
+void Protocol::send_car_purchase_request(std::string_view car_name) {
+    begin_message();
     send_buffer.append_string(car_name);
     flush_message(BUY_CAR);
 }
 
+void Protocol::send_market_sync_request(const MarketVersionDto& known_version) {
+    begin_message();
+    serialize_market_version(known_version);
+    flush_message(GET_MARKET_SYNC);
+}
+
+void Protocol::send_market_up_to_date(const MarketVersionDto& version) {
+    begin_message();
+    serialize_market_version(version);
+    flush_message(SEND_MARKET_UP_TO_DATE);
+}
+
+void Protocol::send_market_delta(const MarketDeltaDto& delta) {
+    begin_message();
+    serialize_market_delta(delta);
+    flush_message(SEND_MARKET_DELTA);
+}
+
+void Protocol::send_market_snapshot(const MarketSnapshotDto& snapshot) {
+    begin_message();
+    serialize_market_snapshot(snapshot);
+    flush_message(SEND_MARKET_SNAPSHOT);
+}
+
+void Protocol::send_market_subscription_request(const MarketVersionDto& known_version) {
+    begin_message();
+    serialize_market_version(known_version);
+    flush_message(SUBSCRIBE_MARKET);
+}
+
+void Protocol::send_market_encoding_request(const MarketEncodingDto& supported) {
+    begin_message();
+    send_buffer.append_byte(supported.encodings);
+    flush_message(NEGOTIATE_MARKET_ENCODING);
+}
+
+void Protocol::send_market_encoding(const MarketEncodingDto& chosen) {
+    begin_message();
+    send_buffer.append_byte(chosen.encodings);
+    flush_message(SEND_MARKET_ENCODING);
+}
+
+void Protocol::send_market_catalog_compact(const MarketDto& market) {
+    begin_message();
+    serialize_market_compact(market, send_buffer);
+    flush_message(SEND_MARKET_INFO_COMPACT);
+}
+
+void Protocol::send_market_catalog_columns(const MarketDto& market) {
+    begin_message();
+    serialize_market_columns(market, send_buffer);
+    flush_message(SEND_MARKET_INFO_COLUMNS);
+}
+
+void Protocol::encode_market_update(const MarketDeltaDto& delta, MessageBuffer& message) {
+    message.clear();
+    message.append_byte(PUSH_MARKET_UPDATE);
+    message.append_market_delta(delta);
+}
+
+void Protocol::send_encoded_message(const MessageBuffer& message) {
+    if (batching) {
+        batch_buffer.append_bytes(message.data(), message.size());
+        return;
+    }
+    recorder.record(FlightRecorder::Direction::Out, message.data(), message.size());
+    if (output_queued) {
+        enqueue_output(message.data(), message.size());
+        return;
+    }
+    socket.sendall(message.data(), message.size());
+}
+
+void Protocol::encode_market_catalog(const MarketDto& market, uint8_t encoding,
+                                     MessageBuffer& message) {
+    message.clear();
+    if (encoding == MARKET_ENCODING_COMPACT) {
+        message.append_byte(SEND_MARKET_INFO_COMPACT);
+        serialize_market_compact(market, message);
+    } else if (encoding == MARKET_ENCODING_COLUMNS) {
+        message.append_byte(SEND_MARKET_INFO_COLUMNS);
+        serialize_market_columns(market, message);
+    } else {
+        message.append_byte(SEND_MARKET_INFO);
+        serialize_market(market, message);
+    }
+}
+
+void Protocol::send_shared_message(std::shared_ptr<const SharedMessage> message) {
+    if (batching) {
+        // Dentro de un lote se copia: el lote entero es un solo mensaje
+        batch_buffer.append_bytes(message->data(), message->size());
+        return;
+    }
+    recorder.record(FlightRecorder::Direction::Out, message->data(), message->size());
+    if (!output_queued) {
+        socket.sendall(message->data(), message->size());
+        return;
+    }
+    size_t size = message->size();
+    output_queue.push_back(OutputEntry{MessageBuffer(), std::move(message)});
+    output_bytes += size;
+    output_overflow = output_overflow || (output_bytes > output_limit && output_bytes > size);
+}
+
 // ==== FLUSH - Una sola llamada a sendall ====
+void Protocol::begin_message() {
+    // El primer byte queda reservado para el comando, que se completa en
+    // flush_message: así el mensaje ya está armado sin copiarlo a otro buffer
+    send_buffer.clear();
+    send_buffer.reserve(INITIAL_MESSAGE_SIZE);
+    send_buffer.append_byte(0);
+}
+
 void Protocol::flush_message(uint8_t command_code) {
-    // Crear buffer completo: comando + datos
-    std::vector<uint8_t> complete_message;
-    complete_message.reserve(1 + send_buffer.size());
+    send_buffer.patch_byte(0, command_code);
+
+    if (batching) {
+        // Sale con el resto del lote en `end_batch`
+        batch_buffer.append_bytes(send_buffer.data(), send_buffer.size());
+        send_buffer.release();
+        return;
+    }
 
-    // Agregar comando
-    complete_message.push_back(command_code);
+    recorder.record(FlightRecorder::Direction::Out, send_buffer.data(), send_buffer.size());
 
-    // Agregar datos serializados
-    if (send_buffer.size() > 0) {
-        const uint8_t* data = send_buffer.data();
-        complete_message.insert(complete_message.end(), data, data + send_buffer.size());
+    if (output_queued) {
+        size_t size = send_buffer.size();
+        if (size > COALESCE_LIMIT) {
+            // Un mensaje grande pasa a la cola sin copiarse
+            output_queue.push_back(OutputEntry{std::move(send_buffer), nullptr});
+            send_buffer = MessageBuffer(BufferPool::get());
+            output_bytes += size;
+            output_overflow =
+                    output_overflow || (output_bytes > output_limit && output_bytes > size);
+        } else {
+            enqueue_output(send_buffer.data(), size);
+            send_buffer.release();
+        }
+        return;
     }
 
     // ¡UNA SOLA LLAMADA A SENDALL!
-    socket.sendall(complete_message.data(), complete_message.size());
+    socket.sendall(send_buffer.data(), send_buffer.size());
+
+    // Entre mensajes la conexión no retiene memoria de envío
+    send_buffer.release();
+}
+
+// ==== LOTES ====
+void Protocol::begin_batch() {
+    // Comando y largo del lote se completan en end_batch
+    batch_buffer.clear();
+    batch_buffer.append_byte(0);
+    batch_buffer.append_uint32(0);
+    batching = true;
+}
+
+void Protocol::send_batch_request() { end_batch(SEND_BATCH); }
+
+void Protocol::send_batch_reply() { end_batch(SEND_BATCH_REPLY); }
+
+void Protocol::end_batch(uint8_t command_code) {
+    batching = false;
+    batch_buffer.patch_uint32(sizeof(uint8_t), batch_buffer.size() - sizeof(uint8_t) -
+                                                       sizeof(uint32_t));
+
+    // El lote armado pasa a ser el mensaje en curso, sin copiarlo
+    std::swap(send_buffer, batch_buffer);
+    flush_message(command_code);
+    batch_buffer.release();
+}
+
+uint32_t Protocol::receive_batch_size() { return deserialize_uint32(); }
+
+// ==== COLA DE SALIDA ====
+void Protocol::enable_output_queue(size_t limit) {
+    output_queued = true;
+    output_limit = limit;
+}
+
+void Protocol::enqueue_output(const uint8_t* data, size_t size) {
+    // Los mensajes chicos se juntan en el último buffer: salen en un solo send
+    bool coalesce = output_head < output_queue.size() && !output_queue.back().shared &&
+                    output_queue.back().owned.size() + size <= COALESCE_LIMIT;
+    if (!coalesce) {
+        output_queue.push_back(OutputEntry{MessageBuffer(BufferPool::get()), nullptr});
+        output_queue.back().owned.reserve(size < INITIAL_MESSAGE_SIZE ? INITIAL_MESSAGE_SIZE :
+                                                                         size);
+    }
+    output_queue.back().owned.append_bytes(data, size);
+
+    output_bytes += size;
+    output_overflow = output_overflow || (output_bytes > output_limit && output_bytes > size);
+}
+
+IoStatus Protocol::flush_output(size_t max_bytes) {
+    if (!zerocopy_sends.empty()) {
+        reap_zerocopy_sends();
+    }
+
+    while (output_head < output_queue.size()) {
+        if (max_bytes == 0) {
+            // El resto sale en la próxima vuelta
+            return IoStatus::Ok;
+        }
+        const OutputEntry& front = output_queue[output_head];
+        size_t size = front.size() - output_offset;
+        IoResult result = send_output_entry(front, std::min(size, max_bytes));
+        if (result.status != IoStatus::Ok) {
+            return result.status;
+        }
+
+        max_bytes -= result.bytes;
+        output_offset += result.bytes;
+        output_bytes -= result.bytes;
+        if (output_offset == front.size()) {
+            // Un buffer compartido se suelta apenas termina de enviarse
+            output_queue[output_head].shared.reset();
+            output_head++;
+            output_offset = 0;
+        }
+    }
+
+    // Cola vacía: los buffers vuelven al pool
+    output_queue.clear();
+    output_head = 0;
+    return IoStatus::Ok;
+}
+
+IoResult Protocol::send_output_entry(const OutputEntry& entry, size_t size) {
+    if (entry.shared) {
+        MessageTransfer transfer = entry.shared->get_transfer();
+        if (transfer == MessageTransfer::Sendfile) {
+            return socket.try_sendfile(entry.shared->get_fd(), output_offset, size);
+        }
+        if (transfer == MessageTransfer::Zerocopy) {
+            return send_zerocopy(entry.shared, size);
+        }
+    }
+    return socket.try_sendsome(entry.data() + output_offset, size);
+}
+
+IoResult Protocol::send_zerocopy(const std::shared_ptr<const SharedMessage>& message,
+                                 size_t size) {
+    if (zerocopy_support == ZerocopySupport::Untested) {
+        zerocopy_support = socket.enable_zerocopy() ? ZerocopySupport::Enabled :
+                                                       ZerocopySupport::Unavailable;
+    }
+    if (zerocopy_support == ZerocopySupport::Unavailable) {
+        return socket.try_sendsome(message->data() + output_offset, size);
+    }
+
+    bool accepted;
+    IoResult result = socket.try_sendsome_zerocopy(message->data() + output_offset, size, accepted);
+    if (!accepted) {
+        return result;
+    }
+
+    // Los envíos seguidos del mismo mensaje comparten registro
+    uint32_t send = zerocopy_next_send++;
+    if (!zerocopy_sends.empty() && zerocopy_sends.back().message == message &&
+        zerocopy_sends.back().last + 1 == send) {
+        zerocopy_sends.back().last = send;
+        zerocopy_sends.back().unconfirmed++;
+    } else {
+        zerocopy_sends.push_back(ZerocopySends{send, send, 1, message});
+    }
+    return result;
+}
+
+void Protocol::reap_zerocopy_sends() {
+    // Cada aviso confirma un rango de envíos, no necesariamente en orden
+    uint32_t first;
+    uint32_t last;
+    bool confirmed = false;
+    while (socket.try_recv_zerocopy_done(first, last)) {
+        for (ZerocopySends& sends: zerocopy_sends) {
+            uint32_t overlap_first = std::max(first, sends.first);
+            uint32_t overlap_last = std::min(last, sends.last);
+            if (overlap_first <= overlap_last) {
+                sends.unconfirmed -= overlap_last - overlap_first + 1;
+            }
+        }
+        confirmed = true;
+    }
+
+    if (confirmed) {
+        zerocopy_sends.erase(std::remove_if(zerocopy_sends.begin(), zerocopy_sends.end(),
+                                            [](const ZerocopySends& sends) {
+                                                return sends.unconfirmed == 0;
+                                            }),
+                             zerocopy_sends.end());
+    }
 }
 
 // ==== SERIALIZACIÓN ====
-void Protocol::serialize_user(const UserDto& user) { send_buffer.append_string(user.username); }
+void Protocol::serialize_user(const UserDto& user) {
+    DtoSerializer<UserDto>::encode(user, send_buffer);
+}
 
-void Protocol::serialize_money(const MoneyDto& money) { send_buffer.append_uint32(money.amount); }
+void Protocol::serialize_money(const MoneyDto& money) {
+    DtoSerializer<MoneyDto>::encode(money, send_buffer);
+}
 
-void Protocol::serialize_car(const CarDto& car) { send_buffer.append_car(car); }
+void Protocol::serialize_car(const CarDto& car) { DtoSerializer<CarDto>::encode(car, send_buffer); }
 
-void Protocol::serialize_market(const MarketDto& market) {
-    send_buffer.append_uint16(market.cars.size());
+void Protocol::serialize_market(const MarketDto& market, MessageBuffer& buffer) {
+    buffer.append_uint16(plain_list_size(market.cars.size()));
     for (const auto& car: market.cars) {
-        send_buffer.append_car(car);
+        buffer.append_car(car);
     }
 }
 
 void Protocol::serialize_car_purchase(const CarPurchaseDto& purchase) {
-    send_buffer.append_car(purchase.car);
-    send_buffer.append_uint32(purchase.remaining_money);
+    DtoSerializer<CarPurchaseDto>::encode(purchase, send_buffer);
+}
+
+void Protocol::serialize_error(const ErrorDto& error) {
+    DtoSerializer<ErrorDto>::encode(error, send_buffer);
+}
+
+void Protocol::serialize_market_version(const MarketVersionDto& version) {
+    send_buffer.append_uint32(version.version);
+}
+
+void Protocol::serialize_market_delta(const MarketDeltaDto& delta) {
+    send_buffer.append_market_delta(delta);
+}
+
+void Protocol::serialize_market_snapshot(const MarketSnapshotDto& snapshot) {
+    send_buffer.append_uint32(snapshot.version);
+    send_buffer.append_uint16(plain_list_size(snapshot.cars.size()));
+    for (const auto& car: snapshot.cars) {
+        send_buffer.append_car(car);
+    }
+}
+
+// Largo total (4 bytes) y luego el catálogo codificado por columnas
+void Protocol::serialize_market_compact(const MarketDto& market, MessageBuffer& buffer) {
+    buffer.append_uint32(0);  // se completa al final
+    size_t start = buffer.size();
+    CatalogCodec::encode(market.cars, buffer);
+    buffer.patch_uint32(start - sizeof(uint32_t), buffer.size() - start);
+}
+
+void Protocol::serialize_market_columns(const MarketDto& market, MessageBuffer& buffer) {
+    buffer.append_uint32(0);  // se completa al final
+    size_t start = buffer.size();
+    CatalogCodec::encode_columns(market.cars, buffer);
+    buffer.patch_uint32(start - sizeof(uint32_t), buffer.size() - start);
+}
+
+// ==== RECEPCIÓN NO BLOQUEANTE ====
+
+// Formato de los payloads, tal como los escriben los métodos de envío
+static const size_t CAR_FIXED = sizeof(uint16_t) + sizeof(uint32_t);  // año + precio
+
+static const FrameStep STRING_PAYLOAD[] = {{FrameStep::String16, 0}};
+static const FrameStep UINT8_PAYLOAD[] = {{FrameStep::Fixed, sizeof(uint8_t)}};
+static const FrameStep UINT32_PAYLOAD[] = {{FrameStep::Fixed, sizeof(uint32_t)}};
+static const FrameStep BLOB_PAYLOAD[] = {{FrameStep::Blob32, 0}};
+static const FrameStep RESUME_PAYLOAD[] = {{FrameStep::Fixed, sizeof(SessionToken)},
+                                           {FrameStep::String16, 0}};
+static const FrameStep SESSION_PAYLOAD[] = {
+        {FrameStep::Fixed, sizeof(SessionToken) + sizeof(uint32_t) + sizeof(uint8_t)}};
+static const FrameStep CAR_PAYLOAD[] = {{FrameStep::String16, 0}, {FrameStep::Fixed, CAR_FIXED}};
+static const FrameStep PURCHASE_PAYLOAD[] = {{FrameStep::String16, 0},
+                                             {FrameStep::Fixed, CAR_FIXED + sizeof(uint32_t)}};
+static const FrameStep MARKET_PAYLOAD[] = {
+        {FrameStep::Repeat16, 2}, {FrameStep::String16, 0}, {FrameStep::Fixed, CAR_FIXED}};
+static const FrameStep SNAPSHOT_PAYLOAD[] = {{FrameStep::Fixed, sizeof(uint32_t)},
+                                             {FrameStep::Repeat16, 2},
+                                             {FrameStep::String16, 0},
+                                             {FrameStep::Fixed, CAR_FIXED}};
+static const FrameStep DELTA_PAYLOAD[] = {
+        {FrameStep::Fixed, 2 * sizeof(uint32_t)},                          // versiones
+        {FrameStep::Repeat16, 2}, {FrameStep::String16, 0}, {FrameStep::Fixed, CAR_FIXED},  // added
+        {FrameStep::Repeat16, 1}, {FrameStep::String16, 0},                // removed
+        {FrameStep::Repeat16, 2}, {FrameStep::String16, 0}, {FrameStep::Fixed, sizeof(uint32_t)}};
+
+template <size_t N>
+static FrameLayout layout_of(const FrameStep (&steps)[N]) {
+    return FrameLayout{steps, N};
+}
+
+bool Protocol::frame_layout_for(uint8_t command, FrameLayout& layout) {
+    switch (command) {
+        case GET_CURRENT_CAR:
+        case GET_MARKET_INFO:
+            layout = FrameLayout{nullptr, 0};
+            return true;
+        case SEND_USERNAME:
+        case BUY_CAR:
+        case SEND_ERROR_MESSAGE:
+            layout = layout_of(STRING_PAYLOAD);
+            return true;
+        case RESUME_SESSION:
+            layout = layout_of(RESUME_PAYLOAD);
+            return true;
+        case SEND_SESSION_TOKEN:
+            layout = layout_of(SESSION_PAYLOAD);
+            return true;
+        case SEND_INITIAL_MONEY:
+        case GET_MARKET_SYNC:
+        case SEND_MARKET_UP_TO_DATE:
+        case SUBSCRIBE_MARKET:
+            layout = layout_of(UINT32_PAYLOAD);
+            return true;
+        case NEGOTIATE_MARKET_ENCODING:
+        case SEND_MARKET_ENCODING:
+            layout = layout_of(UINT8_PAYLOAD);
+            return true;
+        case SEND_CURRENT_CAR:
+            layout = layout_of(CAR_PAYLOAD);
+            return true;
+        case SEND_CAR_BOUGHT:
+            layout = layout_of(PURCHASE_PAYLOAD);
+            return true;
+        case SEND_MARKET_INFO:
+            layout = layout_of(MARKET_PAYLOAD);
+            return true;
+        case SEND_MARKET_SNAPSHOT:
+            layout = layout_of(SNAPSHOT_PAYLOAD);
+            return true;
+        case SEND_MARKET_DELTA:
+        case PUSH_MARKET_UPDATE:
+            layout = layout_of(DELTA_PAYLOAD);
+            return true;
+        case SEND_MARKET_INFO_COMPACT:
+        case SEND_MARKET_INFO_COLUMNS:
+        case SEND_BATCH:
+        case SEND_BATCH_REPLY:
+            layout = layout_of(BLOB_PAYLOAD);
+            return true;
+        default:
+            return false;
+    }
+}
+
+ReceiveStatus Protocol::receive_available() {
+    if (incoming_ready) {
+        // El mensaje anterior ya se atendió: empezamos uno nuevo
+        incoming.clear();
+        incoming_offset = 0;
+        incoming_ready = false;
+    }
+
+    for (;;) {
+        size_t missing = 1;  // Sin comando todavía: falta ese byte
+        if (!incoming.empty()) {
+            missing = frame_scanner.advance(incoming.data() + 1, incoming.size() - 1);
+        }
+        if (missing == 0) {
+            if (incoming[0] == SEND_BATCH && !scan_batch()) {
+                receive_error = "Invalid batch received";
+                return ReceiveStatus::Error;
+            }
+            incoming_ready = true;
+            recorder.record(FlightRecorder::Direction::In, incoming.data(), incoming.size());
+            return ReceiveStatus::Complete;
+        }
+        if (incoming.size() + missing > MAX_INCOMING_MESSAGE) {
+            receive_error = "Message too large";
+            return ReceiveStatus::Error;
+        }
+
+        // Se pide sólo lo que le falta a este mensaje: lo que sigue en el
+        // socket es del próximo y queda ahí hasta que se lo atienda
+        size_t old_size = incoming.size();
+        if (old_size == 0) {
+            incoming_position = received_total;
+        }
+        incoming.resize(old_size + missing);
+        IoResult result = socket.try_recvsome(incoming.data() + old_size, missing);
+        incoming.resize(old_size + result.bytes);
+        received_total += result.bytes;
+
+        if (result.status == IoStatus::WouldBlock) {
+            return ReceiveStatus::WouldBlock;
+        }
+        if (result.status == IoStatus::Closed) {
+            if (old_size == 0) {
+                return ReceiveStatus::Closed;
+            }
+            receive_error = "Connection closed in the middle of a message";
+            return ReceiveStatus::Error;
+        }
+
+        if (old_size == 0) {
+            FrameLayout layout;
+            if (!frame_layout_for(incoming[0], layout)) {
+                receive_error = "Unknown command received";
+                return ReceiveStatus::Error;
+            }
+            frame_scanner.start(layout);
+        }
+    }
 }
 
-void Protocol::serialize_error(const ErrorDto& error) { send_buffer.append_string(error.message); }
+bool Protocol::scan_batch() {
+    // Cada mensaje del lote debe ser uno conocido y completo, y ocuparlo justo
+    batch_commands.clear();
+    size_t offset = sizeof(uint8_t) + sizeof(uint32_t);
+    FrameScanner scanner;
+    while (offset < incoming.size()) {
+        uint8_t command = incoming[offset];
+        FrameLayout layout;
+        if (command == SEND_BATCH || !frame_layout_for(command, layout)) {
+            return false;
+        }
+        scanner.start(layout);
+        const uint8_t* payload = incoming.data() + offset + 1;
+        if (scanner.advance(payload, incoming.size() - offset - 1) != 0) {
+            return false;
+        }
+        batch_commands.push_back(command);
+        offset += 1 + scanner.parsed_size();
+    }
+    return true;
+}
+
+int Protocol::recvall(void* data, unsigned int size) {
+    if (!incoming_ready) {
+        int received = socket.recvall(data, size);
+        recorder.extend(static_cast<const uint8_t*>(data), received);
+        return received;
+    }
+
+    if (size > incoming.size() - incoming_offset) {
+        throw std::runtime_error("Message shorter than expected");
+    }
+    std::memcpy(data, incoming.data() + incoming_offset, size);
+    incoming_offset += size;
+    return size;
+}
 
 // ==== RECEPCIÓN ====
 uint8_t Protocol::receive_command() {
     uint8_t command = 0;
-    int ret = socket.recvall(&command, sizeof(command));
-    if (ret == 0) {
+    if (incoming_ready) {
+        // Ya registrado entero por receive_available
+        recvall(&command, sizeof(command));
+        return command;
+    }
+    if (socket.recvall(&command, sizeof(command)) == 0) {
         throw std::runtime_error("Client disconnected");
     }
+    // El payload se agrega al registro a medida que se lee
+    recorder.begin(FlightRecorder::Direction::In, command);
     return command;
 }
 
@@ -143,64 +792,104 @@ UserDto Protocol::receive_user_registration() { return deserialize_user(); }
 
 MoneyDto Protocol::receive_initial_balance() { return deserialize_money(); }
 
+SessionResumeDto Protocol::receive_session_resume() {
+    SessionResumeDto resume;
+    recvall(resume.token.data(), resume.token.size());
+    resume.username = deserialize_string();
+    return resume;
+}
+
+SessionDto Protocol::receive_session() {
+    SessionDto session;
+    recvall(session.token.data(), session.token.size());
+    session.money = deserialize_uint32();
+    recvall(&session.resumed, sizeof(session.resumed));
+    return session;
+}
+
 CarDto Protocol::receive_current_car_info() { return deserialize_car(); }
 
 MarketDto Protocol::receive_market_catalog() { return deserialize_market(); }
 
+MarketView Protocol::receive_market_catalog_view() {
+    receive_buffer.clear();
+    receive_into_buffer(sizeof(uint16_t));
+
+    uint16_t num_cars;
+    std::memcpy(&num_cars, receive_buffer.data(), sizeof(num_cars));
+    num_cars = big_endian_to_host_16(num_cars);
+
+    for (uint16_t i = 0; i < num_cars; i++) {
+        size_t car_start = receive_buffer.size();
+        receive_into_buffer(sizeof(uint16_t));
+
+        uint16_t name_length;
+        std::memcpy(&name_length, receive_buffer.data() + car_start, sizeof(name_length));
+        name_length = big_endian_to_host_16(name_length);
+
+        // Nombre, año y precio en un solo recvall
+        receive_into_buffer(name_length + sizeof(uint16_t) + sizeof(uint32_t));
+    }
+
+    return MarketView(receive_buffer.data(), receive_buffer.size());
+}
+
 CarPurchaseDto Protocol::receive_purchase_confirmation() { return deserialize_car_purchase(); }
 
 ErrorDto Protocol::receive_error_notification() { return deserialize_error(); }
 
-std::string Protocol::receive_car_purchase_request() {
+std::pmr::string Protocol::receive_car_purchase_request(std::pmr::memory_resource* resource) {
     uint16_t length;
-    socket.recvall(&length, sizeof(length));
+    recvall(&length, sizeof(length));
     length = big_endian_to_host_16(length);
 
-    std::string car_name(length, '\0');
-    socket.recvall(&car_name[0], length);
+    std::pmr::string car_name(length, '\0', resource);
+    recvall(&car_name[0], length);
     return car_name;
 }
 
-// ==== DESERIALIZACIÓN ====
-UserDto Protocol::deserialize_user() {
-    uint16_t length;
-    socket.recvall(&length, sizeof(length));
-    length = big_endian_to_host_16(length);
+MarketVersionDto Protocol::receive_market_sync_request() { return deserialize_market_version(); }
 
-    std::string username(length, '\0');
-    socket.recvall(&username[0], length);
-    return UserDto(username);
+MarketVersionDto Protocol::receive_market_up_to_date() { return deserialize_market_version(); }
+
+MarketDeltaDto Protocol::receive_market_delta() { return deserialize_market_delta(); }
+
+MarketSnapshotDto Protocol::receive_market_snapshot() { return deserialize_market_snapshot(); }
+
+MarketVersionDto Protocol::receive_market_subscription_request() {
+    return deserialize_market_version();
 }
 
-MoneyDto Protocol::deserialize_money() {
-    uint32_t amount;
-    socket.recvall(&amount, sizeof(amount));
-    amount = big_endian_to_host_32(amount);
-    return MoneyDto(amount);
+MarketDeltaDto Protocol::receive_market_update() { return deserialize_market_delta(); }
+
+MarketEncodingDto Protocol::receive_market_encoding_request() {
+    uint8_t encodings = 0;
+    recvall(&encodings, sizeof(encodings));
+    return MarketEncodingDto(encodings);
 }
 
-CarDto Protocol::deserialize_car() {
-    uint16_t name_length;
-    socket.recvall(&name_length, sizeof(name_length));
-    name_length = big_endian_to_host_16(name_length);
+MarketEncodingDto Protocol::receive_market_encoding() { return receive_market_encoding_request(); }
 
-    std::string name(name_length, '\0');
-    socket.recvall(&name[0], name_length);
+MarketDto Protocol::receive_market_catalog_compact() { return deserialize_market_compact(); }
 
-    uint16_t year;
-    socket.recvall(&year, sizeof(year));
-    year = big_endian_to_host_16(year);
+MarketDto Protocol::receive_market_catalog_columns() { return deserialize_market_columns(); }
 
-    uint32_t price;
-    socket.recvall(&price, sizeof(price));
-    price = big_endian_to_host_32(price);
+// ==== DESERIALIZACIÓN ====
+UserDto Protocol::deserialize_user() {
+    return DtoSerializer<UserDto>::receive(*this, receive_buffer);
+}
 
-    return CarDto(name, year, price);
+MoneyDto Protocol::deserialize_money() {
+    return DtoSerializer<MoneyDto>::receive(*this, receive_buffer);
+}
+
+CarDto Protocol::deserialize_car() {
+    return DtoSerializer<CarDto>::receive(*this, receive_buffer);
 }
 
 MarketDto Protocol::deserialize_market() {
     uint16_t num_cars;
-    socket.recvall(&num_cars, sizeof(num_cars));
+    recvall(&num_cars, sizeof(num_cars));
     num_cars = big_endian_to_host_16(num_cars);
 
     std::vector<CarDto> cars;
@@ -210,25 +899,129 @@ MarketDto Protocol::deserialize_market() {
         cars.push_back(deserialize_car());
     }
 
-    return MarketDto(cars);
+    return MarketDto(std::move(cars));
 }
 
 CarPurchaseDto Protocol::deserialize_car_purchase() {
-    CarDto car = deserialize_car();
+    return DtoSerializer<CarPurchaseDto>::receive(*this, receive_buffer);
+}
 
-    uint32_t remaining_money;
-    socket.recvall(&remaining_money, sizeof(remaining_money));
-    remaining_money = big_endian_to_host_32(remaining_money);
+ErrorDto Protocol::deserialize_error() {
+    return DtoSerializer<ErrorDto>::receive(*this, receive_buffer);
+}
 
-    return CarPurchaseDto(car, remaining_money);
+MarketVersionDto Protocol::deserialize_market_version() {
+    return MarketVersionDto(deserialize_uint32());
 }
 
-ErrorDto Protocol::deserialize_error() {
-    uint16_t length;
-    socket.recvall(&length, sizeof(length));
-    length = big_endian_to_host_16(length);
+MarketDeltaDto Protocol::deserialize_market_delta() {
+    MarketDeltaDto delta;
+    delta.from_version = deserialize_uint32();
+    delta.to_version = deserialize_uint32();
+
+    uint16_t num_added = deserialize_uint16();
+    delta.added.reserve(num_added);
+    for (uint16_t i = 0; i < num_added; i++) {
+        delta.added.push_back(deserialize_car());
+    }
+
+    uint16_t num_removed = deserialize_uint16();
+    delta.removed.reserve(num_removed);
+    for (uint16_t i = 0; i < num_removed; i++) {
+        delta.removed.push_back(deserialize_string());
+    }
+
+    uint16_t num_repriced = deserialize_uint16();
+    delta.repriced.reserve(num_repriced);
+    for (uint16_t i = 0; i < num_repriced; i++) {
+        // Se completa en el lugar para no copiar el nombre
+        PriceChangeDto& change = delta.repriced.emplace_back();
+        change.name = deserialize_string();
+        change.price = deserialize_uint32();
+    }
 
-    std::string message(length, '\0');
-    socket.recvall(&message[0], length);
-    return ErrorDto(message);
+    return delta;
+}
+
+MarketSnapshotDto Protocol::deserialize_market_snapshot() {
+    MarketSnapshotDto snapshot;
+    snapshot.version = deserialize_uint32();
+
+    uint16_t num_cars = deserialize_uint16();
+    snapshot.cars.reserve(num_cars);
+    for (uint16_t i = 0; i < num_cars; i++) {
+        snapshot.cars.push_back(deserialize_car());
+    }
+
+    return snapshot;
+}
+
+MarketDto Protocol::deserialize_market_compact() {
+    std::vector<uint8_t> payload = deserialize_payload();
+
+    MarketDto market;
+    market.cars = CatalogCodec::decode(payload.data(), payload.size());
+    return market;
+}
+
+MarketDto Protocol::deserialize_market_columns() {
+    std::vector<uint8_t> payload = deserialize_payload();
+
+    MarketDto market;
+    market.cars = CatalogCodec::decode_columns(payload.data(), payload.size());
+    return market;
+}
+
+// Payload con largo (4 bytes): se recibe entero con un solo recvall
+std::vector<uint8_t> Protocol::deserialize_payload() {
+    uint32_t size = deserialize_uint32();
+    // El largo viene del otro extremo: no se reserva lo que diga sin acotarlo
+    if (size > MAX_CATALOG_PAYLOAD) {
+        throw std::runtime_error("Catalog payload too large");
+    }
+
+    std::vector<uint8_t> payload(size);
+    recvall(payload.data(), size);
+    return payload;
+}
+
+void Protocol::receive_into_buffer(size_t size) {
+    size_t old_size = receive_buffer.size();
+    receive_buffer.resize(old_size + size);
+    if (size > 0 && recvall(receive_buffer.data() + old_size, size) == 0) {
+        throw std::runtime_error("Connection closed in the middle of a message");
+    }
+}
+
+uint16_t Protocol::deserialize_uint16() {
+    uint16_t value;
+    recvall(&value, sizeof(value));
+    return big_endian_to_host_16(value);
+}
+
+uint32_t Protocol::deserialize_uint32() {
+    uint32_t value;
+    recvall(&value, sizeof(value));
+    return big_endian_to_host_32(value);
+}
+
+std::pmr::string Protocol::deserialize_string() {
+    uint16_t length = deserialize_uint16();
+
+    std::pmr::string str(length, '\0');
+    recvall(&str[0], length);
+    return str;
+}
+
+// ==== REGISTRO DE VUELO ====
+void Protocol::dump_flight_recorder(std::ostream& out) const {
+    recorder.dump(out);
+    if (receiving_message()) {
+        out << "Receiving command 0x" << std::hex << std::setw(2) << std::setfill('0')
+            << static_cast<int>(incoming[0]) << std::dec << std::setfill(' ') << ": "
+            << incoming.size() << " bytes so far" << std::endl;
+    }
+    if (output_bytes > 0) {
+        out << output_bytes << " bytes waiting in the output queue" << std::endl;
+    }
 }
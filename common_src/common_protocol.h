@@ -1,31 +1,58 @@
 #ifndef COMMON_PROTOCOL_H
 #define COMMON_PROTOCOL_H
 
+#include <array>
 #include <cstdint>
 #include <memory>
+#include <memory_resource>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include <arpa/inet.h>
 
+#include "common_constants.h"
+#include "common_flight_recorder.h"
+#include "common_frame_scanner.h"
 #include "common_socket.h"
 
-// DTOs (Data Transfer Objects) - Objetos que entiende el negocio
+/*
+ * DTOs (Data Transfer Objects) - Objetos que entiende el negocio
+ *
+ * Los strings son `std::pmr::string`: por defecto usan el heap como
+ * siempre, pero quien atiende un pedido puede pasarles un memory
+ * resource (p. ej. la arena de la conexión) para no usar `new`.
+ * */
 struct UserDto {
-    std::string username;
+    std::pmr::string username;
 
     UserDto() = default;
-    explicit UserDto(const std::string& name): username(name) {}
+    explicit UserDto(std::string_view name,
+                     std::pmr::memory_resource* resource = std::pmr::get_default_resource()):
+            username(name, resource) {}
 };
 
 struct CarDto {
-    std::string name;
+    std::pmr::string name;
     uint16_t year;
     uint32_t price;  // En centavos
 
     // Aplicando RAII - constructor que inicializa apropiadamente
     CarDto(): name(""), year(0), price(0) {}
-    CarDto(const std::string& n, uint16_t y, uint32_t p): name(n), year(y), price(p) {}
+    CarDto(std::string_view n, uint16_t y, uint32_t p,
+           std::pmr::memory_resource* resource = std::pmr::get_default_resource()):
+            name(n, resource), year(y), price(p) {}
+
+    CarDto(const CarDto&) = default;
+    CarDto(CarDto&&) = default;
+    CarDto& operator=(const CarDto&) = default;
+    CarDto& operator=(CarDto&&) = default;
+
+    // Copia cuyo nombre vive en `resource`
+    CarDto(const CarDto& other, std::pmr::memory_resource* resource):
+            name(other.name, resource), year(other.year), price(other.price) {}
 };
 
 struct MoneyDto {
@@ -40,6 +67,7 @@ struct MarketDto {
 
     MarketDto() = default;
     explicit MarketDto(const std::vector<CarDto>& car_list): cars(car_list) {}
+    explicit MarketDto(std::vector<CarDto>&& car_list): cars(std::move(car_list)) {}
 };
 
 struct CarPurchaseDto {
@@ -47,48 +75,277 @@ struct CarPurchaseDto {
     uint32_t remaining_money;
 
     CarPurchaseDto(): remaining_money(0) {}
-    CarPurchaseDto(const CarDto& c, uint32_t money): car(c), remaining_money(money) {}
+    CarPurchaseDto(const CarDto& c, uint32_t money,
+                   std::pmr::memory_resource* resource = std::pmr::get_default_resource()):
+            car(c, resource), remaining_money(money) {}
+    CarPurchaseDto(CarDto&& c, uint32_t money): car(std::move(c)), remaining_money(money) {}
 };
 
 struct ErrorDto {
-    std::string message;
+    std::pmr::string message;
 
     ErrorDto() = default;
-    explicit ErrorDto(const std::string& msg): message(msg) {}
+    explicit ErrorDto(std::string_view msg,
+                      std::pmr::memory_resource* resource = std::pmr::get_default_resource()):
+            message(msg, resource) {}
+};
+
+// Versión del catálogo que conoce una de las partes (0 = ninguna)
+struct MarketVersionDto {
+    uint32_t version;
+
+    MarketVersionDto(): version(0) {}
+    explicit MarketVersionDto(uint32_t v): version(v) {}
+};
+
+// Codificaciones del catálogo soportadas (pedido) o elegida (respuesta)
+struct MarketEncodingDto {
+    uint8_t encodings;
+
+    MarketEncodingDto(): encodings(MARKET_ENCODING_PLAIN) {}
+    explicit MarketEncodingDto(uint8_t e): encodings(e) {}
+};
+
+/*
+ * Token que emite el server para retomar una sesión (todo en 0: ninguno).
+ * Es aleatorio: quien lo presenta recupera el saldo y el auto de la sesión.
+ * */
+using SessionToken = std::array<uint8_t, 16>;
+
+// Pedido de registro retomando, si todavía existe, la sesión de `token`
+struct SessionResumeDto {
+    SessionToken token;
+    std::pmr::string username;
+
+    SessionResumeDto(): token{} {}
+    SessionResumeDto(const SessionToken& t, std::string_view name): token(t), username(name) {}
+};
+
+// Respuesta: token para la próxima vez y saldo, retomado o inicial
+struct SessionDto {
+    SessionToken token;
+    uint32_t money;
+    uint8_t resumed;
+
+    SessionDto(): token{}, money(0), resumed(0) {}
+    SessionDto(const SessionToken& t, uint32_t m, bool r): token(t), money(m), resumed(r) {}
+};
+
+struct PriceChangeDto {
+    std::pmr::string name;
+    uint32_t price;  // En centavos
+
+    PriceChangeDto(): price(0) {}
+    PriceChangeDto(std::string_view n, uint32_t p): name(n), price(p) {}
+};
+
+// Diferencia neta entre dos versiones del catálogo.
+// Se aplica en orden: removed, added (upsert), repriced.
+struct MarketDeltaDto {
+    uint32_t from_version;
+    uint32_t to_version;
+    std::vector<CarDto> added;
+    std::vector<std::pmr::string> removed;
+    std::vector<PriceChangeDto> repriced;
+
+    MarketDeltaDto(): from_version(0), to_version(0) {}
+};
+
+// Catálogo completo junto con la versión a la que corresponde
+struct MarketSnapshotDto {
+    uint32_t version;
+    std::vector<CarDto> cars;
+
+    MarketSnapshotDto(): version(0) {}
+    MarketSnapshotDto(uint32_t v, const std::vector<CarDto>& car_list):
+            version(v), cars(car_list) {}
+    MarketSnapshotDto(uint32_t v, std::vector<CarDto>&& car_list):
+            version(v), cars(std::move(car_list)) {}
 };
 
 // Buffer para serialización - UN ÚNICO PAQUETE
 class MessageBuffer {
 private:
-    std::vector<uint8_t> buffer;
+    std::pmr::vector<uint8_t> buffer;
 
 public:
-    MessageBuffer() { buffer.reserve(1024); }  // RAII - reserva inicial
+    // La memoria sale del heap salvo que se indique otro resource
+    explicit MessageBuffer(
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource()):
+            buffer(resource) {}
 
     void clear() { buffer.clear(); }
+    void reserve(size_t size) { buffer.reserve(size); }
+
+    // Vacía el buffer y devuelve su memoria al resource
+    void release();
 
     void append_byte(uint8_t value);
     void append_uint16(uint16_t value);
     void append_uint32(uint32_t value);
-    void append_string(const std::string& str);
+    void append_string(std::string_view str);
+    void append_bytes(const void* data, size_t size);
     void append_car(const CarDto& car);
+    void append_market_delta(const MarketDeltaDto& delta);
+
+    // Agrega `size` bytes sin inicializar y retorna dónde escribirlos.
+    // El puntero es válido hasta la próxima operación sobre el buffer.
+    uint8_t* extend(size_t size);
+
+    // Sobrescriben bytes ya agregados (p. ej. un largo que se conoce al final)
+    void patch_byte(size_t offset, uint8_t value);
+    void patch_uint32(size_t offset, uint32_t value);
 
     const uint8_t* data() const { return buffer.data(); }
     size_t size() const { return buffer.size(); }
 };
 
+/*
+ * Cómo sale un `SharedMessage` por la cola de salida:
+ *
+ *   Copy      send común: los bytes se copian al kernel en cada envío
+ *   Sendfile  el mensaje se guarda también en un memfd sellado y sale con
+ *             `sendfile`: el kernel envía las páginas del archivo
+ *   Zerocopy  send con `MSG_ZEROCOPY`: el kernel envía desde el buffer y la
+ *             conexión conserva el mensaje hasta que avisa que lo soltó
+ * */
+enum class MessageTransfer : uint8_t { Copy, Sendfile, Zerocopy };
+
+/*
+ * Mensaje ya armado (comando incluido) que se envía tal cual a muchas
+ * conexiones, p. ej. el catálogo. Es inmutable: se encola en todas sin
+ * copiarlo. Los mensajes chicos, o si no se pudo crear el memfd, salen
+ * por el camino que sigue (Sendfile -> Zerocopy -> Copy).
+ * */
+class SharedMessage {
+private:
+    MessageBuffer message;
+    MessageTransfer transfer;
+    int fd;  // memfd con el mensaje (Sendfile), o -1
+
+    // Por debajo de esto evitar la copia cuesta más de lo que ahorra
+    static const size_t ZERO_COPY_THRESHOLD = 64 * 1024;
+
+public:
+    SharedMessage(MessageBuffer&& message, MessageTransfer transfer);
+
+    const uint8_t* data() const { return message.data(); }
+    size_t size() const { return message.size(); }
+    MessageTransfer get_transfer() const { return transfer; }
+    int get_fd() const { return fd; }
+
+    ~SharedMessage();
+
+    SharedMessage(const SharedMessage&) = delete;
+    SharedMessage& operator=(const SharedMessage&) = delete;
+    SharedMessage(SharedMessage&&) = delete;
+    SharedMessage& operator=(SharedMessage&&) = delete;
+};
+
+class MarketView;
+
+/*
+ * Resultado de `Protocol::receive_available`.
+ *
+ * Los casos comunes (mensaje incompleto, cliente que se desconecta,
+ * mensaje inválido) se informan así en lugar de con excepciones.
+ * */
+enum class ReceiveStatus { Complete, WouldBlock, Closed, Error };
+
 class Protocol {
 private:
     Socket socket;
+    // Se toma del BufferPool en cada mensaje y se devuelve tras enviarlo
     MessageBuffer send_buffer;
+    // Bytes del último mensaje recibido (se reutiliza entre mensajes)
+    std::vector<uint8_t> receive_buffer;
+
+    // Recepción no bloqueante: mensaje en armado (comando + payload),
+    // cuánto de él ya se leyó y si está completo
+    FrameScanner frame_scanner;
+    std::vector<uint8_t> incoming;
+    size_t incoming_offset;
+    bool incoming_ready;
+    // Bytes recibidos desde el principio, y en cuál de ellos empieza `incoming`
+    uint64_t received_total;
+    uint64_t incoming_position;
+    const char* receive_error;  // Motivo del último ReceiveStatus::Error
+    // Comandos de los mensajes del lote recibido (si lo es), en orden
+    std::vector<uint8_t> batch_commands;
+
+    // Entre `begin_batch` y `send_batch_*` los mensajes se juntan acá
+    bool batching;
+    MessageBuffer batch_buffer;
+
+    /*
+     * Últimos mensajes enviados (o encolados) y recibidos: los lotes como
+     * un solo mensaje, salvo en la recepción bloqueante, donde cada
+     * mensaje del lote se registra a medida que se lee.
+     * */
+    FlightRecorder recorder;
+
+    /*
+     * Cola de salida (si está habilitada): mensajes pendientes de envío,
+     * desde `output_head`, del que ya se enviaron `output_offset` bytes.
+     * Los mensajes chicos se agregan al último buffer para salir juntos.
+     * */
+    bool output_queued;
+    size_t output_limit;
+
+    // Un buffer propio o uno compartido (p. ej. el catálogo), que no se copia
+    struct OutputEntry {
+        MessageBuffer owned;
+        std::shared_ptr<const SharedMessage> shared;
+
+        const uint8_t* data() const { return shared ? shared->data() : owned.data(); }
+        size_t size() const { return shared ? shared->size() : owned.size(); }
+    };
+    std::vector<OutputEntry> output_queue;
+    size_t output_head;
+    size_t output_offset;
+    size_t output_bytes;
+    bool output_overflow;
+
+    static const size_t COALESCE_LIMIT = 16 * 1024;
+
+    /*
+     * Envíos con MSG_ZEROCOPY que el kernel todavía usa: por cada tramo de
+     * envíos consecutivos de un mismo mensaje, cuántos falta que confirme.
+     * El mensaje se conserva hasta entonces aunque ya haya salido de la cola.
+     * */
+    enum class ZerocopySupport : uint8_t { Untested, Enabled, Unavailable };
+    ZerocopySupport zerocopy_support;
+    uint32_t zerocopy_next_send;  // Número que el kernel le da al próximo envío
+    struct ZerocopySends {
+        uint32_t first;
+        uint32_t last;
+        uint32_t unconfirmed;
+        std::shared_ptr<const SharedMessage> message;
+    };
+    std::vector<ZerocopySends> zerocopy_sends;
+
+    // Encola un mensaje ya armado (con comando) para flush_output
+    void enqueue_output(const uint8_t* data, size_t size);
+    // Envía sin bloquear hasta `size` bytes de la entrada, desde output_offset
+    IoResult send_output_entry(const OutputEntry& entry, size_t size);
+    IoResult send_zerocopy(const std::shared_ptr<const SharedMessage>& message, size_t size);
+    void reap_zerocopy_sends();
+
+    bool scan_batch();
+    void end_batch(uint8_t command_code);
 
     // Métodos privados de serialización
     void serialize_user(const UserDto& user);
     void serialize_money(const MoneyDto& money);
     void serialize_car(const CarDto& car);
-    void serialize_market(const MarketDto& market);
+    static void serialize_market(const MarketDto& market, MessageBuffer& buffer);
     void serialize_car_purchase(const CarPurchaseDto& purchase);
     void serialize_error(const ErrorDto& error);
+    void serialize_market_version(const MarketVersionDto& version);
+    void serialize_market_delta(const MarketDeltaDto& delta);
+    void serialize_market_snapshot(const MarketSnapshotDto& snapshot);
+    static void serialize_market_compact(const MarketDto& market, MessageBuffer& buffer);
+    static void serialize_market_columns(const MarketDto& market, MessageBuffer& buffer);
 
     // Métodos privados de deserialización
     UserDto deserialize_user();
@@ -97,6 +354,24 @@ private:
     MarketDto deserialize_market();
     CarPurchaseDto deserialize_car_purchase();
     ErrorDto deserialize_error();
+    MarketVersionDto deserialize_market_version();
+    MarketDeltaDto deserialize_market_delta();
+    MarketSnapshotDto deserialize_market_snapshot();
+    MarketDto deserialize_market_compact();
+    MarketDto deserialize_market_columns();
+    std::vector<uint8_t> deserialize_payload();
+
+    // Deja el buffer de envío listo para un mensaje nuevo
+    void begin_message();
+    static const size_t INITIAL_MESSAGE_SIZE = 1024;
+
+    // Agrega al buffer de recepción exactamente `size` bytes del socket
+    void receive_into_buffer(size_t size);
+
+    // Primitivas de lectura (big endian / string con largo de 2 bytes)
+    uint16_t deserialize_uint16();
+    uint32_t deserialize_uint32();
+    std::pmr::string deserialize_string();
 
     // Endianness helpers
     uint16_t host_to_big_endian_16(uint16_t value) { return htons(value); }
@@ -105,6 +380,35 @@ private:
     uint32_t big_endian_to_host_32(uint32_t value) { return ntohl(value); }
 
 public:
+    /*
+     * Largo máximo de un mensaje recibido con `receive_available`. El más
+     * largo que se espera es un lote (SEND_BATCH) y quien lo arma debe
+     * respetarlo: lo que pasa de acá es un error.
+     * */
+    static constexpr size_t MAX_INCOMING_MESSAGE = 256 * 1024;
+
+    /*
+     * Largo máximo del payload de un catálogo compacto o por columnas
+     * (el que sigue a los 4 bytes de largo). 60k autos ocupan ~1.3 MB
+     * por columnas; un largo mayor se rechaza antes de reservar memoria
+     * para recibirlo.
+     * */
+    static constexpr size_t MAX_CATALOG_PAYLOAD = 64 * 1024 * 1024;
+
+    /*
+     * Autos como máximo en el formato plano (`SEND_MARKET_INFO`, snapshots
+     * y deltas), que lleva cada cantidad en 2 bytes. Un catálogo más
+     * grande sólo puede enviarse compacto o por columnas: codificarlo
+     * plano lanza una excepción en lugar de truncar la cantidad.
+     * */
+    static constexpr size_t MAX_PLAIN_CATALOG_CARS = UINT16_MAX;
+
+    /*
+     * Descripción del payload de cada comando (false si no se conoce),
+     * para separar en mensajes un stream de bytes con un `FrameScanner`.
+     * */
+    static bool frame_layout_for(uint8_t command, FrameLayout& layout);
+
     explicit Protocol(Socket&& skt);
 
     // Interfaz descriptiva que trabaja con DTOs
@@ -115,24 +419,178 @@ public:
     void send_purchase_confirmation(const CarPurchaseDto& purchase);
     void send_error_notification(const ErrorDto& error);
 
+    /*
+     * Registro que se puede retomar: en lugar de `send_user_registration`
+     * el cliente presenta el token de su sesión anterior (o uno vacío) y
+     * no necesita esperar la respuesta para enviar sus pedidos.
+     * */
+    void send_session_resume(const SessionResumeDto& resume);
+    void send_session(const SessionDto& session);
+
     // Requests (sin parámetros adicionales)
     void send_current_car_request();
     void send_market_info_request();
-    void send_car_purchase_request(const std::string& car_name);
+    void send_car_purchase_request(std::string_view car_name);
+
+    // Sincronización incremental del catálogo
+    void send_market_sync_request(const MarketVersionDto& known_version);
+    void send_market_up_to_date(const MarketVersionDto& version);
+    void send_market_delta(const MarketDeltaDto& delta);
+    void send_market_snapshot(const MarketSnapshotDto& snapshot);
+
+    // Suscripción: el pedido lleva la versión conocida y la respuesta es
+    // la misma que la de una sincronización
+    void send_market_subscription_request(const MarketVersionDto& known_version);
+
+    // Negociación de codificación y catálogo en formato compacto
+    void send_market_encoding_request(const MarketEncodingDto& supported);
+    void send_market_encoding(const MarketEncodingDto& chosen);
+    void send_market_catalog_compact(const MarketDto& market);
+    void send_market_catalog_columns(const MarketDto& market);
+
+    /*
+     * Arma un mensaje push completo (comando + datos) sin enviarlo, para
+     * serializarlo una sola vez y reenviarlo a todos los suscriptos.
+     * */
+    static void encode_market_update(const MarketDeltaDto& delta, MessageBuffer& message);
+    void send_encoded_message(const MessageBuffer& message);
+
+    /*
+     * Lo mismo para el catálogo completo en la codificación dada. Con la
+     * cola de salida habilitada el mensaje compartido se encola sin
+     * copiarlo: no se debe modificar mientras haya alguien enviándolo.
+     * */
+    static void encode_market_catalog(const MarketDto& market, uint8_t encoding,
+                                      MessageBuffer& message);
+    void send_shared_message(std::shared_ptr<const SharedMessage> message);
+
+    /*
+     * Lotes: entre `begin_batch` y `send_batch_request` (o
+     * `send_batch_reply`) los `send_*` no envían sino que se juntan en
+     * orden, y salen todos como un solo mensaje SEND_BATCH (o
+     * SEND_BATCH_REPLY) con un solo sendall o una sola entrada de la cola.
+     *
+     * Del otro lado, tras leer el comando y `receive_batch_size`, los
+     * mensajes del lote se leen uno por uno como si hubieran llegado
+     * sueltos. Con `receive_available` el lote ya llega validado y sus
+     * comandos quedan en `received_batch_commands`.
+     * */
+    void begin_batch();
+    void send_batch_request();
+    void send_batch_reply();
+    uint32_t receive_batch_size();
+    const std::vector<uint8_t>& received_batch_commands() const { return batch_commands; }
+
+    static bool is_push_message(uint8_t command_code) {
+        return (command_code & PUSH_MESSAGE_FLAG) != 0;
+    }
 
     // Métodos de recepción
     uint8_t receive_command();
     UserDto receive_user_registration();
     MoneyDto receive_initial_balance();
+    SessionResumeDto receive_session_resume();
+    SessionDto receive_session();
     CarDto receive_current_car_info();
     MarketDto receive_market_catalog();
+    // Sin copias: la vista apunta al buffer de recepción (ver common_views.h)
+    MarketView receive_market_catalog_view();
     CarPurchaseDto receive_purchase_confirmation();
     ErrorDto receive_error_notification();
-    std::string receive_car_purchase_request();
+    // El nombre se construye en `resource` (p. ej. la arena del pedido)
+    std::pmr::string receive_car_purchase_request(
+            std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    MarketVersionDto receive_market_sync_request();
+    MarketVersionDto receive_market_up_to_date();
+    MarketDeltaDto receive_market_delta();
+    MarketSnapshotDto receive_market_snapshot();
+    MarketVersionDto receive_market_subscription_request();
+    MarketDeltaDto receive_market_update();
+    MarketEncodingDto receive_market_encoding_request();
+    MarketEncodingDto receive_market_encoding();
+    MarketDto receive_market_catalog_compact();
+    MarketDto receive_market_catalog_columns();
+
+    /*
+     * Recepción no bloqueante, para sockets en ese modo.
+     *
+     * Lee lo que haya disponible del próximo mensaje y retorna `Complete`
+     * cuando ya llegó completo; si no, retorna `WouldBlock` y lo recibido
+     * queda guardado para continuar en la próxima llamada. Con un mensaje
+     * completo, `receive_command` y los `receive_*` lo leen de memoria
+     * sin bloquear.
+     *
+     * Si la conexión se cerró entre mensajes retorna `Closed`; si se cerró
+     * a mitad de un mensaje o el comando no se conoce, `Error` (el motivo
+     * queda en `receive_error_reason`).
+     * */
+    ReceiveStatus receive_available();
+    const char* receive_error_reason() const { return receive_error; }
+    // Comando del mensaje completado por `receive_available`, sin consumirlo
+    uint8_t received_command() const { return incoming[0]; }
+    // Llegó parte de un mensaje pero todavía no está completo
+    bool receiving_message() const { return !incoming_ready && !incoming.empty(); }
+
+    /*
+     * Posiciones en el stream de entrada de `receive_available`: cuántos
+     * bytes se recibieron en total y dónde empieza el mensaje completado
+     * (o en armado). Junto con `pending_input`, lo que todavía espera en
+     * el socket, sirven para saber desde cuándo está ahí un mensaje.
+     * */
+    uint64_t received_bytes() const { return received_total; }
+    uint64_t received_message_position() const { return incoming_position; }
+    size_t pending_input() { return socket.pending_input(); }
+
+    /*
+     * Recibe exactamente `size` bytes: del mensaje completado por
+     * `receive_available` si lo hay, si no del socket. Retorna 0 si la
+     * conexión se cerró antes de recibir algo.
+     * */
+    int recvall(void* data, unsigned int size);
+
+    /*
+     * Cola de salida acotada, para sockets no bloqueantes.
+     *
+     * Una vez habilitada, los `send_*` no envían: dejan el mensaje en la
+     * cola y `flush_output` envía lo que el socket acepte sin bloquear.
+     * Si un mensaje llega con la cola ya ocupada y la hace pasar de
+     * `limit` bytes, `output_overflowed` pasa a ser true (un mensaje
+     * solo, aunque sea más grande, siempre se acepta).
+     *
+     * `flush_output` envía como mucho `max_bytes` por llamada: un mensaje
+     * grande sale en partes, intercalado con el trabajo del resto.
+     * */
+    void enable_output_queue(size_t limit);
+    IoStatus flush_output(size_t max_bytes = SIZE_MAX);
+    size_t pending_output() const { return output_bytes; }
+    bool output_overflowed() const { return output_overflow; }
+    /*
+     * La cola ya se envió pero el kernel todavía no soltó algún mensaje
+     * enviado con MSG_ZEROCOPY. Los avisos llegan como `POLLERR` y se
+     * procesan en `flush_output`. Si la conexión se destruye antes, lo que
+     * quedaba sin enviar se descarta (véase `Socket::discard_unsent_on_close`).
+     * */
+    bool zerocopy_pending() const { return !zerocopy_sends.empty(); }
 
-    // Una sola llamada a sendall por mensaje
+    // Una sola llamada a sendall por mensaje (armado desde begin_message)
     void flush_message(uint8_t command_code);
 
+    /*
+     * Vuelca el registro de vuelo (véase `FlightRecorder`) junto con lo
+     * que quedó a medias: un mensaje recibido en parte y los bytes que
+     * esperan en la cola de salida.
+     * */
+    void dump_flight_recorder(std::ostream& out) const;
+
+    // Retiene los envíos para juntarlos en un paquete (véase `Socket::set_cork`)
+    void set_cork(bool cork) { socket.set_cork(cork); }
+
+    int get_fd() const { return socket.get_fd(); }
+    // Eventos a esperar con `poll` sobre `get_fd` (véase `Socket::prepare_poll`)
+    short prepare_poll(short events) { return socket.prepare_poll(events); }
+
+    ~Protocol();
+
     Protocol(const Protocol&) = delete;
     Protocol& operator=(const Protocol&) = delete;
     Protocol(Protocol&&) = default;
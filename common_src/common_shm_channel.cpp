@@ -0,0 +1,497 @@
+#include "common_shm_channel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "liberror.h"
+
+/*
+ * Un sentido de la conexión. Cada contador lo escribe un solo extremo y
+ * va en su propia línea de caché, para que no se invaliden entre sí.
+ * `head` y `tail` crecen sin volver a cero: la posición en el anillo es
+ * el contador módulo el tamaño.
+ * */
+struct ShmRing {
+    alignas(64) std::atomic<uint64_t> head;  // Lo avanza quien recibe
+    alignas(64) std::atomic<uint64_t> tail;  // Lo avanza quien envía
+    // Quién está por dormir esperando al otro, y qué extremo cerró
+    alignas(64) std::atomic<uint32_t> reader_waiting;
+    std::atomic<uint32_t> writer_waiting;
+    std::atomic<uint32_t> reader_closed;
+    std::atomic<uint32_t> writer_closed;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Shared memory rings need lock-free 64-bit atomics");
+
+namespace {
+
+constexpr uint32_t SHM_MAGIC = 0x53484d31;  // "SHM1"
+constexpr size_t RING_SIZE = 256 * 1024;    // Potencia de 2
+constexpr size_t HEADER_SIZE = 4096;
+
+// rings[0]: cliente -> server, rings[1]: server -> cliente
+struct ShmHeader {
+    uint32_t magic;
+    uint32_t ring_size;
+    ShmRing rings[2];
+};
+
+static_assert(sizeof(ShmHeader) <= HEADER_SIZE, "Shared memory header too big");
+
+constexpr std::chrono::nanoseconds MIN_SPIN{1000};
+constexpr std::chrono::nanoseconds MAX_SPIN{50000};
+
+// fd propio mientras se arma la conexión: se cierra solo si algo falla
+class OwnedFd {
+private:
+    int fd;
+
+public:
+    explicit OwnedFd(int fd): fd(fd) {}
+    int get() const { return fd; }
+    int release() {
+        int released = fd;
+        fd = -1;
+        return released;
+    }
+    ~OwnedFd() {
+        if (fd != -1) {
+            ::close(fd);
+        }
+    }
+
+    OwnedFd(const OwnedFd&) = delete;
+    OwnedFd& operator=(const OwnedFd&) = delete;
+};
+
+socklen_t abstract_address(const char* name, struct sockaddr_un& address) {
+    std::string path = std::string("car-market-") + name;
+    if (path.size() + 1 > sizeof(address.sun_path)) {
+        throw std::runtime_error("Shared memory endpoint name too long");
+    }
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    // Namespace abstracto: empieza con '\0' y no deja un archivo
+    std::memcpy(address.sun_path + 1, path.data(), path.size());
+    return offsetof(struct sockaddr_un, sun_path) + 1 + path.size();
+}
+
+void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+}  // namespace
+
+ShmChannel::ShmChannel(int unix_fd, int wake_fd, int peer_wake_fd, void* memory,
+                       size_t memory_size, bool server_side):
+        unix_fd(unix_fd),
+        wake_fd(wake_fd),
+        peer_wake_fd(peer_wake_fd),
+        poll_fd(-1),
+        memory(memory),
+        memory_size(memory_size),
+        ring_size(RING_SIZE),
+        spin_budget(MAX_SPIN / 2) {
+    ShmHeader* header = static_cast<ShmHeader*>(memory);
+    uint8_t* data = static_cast<uint8_t*>(memory) + HEADER_SIZE;
+    tx = &header->rings[server_side ? 1 : 0];
+    rx = &header->rings[server_side ? 0 : 1];
+    tx_data = data + (server_side ? RING_SIZE : 0);
+    rx_data = data + (server_side ? 0 : RING_SIZE);
+
+    // Los recursos ya son nuestros: si esto falla el destructor no corre
+    try {
+        poll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (poll_fd == -1) {
+            throw LibError(errno, "epoll_create1 failed");
+        }
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        if (epoll_ctl(poll_fd, EPOLL_CTL_ADD, wake_fd, &event) == -1) {
+            throw LibError(errno, "epoll_ctl failed");
+        }
+        // El cierre del otro proceso se ve como EOF en el Unix socket
+        event.events = EPOLLIN | EPOLLRDHUP;
+        if (epoll_ctl(poll_fd, EPOLL_CTL_ADD, unix_fd, &event) == -1) {
+            throw LibError(errno, "epoll_ctl failed");
+        }
+    } catch (...) {
+        if (poll_fd != -1) {
+            ::close(poll_fd);
+        }
+        ::munmap(memory, memory_size);
+        ::close(unix_fd);
+        ::close(wake_fd);
+        ::close(peer_wake_fd);
+        throw;
+    }
+}
+
+int ShmChannel::listen(const char* name) {
+    struct sockaddr_un address;
+    socklen_t length = abstract_address(name, address);
+
+    OwnedFd fd(::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+    if (fd.get() == -1) {
+        throw LibError(errno, "shared memory socket failed");
+    }
+    if (::bind(fd.get(), reinterpret_cast<struct sockaddr*>(&address), length) == -1) {
+        throw LibError(errno, "shared memory bind failed (%s)", name);
+    }
+    if (::listen(fd.get(), 20) == -1) {
+        throw LibError(errno, "shared memory listen failed");
+    }
+    return fd.release();
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::accept(int listen_fd) {
+    OwnedFd unix_fd(::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC));
+    if (unix_fd.get() == -1) {
+        throw LibError(errno, "shared memory accept failed");
+    }
+
+    size_t memory_size = HEADER_SIZE + 2 * RING_SIZE;
+    OwnedFd memfd(memfd_create("car-market-shm", MFD_CLOEXEC));
+    if (memfd.get() == -1) {
+        throw LibError(errno, "memfd_create failed");
+    }
+    if (ftruncate(memfd.get(), memory_size) == -1) {
+        throw LibError(errno, "ftruncate failed");
+    }
+    OwnedFd server_wake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    OwnedFd client_wake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    if (server_wake.get() == -1 || client_wake.get() == -1) {
+        throw LibError(errno, "eventfd failed");
+    }
+
+    void* memory = mmap(nullptr, memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd.get(), 0);
+    if (memory == MAP_FAILED) {
+        throw LibError(errno, "mmap failed");
+    }
+    ShmHeader* header = new (memory) ShmHeader();
+    header->magic = SHM_MAGIC;
+    header->ring_size = RING_SIZE;
+
+    // El memfd y los eventfds viajan al cliente como mensaje de control
+    int fds[3] = {memfd.get(), server_wake.get(), client_wake.get()};
+    char control[CMSG_SPACE(sizeof(fds))];
+    std::memset(control, 0, sizeof(control));
+    char byte = 'S';
+    struct iovec iov = {&byte, 1};
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+
+    if (sendmsg(unix_fd.get(), &msg, MSG_NOSIGNAL) != 1) {
+        int saved_errno = errno;
+        ::munmap(memory, memory_size);
+        throw LibError(saved_errno, "shared memory handshake failed");
+    }
+
+    return std::unique_ptr<ShmChannel>(new ShmChannel(unix_fd.release(), server_wake.release(),
+                                                      client_wake.release(), memory,
+                                                      memory_size, true));
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::connect(const char* name) {
+    struct sockaddr_un address;
+    socklen_t length = abstract_address(name, address);
+
+    OwnedFd unix_fd(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (unix_fd.get() == -1) {
+        throw LibError(errno, "shared memory socket failed");
+    }
+    if (::connect(unix_fd.get(), reinterpret_cast<struct sockaddr*>(&address), length) == -1) {
+        throw LibError(errno, "shared memory connect failed (%s)", name);
+    }
+
+    int fds[3] = {-1, -1, -1};
+    char control[CMSG_SPACE(sizeof(fds))];
+    char byte;
+    struct iovec iov = {&byte, 1};
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t received;
+    do {
+        received = recvmsg(unix_fd.get(), &msg, MSG_CMSG_CLOEXEC);
+    } while (received == -1 && errno == EINTR);
+    if (received == -1) {
+        throw LibError(errno, "shared memory handshake failed");
+    }
+    struct cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    if (received != 1 || cm == nullptr || cm->cmsg_type != SCM_RIGHTS ||
+        cm->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        throw std::runtime_error("Invalid shared memory handshake");
+    }
+    std::memcpy(fds, CMSG_DATA(cm), sizeof(fds));
+    OwnedFd memfd(fds[0]);
+    OwnedFd server_wake(fds[1]);
+    OwnedFd client_wake(fds[2]);
+
+    struct stat info;
+    size_t memory_size = HEADER_SIZE + 2 * RING_SIZE;
+    if (fstat(memfd.get(), &info) == -1 || static_cast<size_t>(info.st_size) != memory_size) {
+        throw std::runtime_error("Invalid shared memory size");
+    }
+    void* memory = mmap(nullptr, memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd.get(), 0);
+    if (memory == MAP_FAILED) {
+        throw LibError(errno, "mmap failed");
+    }
+    const ShmHeader* header = static_cast<const ShmHeader*>(memory);
+    if (header->magic != SHM_MAGIC || header->ring_size != RING_SIZE) {
+        ::munmap(memory, memory_size);
+        throw std::runtime_error("Incompatible shared memory transport");
+    }
+
+    return std::unique_ptr<ShmChannel>(new ShmChannel(unix_fd.release(), client_wake.release(),
+                                                      server_wake.release(), memory,
+                                                      memory_size, false));
+}
+
+size_t ShmChannel::used(uint64_t tail, uint64_t head) const {
+    // El otro proceso escribe los contadores: no se confía en ellos
+    uint64_t bytes = tail - head;
+    if (bytes > ring_size) {
+        throw std::runtime_error("Shared memory ring corrupted");
+    }
+    return bytes;
+}
+
+IoResult ShmChannel::try_send(const void* data, size_t size) {
+    if (tx->reader_closed.load(std::memory_order_acquire)) {
+        return IoResult{IoStatus::Closed, 0};
+    }
+    uint64_t tail = tx->tail.load(std::memory_order_relaxed);
+    uint64_t head = tx->head.load(std::memory_order_acquire);
+    size_t free = ring_size - used(tail, head);
+    if (free == 0) {
+        return IoResult{peer_gone() ? IoStatus::Closed : IoStatus::WouldBlock, 0};
+    }
+
+    // Hasta dos tramos: el final del anillo y el principio
+    size_t count = std::min<size_t>({size, free, UINT32_MAX});
+    size_t start = tail & (ring_size - 1);
+    size_t first = std::min(count, ring_size - start);
+    std::memcpy(tx_data + start, data, first);
+    std::memcpy(tx_data, static_cast<const uint8_t*>(data) + first, count - first);
+    tx->tail.store(tail + count, std::memory_order_release);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (tx->reader_waiting.load(std::memory_order_relaxed) && tx->reader_waiting.exchange(0)) {
+        wake_peer();
+    }
+    return IoResult{IoStatus::Ok, static_cast<unsigned int>(count)};
+}
+
+IoResult ShmChannel::try_send_file(int fd, size_t offset, size_t size) {
+    if (tx->reader_closed.load(std::memory_order_acquire)) {
+        return IoResult{IoStatus::Closed, 0};
+    }
+    uint64_t tail = tx->tail.load(std::memory_order_relaxed);
+    uint64_t head = tx->head.load(std::memory_order_acquire);
+    size_t free = ring_size - used(tail, head);
+    if (free == 0) {
+        return IoResult{peer_gone() ? IoStatus::Closed : IoStatus::WouldBlock, 0};
+    }
+
+    // Un solo tramo contiguo: el resto sale en la próxima llamada
+    size_t start = tail & (ring_size - 1);
+    size_t count = std::min({size, free, ring_size - start});
+    ssize_t n;
+    do {
+        n = pread(fd, tx_data + start, count, offset);
+    } while (n == -1 && errno == EINTR);
+    if (n == -1) {
+        throw LibError(errno, "shared memory pread failed");
+    }
+    if (n == 0) {
+        throw std::runtime_error("shared memory send reached end of file");
+    }
+    tx->tail.store(tail + n, std::memory_order_release);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (tx->reader_waiting.load(std::memory_order_relaxed) && tx->reader_waiting.exchange(0)) {
+        wake_peer();
+    }
+    return IoResult{IoStatus::Ok, static_cast<unsigned int>(n)};
+}
+
+IoResult ShmChannel::try_recv(void* data, size_t size) {
+    uint64_t head = rx->head.load(std::memory_order_relaxed);
+    uint64_t tail = rx->tail.load(std::memory_order_acquire);
+    size_t available = used(tail, head);
+    if (available == 0) {
+        // Lo último que se envió antes de cerrar se entrega igual
+        bool closed = rx->writer_closed.load(std::memory_order_acquire) || peer_gone();
+        tail = rx->tail.load(std::memory_order_acquire);
+        available = used(tail, head);
+        if (available == 0) {
+            return IoResult{closed ? IoStatus::Closed : IoStatus::WouldBlock, 0};
+        }
+    }
+
+    size_t count = std::min<size_t>({size, available, UINT32_MAX});
+    size_t start = head & (ring_size - 1);
+    size_t first = std::min(count, ring_size - start);
+    std::memcpy(data, rx_data + start, first);
+    std::memcpy(static_cast<uint8_t*>(data) + first, rx_data, count - first);
+    rx->head.store(head + count, std::memory_order_release);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (rx->writer_waiting.load(std::memory_order_relaxed) && rx->writer_waiting.exchange(0)) {
+        wake_peer();
+    }
+    return IoResult{IoStatus::Ok, static_cast<unsigned int>(count)};
+}
+
+size_t ShmChannel::pending_input() const {
+    uint64_t head = rx->head.load(std::memory_order_relaxed);
+    uint64_t tail = rx->tail.load(std::memory_order_acquire);
+    return used(tail, head);
+}
+
+bool ShmChannel::ready(short events) const {
+    if (events & POLLIN) {
+        uint64_t head = rx->head.load(std::memory_order_relaxed);
+        uint64_t tail = rx->tail.load(std::memory_order_acquire);
+        if (tail != head || rx->writer_closed.load(std::memory_order_acquire)) {
+            return true;
+        }
+    }
+    if (events & POLLOUT) {
+        uint64_t tail = tx->tail.load(std::memory_order_relaxed);
+        uint64_t head = tx->head.load(std::memory_order_acquire);
+        if (tail - head < ring_size || tx->reader_closed.load(std::memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ShmChannel::arm(short events) {
+    // Primero se descartan los avisos viejos: los que lleguen desde acá quedan
+    uint64_t count;
+    while (::read(wake_fd, &count, sizeof(count)) == -1 && errno == EINTR) {
+    }
+
+    if (events & POLLIN) {
+        rx->reader_waiting.store(1);
+    }
+    if (events & POLLOUT) {
+        tx->writer_waiting.store(1);
+    }
+    // Con la marca ya visible, lo que el otro haga a partir de ahora nos despierta
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return ready(events);
+}
+
+void ShmChannel::wait(short events) {
+    /*
+     * Espera activa adaptativa: si en el último intento alcanzó, la próxima
+     * vez se espera un poco más; si no, menos. Cada tanto se cede el CPU,
+     * que en una máquina con pocos cores puede necesitar el otro proceso.
+     * */
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 1;; i++) {
+        if (ready(events)) {
+            spin_budget = std::min(MAX_SPIN, spin_budget * 2);
+            return;
+        }
+        if (i % 64 == 0) {
+            if (std::chrono::steady_clock::now() - start >= spin_budget) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+        cpu_relax();
+    }
+    spin_budget = std::max(MIN_SPIN, spin_budget / 2);
+
+    while (!arm(events)) {
+        struct pollfd pfd = {poll_fd, POLLIN, 0};
+        if (::poll(&pfd, 1, -1) == -1 && errno != EINTR) {
+            throw LibError(errno, "shared memory poll failed");
+        }
+        if (peer_gone()) {
+            // Los try_* informan el cierre
+            return;
+        }
+    }
+}
+
+short ShmChannel::prepare_poll(short events) {
+    if (events == 0) {
+        return 0;
+    }
+    if (arm(events)) {
+        // Ya se puede avanzar: que `poll` retorne enseguida
+        uint64_t one = 1;
+        ssize_t written = ::write(wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+    return POLLIN;
+}
+
+void ShmChannel::wake_peer() {
+    uint64_t one = 1;
+    ssize_t written = ::write(peer_wake_fd, &one, sizeof(one));
+    (void)written;
+}
+
+bool ShmChannel::peer_gone() const {
+    char byte;
+    ssize_t n = ::recv(unix_fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n == 0 || (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+}
+
+void ShmChannel::shutdown(int how) {
+    if (how == 0 || how == 2) {
+        rx->reader_closed.store(1);
+    }
+    if (how == 1 || how == 2) {
+        tx->writer_closed.store(1);
+    }
+    wake_peer();
+}
+
+ShmChannel::~ShmChannel() {
+    shutdown(2);
+    ::munmap(memory, memory_size);
+    ::close(poll_fd);
+    ::close(unix_fd);
+    ::close(wake_fd);
+    ::close(peer_wake_fd);
+}
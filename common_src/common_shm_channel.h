@@ -0,0 +1,107 @@
+#ifndef COMMON_SHM_CHANNEL_H
+#define COMMON_SHM_CHANNEL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "common_socket.h"
+
+struct ShmRing;
+
+/*
+ * Transporte por memoria compartida, para clientes que corren en la
+ * misma máquina que el server.
+ *
+ * Cada conexión es un memfd con dos anillos SPSC, uno por sentido: quien
+ * envía copia los bytes al anillo y avanza `tail`, quien recibe los copia
+ * afuera y avanza `head`. Mientras ninguno de los dos tenga que esperar
+ * no hay ninguna syscall.
+ *
+ * Para esperar, cada extremo tiene un eventfd: antes de dormir marca en
+ * el anillo qué espera (datos o lugar) y el otro extremo, al escribir o
+ * leer, sólo toca el eventfd si ve la marca. Antes de dormir se espera
+ * activamente un rato que se adapta según haya servido o no: en un
+ * pedido y su respuesta la respuesta suele llegar antes.
+ *
+ * La conexión se arma con un handshake sobre un Unix socket del namespace
+ * abstracto: el server crea el memfd y los eventfds y se los pasa al
+ * cliente con `SCM_RIGHTS`. Ese Unix socket queda abierto sólo para
+ * detectar que el otro proceso terminó sin llegar a cerrar los anillos.
+ * */
+class ShmChannel {
+private:
+    int unix_fd;       // Conexión del handshake
+    int wake_fd;       // eventfd que escribe el otro extremo para despertarnos
+    int peer_wake_fd;  // eventfd del otro extremo
+    int poll_fd;       // epoll con `wake_fd` y `unix_fd`: un solo fd para `poll`
+
+    void* memory;
+    size_t memory_size;
+    ShmRing* tx;
+    ShmRing* rx;
+    uint8_t* tx_data;
+    uint8_t* rx_data;
+    size_t ring_size;
+
+    // Espera activa antes de dormir en `wait`
+    std::chrono::nanoseconds spin_budget;
+
+    ShmChannel(int unix_fd, int wake_fd, int peer_wake_fd, void* memory, size_t memory_size,
+               bool server_side);
+
+    size_t used(uint64_t tail, uint64_t head) const;
+    bool ready(short events) const;
+    bool arm(short events);
+    void wake_peer();
+    bool peer_gone() const;
+
+public:
+    /*
+     * Lado server: `listen` retorna el Unix socket que escucha en `name`
+     * y `accept` arma la conexión con el próximo cliente.
+     * Lado cliente: `connect` se conecta al server que escucha en `name`.
+     *
+     * En caso de error se lanza una excepción.
+     * */
+    static int listen(const char* name);
+    static std::unique_ptr<ShmChannel> accept(int listen_fd);
+    static std::unique_ptr<ShmChannel> connect(const char* name);
+
+    /*
+     * Igual que `Socket::try_sendsome`/`Socket::try_recvsome`: nunca
+     * bloquean. `try_send_file` lee del archivo directamente al anillo.
+     * */
+    IoResult try_send(const void* data, size_t size);
+    IoResult try_send_file(int fd, size_t offset, size_t size);
+    IoResult try_recv(void* data, size_t size);
+    // Bytes en el anillo de recepción que todavía no se leyeron
+    size_t pending_input() const;
+
+    /*
+     * Espera bloqueante hasta poder recibir (`POLLIN`) o enviar
+     * (`POLLOUT`), o hasta que la conexión se cierre.
+     * */
+    void wait(short events);
+
+    /*
+     * Para esperar con `poll` sobre `get_fd`: deja marcado qué se espera
+     * y retorna los eventos a pedir. `get_fd` queda listo para leer
+     * cuando quizás se pueda avanzar; los `try_*` dicen si realmente.
+     * */
+    short prepare_poll(short events);
+    int get_fd() const { return poll_fd; }
+
+    // Lease manpage de `shutdown`: 0 recepción, 1 envío, 2 ambos
+    void shutdown(int how);
+
+    ~ShmChannel();
+
+    ShmChannel(const ShmChannel&) = delete;
+    ShmChannel& operator=(const ShmChannel&) = delete;
+    ShmChannel(ShmChannel&&) = delete;
+    ShmChannel& operator=(ShmChannel&&) = delete;
+};
+
+#endif  // COMMON_SHM_CHANNEL_H
@@ -3,17 +3,26 @@
 #include <string.h>
 #include <errno.h>
 
+#include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/sendfile.h>
 #include <sys/types.h>
+#include <linux/errqueue.h>
 #include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 
 #include "common_socket.h"
+#include "common_shm_channel.h"
 #include "resolver.h"
 #include "liberror.h"
 
 #include <stdexcept>
+#include <utility>
 
 #define STREAM_SEND_CLOSED 0x01
 #define STREAM_RECV_CLOSED 0x02
@@ -29,6 +38,7 @@ Socket::Socket(
     int skt = -1;
     this->closed = true;
     this->stream_status = STREAM_BOTH_CLOSED;
+    this->shm_listener = false;
 
     /*
      * Por cada dirección obtenida tenemos que ver cual es realmente funcional.
@@ -108,6 +118,7 @@ Socket::Socket(const char *servname) {
     int skt = -1;
     this->closed = true;
     this->stream_status = STREAM_BOTH_CLOSED;
+    this->shm_listener = false;
     while (resolver.has_next()) {
         struct addrinfo *addr = resolver.next();
 
@@ -172,12 +183,15 @@ Socket::Socket(const char *servname) {
         }
 
         /*
-         * Ponemos el socket a escuchar. Ese 20 (podría ser otro valor)
-         * indica cuantas conexiones a la espera de ser aceptadas se toleraran
+         * Ponemos el socket a escuchar. SOMAXCONN (el máximo que permite
+         * el OS) indica cuantas conexiones a la espera de ser aceptadas se
+         * toleraran: con una cola chica (p. ej. 20) una ráfaga de clientes
+         * la llena, el kernel descarta los SYN que siguen y esos connect
+         * recién reintentan al segundo.
          *
          * No tiene nada q ver con cuantas conexiones totales el server tendrá.
          * */
-        s = listen(skt, 20);
+        s = listen(skt, SOMAXCONN);
         if (s == -1) {
             continue;
         }
@@ -207,6 +221,8 @@ Socket::Socket(Socket&& other) {
     this->skt = other.skt;
     this->closed = other.closed;
     this->stream_status = other.stream_status;
+    this->shm = std::move(other.shm);
+    this->shm_listener = other.shm_listener;
 
     /* ...pero luego le sacamos al otro socket
      * el ownership del recurso.
@@ -238,14 +254,20 @@ Socket& Socket::operator=(Socket&& other) {
      * el recurso con el que le robaremos al otro socket (`other`)
      * */
     if (not this->closed) {
-        ::shutdown(this->skt, 2);
-        ::close(this->skt);
+        if (this->shm) {
+            this->shm.reset();
+        } else {
+            ::shutdown(this->skt, 2);
+            ::close(this->skt);
+        }
     }
 
     /* Ahora hacemos los mismos pasos que en el move constructor */
     this->skt = other.skt;
     this->closed = other.closed;
     this->stream_status = other.stream_status;
+    this->shm = std::move(other.shm);
+    this->shm_listener = other.shm_listener;
     other.skt = -1;
     other.closed = true;
     other.stream_status = STREAM_BOTH_CLOSED;
@@ -258,7 +280,27 @@ int Socket::recvsome(
         unsigned int sz
     ) {
     chk_skt_or_fail();
+    if (this->shm) {
+        IoResult result = this->shm->try_recv(data, sz);
+        while (result.status == IoStatus::WouldBlock) {
+            this->shm->wait(POLLIN);
+            result = this->shm->try_recv(data, sz);
+        }
+        if (result.status == IoStatus::Closed)
+            stream_status |= STREAM_RECV_CLOSED;
+        return result.bytes;
+    }
+
     int s = recv(this->skt, (char*)data, sz, 0);
+    while (s == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        /*
+         * Socket en modo no bloqueante sin datos disponibles:
+         * esperamos a que lleguen para mantener la semántica bloqueante.
+         * */
+        wait_until_ready(POLLIN);
+        s = recv(this->skt, (char*)data, sz, 0);
+    }
+
     if (s == 0) {
         /*
          * Puede ser o no un error, dependerá del protocolo.
@@ -300,7 +342,24 @@ int Socket::sendsome(
      * Esta en nosotros luego hace el chequeo correspondiente
      * (ver más abajo).
      * */
+    if (this->shm) {
+        IoResult result = this->shm->try_send(data, sz);
+        while (result.status == IoStatus::WouldBlock) {
+            this->shm->wait(POLLOUT);
+            result = this->shm->try_send(data, sz);
+        }
+        if (result.status == IoStatus::Closed)
+            stream_status |= STREAM_SEND_CLOSED;
+        return result.bytes;
+    }
+
     int s = send(this->skt, (char*)data, sz, MSG_NOSIGNAL);
+    while (s == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        /* Véase el comentario en `Socket::recvsome` */
+        wait_until_ready(POLLOUT);
+        s = send(this->skt, (char*)data, sz, MSG_NOSIGNAL);
+    }
+
     if (s == -1) {
         /*
          * Este es un caso especial: cuando enviamos algo pero en el medio
@@ -406,14 +465,292 @@ int Socket::sendall(
     return sz;
 }
 
+IoResult Socket::try_recvsome(
+        void *data,
+        unsigned int sz
+    ) {
+    chk_skt_or_fail();
+    if (this->shm) {
+        IoResult result = this->shm->try_recv(data, sz);
+        if (result.status == IoStatus::Closed)
+            stream_status |= STREAM_RECV_CLOSED;
+        return result;
+    }
+
+    int s = recv(this->skt, (char*)data, sz, 0);
+    if (s == 0) {
+        stream_status |= STREAM_RECV_CLOSED;
+        return IoResult{IoStatus::Closed, 0};
+    } else if (s == -1) {
+        /*
+         * En modo no bloqueante "no hay datos todavía" no es un error:
+         * se informa para que el llamador espere al próximo evento.
+         * */
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return IoResult{IoStatus::WouldBlock, 0};
+
+        /*
+         * Que el otro extremo corte la conexión de golpe (RST) es algo
+         * común y esperable: se informa como un cierre más.
+         * */
+        if (errno == ECONNRESET) {
+            stream_status |= STREAM_RECV_CLOSED;
+            return IoResult{IoStatus::Closed, 0};
+        }
+
+        throw LibError(errno, "socket recv failed");
+    } else {
+        return IoResult{IoStatus::Ok, (unsigned int)s};
+    }
+}
+
+IoResult Socket::try_sendsome(
+        const void *data,
+        unsigned int sz
+    ) {
+    chk_skt_or_fail();
+    if (this->shm) {
+        IoResult result = this->shm->try_send(data, sz);
+        if (result.status == IoStatus::Closed)
+            stream_status |= STREAM_SEND_CLOSED;
+        return result;
+    }
+
+    int s = send(this->skt, (char*)data, sz, MSG_NOSIGNAL);
+    if (s == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return IoResult{IoStatus::WouldBlock, 0};
+
+        /* Véase el comentario sobre "broken pipe" en `Socket::sendsome` */
+        if (errno == EPIPE || errno == ECONNRESET) {
+            stream_status |= STREAM_SEND_CLOSED;
+            return IoResult{IoStatus::Closed, 0};
+        }
+
+        throw LibError(errno, "socket send failed");
+    } else if (s == 0) {
+        stream_status |= STREAM_SEND_CLOSED;
+        return IoResult{IoStatus::Closed, 0};
+    } else {
+        return IoResult{IoStatus::Ok, (unsigned int)s};
+    }
+}
+
+IoResult Socket::try_sendfile(
+        int fd,
+        size_t offset,
+        unsigned int sz
+    ) {
+    chk_skt_or_fail();
+    if (this->shm) {
+        IoResult result = this->shm->try_send_file(fd, offset, sz);
+        if (result.status == IoStatus::Closed)
+            stream_status |= STREAM_SEND_CLOSED;
+        return result;
+    }
+
+    off_t file_offset = offset;
+    ssize_t s = sendfile(this->skt, fd, &file_offset, sz);
+    if (s == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return IoResult{IoStatus::WouldBlock, 0};
+
+        /* Véase el comentario sobre "broken pipe" en `Socket::sendsome` */
+        if (errno == EPIPE || errno == ECONNRESET) {
+            stream_status |= STREAM_SEND_CLOSED;
+            return IoResult{IoStatus::Closed, 0};
+        }
+
+        throw LibError(errno, "socket sendfile failed");
+    } else if (s == 0) {
+        /*
+         * El archivo terminó antes de lo pedido: es un error de quien
+         * llama, no del socket.
+         * */
+        throw std::runtime_error("socket sendfile reached end of file");
+    } else {
+        return IoResult{IoStatus::Ok, (unsigned int)s};
+    }
+}
+
+bool Socket::enable_zerocopy() {
+    chk_skt_or_fail();
+    /* Por memoria compartida siempre hay que copiar al anillo */
+    if (this->shm)
+        return false;
+
+    int one = 1;
+    /*
+     * Kernels viejos (anteriores a 4.14) no lo soportan: no es un error,
+     * simplemente se sigue enviando copiando.
+     * */
+    return setsockopt(this->skt, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+}
+
+IoResult Socket::try_sendsome_zerocopy(
+        const void *data,
+        unsigned int sz,
+        bool& zerocopy_accepted
+    ) {
+    chk_skt_or_fail();
+    zerocopy_accepted = false;
+    if (this->shm)
+        return try_sendsome(data, sz);
+
+    int s = send(this->skt, (char*)data, sz, MSG_NOSIGNAL | MSG_ZEROCOPY);
+    if (s == -1 && errno == ENOBUFS) {
+        /*
+         * Hay demasiados avisos de zerocopy sin leer (lo limita
+         * `optmem_max`): estos bytes salen por el camino común.
+         * */
+        return try_sendsome(data, sz);
+    }
+    if (s == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return IoResult{IoStatus::WouldBlock, 0};
+
+        /* Véase el comentario sobre "broken pipe" en `Socket::sendsome` */
+        if (errno == EPIPE || errno == ECONNRESET) {
+            stream_status |= STREAM_SEND_CLOSED;
+            return IoResult{IoStatus::Closed, 0};
+        }
+
+        throw LibError(errno, "socket send failed");
+    } else if (s == 0) {
+        stream_status |= STREAM_SEND_CLOSED;
+        return IoResult{IoStatus::Closed, 0};
+    } else {
+        zerocopy_accepted = true;
+        return IoResult{IoStatus::Ok, (unsigned int)s};
+    }
+}
+
+bool Socket::try_recv_zerocopy_done(uint32_t& first, uint32_t& last) {
+    chk_skt_or_fail();
+    if (this->shm)
+        return false;
+
+    /*
+     * Los avisos llegan como mensajes de control (`IP_RECVERR`) en la
+     * cola de errores del socket, sin datos.
+     * */
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    while (true) {
+        if (recvmsg(this->skt, &msg, MSG_ERRQUEUE) == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return false;
+            if (errno == EINTR)
+                continue;
+            throw LibError(errno, "socket recvmsg(MSG_ERRQUEUE) failed");
+        }
+
+        struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+        if (cm == nullptr)
+            continue;
+
+        struct sock_extended_err err;
+        memcpy(&err, CMSG_DATA(cm), sizeof(err));
+        if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+            // Otro tipo de error encolado: no nos interesa
+            msg.msg_controllen = sizeof(control);
+            continue;
+        }
+
+        first = err.ee_info;
+        last = err.ee_data;
+        return true;
+    }
+}
+
+void Socket::discard_unsent_on_close() {
+    chk_skt_or_fail();
+    if (this->shm)
+        return;
+
+    struct linger option = {1, 0};
+    if (setsockopt(this->skt, SOL_SOCKET, SO_LINGER, &option, sizeof(option)) == -1)
+        throw LibError(errno, "socket setsockopt(SO_LINGER) failed");
+}
+
+void Socket::set_cork(bool cork) {
+    chk_skt_or_fail();
+    if (this->shm)
+        return;
+
+    int option = cork ? 1 : 0;
+    if (setsockopt(this->skt, IPPROTO_TCP, TCP_CORK, &option, sizeof(option)) == -1)
+        throw LibError(errno, "socket setsockopt(TCP_CORK) failed");
+}
+
+void Socket::set_nonblocking(bool nonblocking) {
+    chk_skt_or_fail();
+    /* Los `try_*` por memoria compartida nunca bloquean */
+    if (this->shm)
+        return;
+
+    int flags = fcntl(this->skt, F_GETFL, 0);
+    if (flags == -1)
+        throw LibError(errno, "socket fcntl(F_GETFL) failed");
+
+    flags = nonblocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    if (fcntl(this->skt, F_SETFL, flags) == -1)
+        throw LibError(errno, "socket fcntl(F_SETFL) failed");
+}
+
+void Socket::wait_until_ready(short events) {
+    struct pollfd pfd = {this->skt, events, 0};
+    while (poll(&pfd, 1, -1) == -1) {
+        if (errno != EINTR)
+            throw LibError(errno, "socket poll failed");
+    }
+}
+
 Socket::Socket(int skt) {
     this->skt = skt;
     this->closed = false;
     this->stream_status = STREAM_BOTH_OPEN;
+    this->shm_listener = false;
+}
+
+Socket::Socket(std::unique_ptr<ShmChannel> shm) {
+    this->skt = shm->get_fd();
+    this->closed = false;
+    this->stream_status = STREAM_BOTH_OPEN;
+    this->shm = std::move(shm);
+    this->shm_listener = false;
+}
+
+Socket Socket::listen_shm(const char *name) {
+    Socket listener(ShmChannel::listen(name));
+    listener.shm_listener = true;
+    return listener;
+}
+
+Socket Socket::connect_shm(const char *name) {
+    return Socket(ShmChannel::connect(name));
+}
+
+std::pair<Socket, Socket> Socket::pair() {
+    int skts[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, skts) == -1)
+        throw LibError(errno, "socketpair failed");
+    return std::pair<Socket, Socket>(Socket(skts[0]), Socket(skts[1]));
 }
 
-Socket Socket::accept() {
+Socket Socket::accept(bool nonblocking) {
     chk_skt_or_fail();
+    /*
+     * Por memoria compartida el handshake arma el canal completo;
+     * sus operaciones ya no bloquean.
+     * */
+    if (this->shm_listener)
+        return Socket(ShmChannel::accept(this->skt));
+
     /*
      * `accept` nos bloqueara hasta que algún cliente se conecte a nosotros
      * y la conexión se establezca.
@@ -426,7 +763,8 @@ Socket Socket::accept() {
      * (`this->skt`) para seguir haciendo más llamadas a `accept`
      * independientemente de que enviemos/recibamos del socket `peer`.
      * */
-    int peer_skt = ::accept(this->skt, nullptr, nullptr);
+    int peer_skt = ::accept4(this->skt, nullptr, nullptr,
+            nonblocking ? SOCK_NONBLOCK : 0);
     if (peer_skt == -1)
         throw LibError(errno, "socket accept failed");
 
@@ -442,7 +780,9 @@ Socket Socket::accept() {
 
 void Socket::shutdown(int how) {
     chk_skt_or_fail();
-    if (::shutdown(this->skt, how) == -1) {
+    if (this->shm) {
+        this->shm->shutdown(how);
+    } else if (::shutdown(this->skt, how) == -1) {
         throw LibError(errno, "socket shutdown failed");
     }
 
@@ -469,17 +809,49 @@ bool Socket::is_stream_recv_closed() const {
     return stream_status & STREAM_RECV_CLOSED;
 }
 
+int Socket::get_fd() const {
+    chk_skt_or_fail();
+    return this->skt;
+}
+
+size_t Socket::pending_input() {
+    chk_skt_or_fail();
+    if (this->shm)
+        return this->shm->pending_input();
+
+    int bytes = 0;
+    if (ioctl(this->skt, FIONREAD, &bytes) == -1)
+        throw LibError(errno, "socket ioctl(FIONREAD) failed");
+    return bytes;
+}
+
+short Socket::prepare_poll(short events) {
+    chk_skt_or_fail();
+    if (this->shm)
+        return this->shm->prepare_poll(events);
+    return events;
+}
+
 int Socket::close() {
     chk_skt_or_fail();
     this->closed = true;
     this->stream_status = STREAM_BOTH_CLOSED;
+    if (this->shm) {
+        /* El canal cierra su propio fd */
+        this->shm.reset();
+        return 0;
+    }
     return ::close(this->skt);
 }
 
 Socket::~Socket() {
     if (not this->closed) {
-        ::shutdown(this->skt, 2);
-        ::close(this->skt);
+        if (this->shm) {
+            this->shm.reset();
+        } else {
+            ::shutdown(this->skt, 2);
+            ::close(this->skt);
+        }
     }
 }
 
@@ -1,6 +1,30 @@
 #ifndef COMMON_SOCKET_H
 #define COMMON_SOCKET_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <utility>
+
+class ShmChannel;
+
+/*
+ * Resultado de una operación de I/O sobre un socket no bloqueante
+ * (véase `Socket::try_sendsome` y `Socket::try_recvsome`).
+ *
+ * `Ok` indica que se transfirieron `bytes` bytes (al menos 1),
+ * `WouldBlock` que por ahora no se puede transferir nada y hay que
+ * esperar a que el socket esté listo (p. ej. con `poll`) y `Closed`
+ * que la conexión se cerró.
+ * */
+enum class IoStatus { Ok, WouldBlock, Closed };
+
+struct IoResult {
+    IoStatus status;
+    unsigned int bytes;
+};
+
 /*
  * TDA Socket.
  * Por simplificación este TDA se enfocará solamente
@@ -12,10 +36,22 @@ class Socket {
     bool closed;
     int stream_status;
 
+    /*
+     * Conexión por memoria compartida (véase `ShmChannel`) o nullptr para
+     * una conexión TCP. Con ella los envíos y recepciones van por los
+     * anillos y `skt` es el fd para `poll` del canal (que es suyo).
+     *
+     * `shm_listener` indica que `skt` escucha conexiones por memoria
+     * compartida en lugar de TCP.
+     * */
+    std::unique_ptr<ShmChannel> shm;
+    bool shm_listener;
+
     /*
      * Construye el socket pasándole directamente el file descriptor.
      * */
     explicit Socket(int skt);
+    explicit Socket(std::unique_ptr<ShmChannel> shm);
 
     /*
      * Checkea que el file descriptor (skt) sea "valido".
@@ -42,6 +78,13 @@ class Socket {
      * */
     void chk_skt_or_fail() const;
 
+    /*
+     * Espera (con `poll`) a que el socket esté listo para `events`.
+     * Lo usan las operaciones bloqueantes cuando el socket está en
+     * modo no bloqueante.
+     * */
+    void wait_until_ready(short events);
+
     public:
 /*
  * Constructores para `Socket` tanto para conectarse a un servidor
@@ -71,6 +114,29 @@ Socket(
 
 explicit Socket(const char *servname);
 
+/*
+ * Par de sockets ya conectados entre sí, dentro del mismo proceso
+ * (lease manpage de `socketpair`, con `AF_UNIX`). Sirve para probar
+ * ambos extremos de una conexión sin red.
+ *
+ * En caso de error se lanza una excepción.
+ * */
+static std::pair<Socket, Socket> pair();
+
+/*
+ * Conexiones por memoria compartida con un proceso de la misma máquina
+ * (véase `ShmChannel`): `listen_shm` crea un socket que escucha en
+ * `name` y cuyo `accept` retorna conexiones por memoria compartida;
+ * `connect_shm` se conecta a él.
+ *
+ * El resto de la interfaz es la misma que para TCP, salvo que
+ * `try_sendfile` copia del archivo a memoria y no hay `MSG_ZEROCOPY`.
+ *
+ * En caso de error se lanza una excepción.
+ * */
+static Socket listen_shm(const char *name);
+static Socket connect_shm(const char *name);
+
 /*
  * Deshabilitamos el constructor por copia y operador asignación por copia
  * ya que no queremos que se puedan copiar objetos `Socket`.
@@ -157,13 +223,98 @@ int recvall(
         unsigned int sz
         );
 
+/*
+ * Versiones para sockets en modo no bloqueante.
+ *
+ * Igual que `sendsome`/`recvsome` transfieren hasta `sz` bytes, pero
+ * en lugar de bloquear o lanzar una excepción cuando no hay nada para
+ * leer (o no hay lugar para escribir), o cuando la conexión se cerró,
+ * lo informan en el `IoResult`. Un reset de la conexión (`ECONNRESET`)
+ * también se informa como `Closed`. Los errores reales siguen lanzando
+ * una excepción.
+ *
+ * Los métodos bloqueantes de más arriba también funcionan en modo no
+ * bloqueante: esperan con `poll` hasta poder completar la operación.
+ * */
+IoResult try_sendsome(
+        const void *data,
+        unsigned int sz
+        );
+IoResult try_recvsome(
+        void *data,
+        unsigned int sz
+        );
+
+/*
+ * Envío sin copiar los datos al kernel, también para modo no bloqueante
+ * (informan igual que `try_sendsome`).
+ *
+ * `Socket::try_sendfile` envía hasta `sz` bytes del archivo `fd` (p. ej.
+ * un memfd) a partir de `offset`: el kernel toma las páginas del archivo
+ * sin pasar por un buffer nuestro. Si el otro extremo cerró, `sendfile`
+ * genera `SIGPIPE` (no acepta `MSG_NOSIGNAL`), así que hay que ignorarla.
+ *
+ * `Socket::try_sendsome_zerocopy` envía con `MSG_ZEROCOPY` (habilitado
+ * antes con `enable_zerocopy`): el kernel usa directamente la memoria de
+ * `data`, que no se debe liberar ni modificar hasta que avise que la
+ * soltó. Cada envío aceptado recibe un número correlativo (desde 0) y
+ * `zerocopy_accepted` queda en true; si el kernel no puede encolar más
+ * avisos los bytes se envían copiándolos y queda en false.
+ *
+ * `Socket::try_recv_zerocopy_done` lee un aviso de la cola de errores del
+ * socket: los envíos `first` a `last` (inclusive) ya no usan su memoria.
+ * Retorna false si no hay avisos pendientes. Mientras haya avisos sin
+ * leer `poll` informa `POLLERR`.
+ *
+ * Lease manpage de `sendfile` y la documentación de `MSG_ZEROCOPY` del kernel.
+ * */
+IoResult try_sendfile(
+        int fd,
+        size_t offset,
+        unsigned int sz
+        );
+bool enable_zerocopy();
+IoResult try_sendsome_zerocopy(
+        const void *data,
+        unsigned int sz,
+        bool& zerocopy_accepted
+        );
+bool try_recv_zerocopy_done(uint32_t& first, uint32_t& last);
+
+/*
+ * Hace que el cierre del socket descarte lo que quede sin enviar (y
+ * envíe un RST) en lugar de seguir enviándolo en segundo plano. Así el
+ * kernel suelta en el cierre la memoria de los envíos con `MSG_ZEROCOPY`.
+ *
+ * Lease manpage de `socket(7)`, `SO_LINGER`.
+ * */
+void discard_unsent_on_close();
+
+/*
+ * Con `cork` en true los envíos se retienen en el kernel hasta juntar un
+ * segmento completo o hasta volver a ponerlo en false, que envía lo
+ * retenido. Sirve para que varios mensajes chicos salgan en un solo
+ * paquete. Por memoria compartida no hace nada.
+ *
+ * Lease manpage de `tcp(7)`, `TCP_CORK`.
+ * */
+void set_cork(bool cork);
+
+/*
+ * Pone al socket en modo no bloqueante (o lo vuelve a bloqueante).
+ *
+ * En caso de error, se lanza una excepción.
+ * */
+void set_nonblocking(bool nonblocking);
+
 /*
  * Acepta una conexión entrante y retorna un nuevo socket
- * construido a partir de ella.
+ * construido a partir de ella. Si `nonblocking` es true, el
+ * nuevo socket ya nace en modo no bloqueante.
  *
  * En caso de error, se lanza una excepción.
  * */
-Socket accept();
+Socket accept(bool nonblocking = false);
 
 /*
  * Cierra la conexión ya sea parcial o completamente.
@@ -179,6 +330,30 @@ void shutdown(int how);
 bool is_stream_send_closed() const;
 bool is_stream_recv_closed() const;
 
+/*
+ * Retorna el file descriptor subyacente para poder esperar eventos
+ * sobre varios sockets a la vez (lease manpage de `poll`).
+ *
+ * El ownership sigue siendo del `Socket`: no se lo debe cerrar.
+ * */
+int get_fd() const;
+
+/*
+ * Bytes recibidos que esperan en el socket a que se los lea (en el
+ * kernel, o en el anillo por memoria compartida).
+ *
+ * Lease manpage de `tcp(7)`, `FIONREAD`.
+ * */
+size_t pending_input();
+
+/*
+ * Eventos a pedirle a `poll` sobre `get_fd` para esperar `events`. Para
+ * TCP son los mismos; por memoria compartida se espera siempre `POLLIN`
+ * (véase `ShmChannel::prepare_poll`) y al despertar hay que intentar
+ * tanto recibir como enviar.
+ * */
+short prepare_poll(short events);
+
 /*
  * Cierra el socket. El cierre no implica un `shutdown`
  * que debe ser llamado explícitamente.
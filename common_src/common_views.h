@@ -0,0 +1,123 @@
+#ifndef COMMON_VIEWS_H
+#define COMMON_VIEWS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+
+#include "common_protocol.h"
+
+/*
+ * Vistas sobre un mensaje ya recibido (formato de SEND_MARKET_INFO).
+ *
+ * No copian nada: apuntan al buffer de recepción del `Protocol` y los
+ * campos numéricos se decodifican recién cuando se los pide. Por eso
+ * solo son válidas hasta la próxima recepción sobre ese `Protocol`;
+ * quien necesite conservar los datos debe llamar a `to_owned()`.
+ *
+ * El `Protocol` ya verificó los largos al recibir, así que las vistas
+ * no vuelven a chequear límites.
+ * */
+class CarView {
+private:
+    const uint8_t* data;  // uint16 largo + nombre + uint16 año + uint32 precio
+
+    uint16_t name_length() const {
+        uint16_t length;
+        std::memcpy(&length, data, sizeof(length));
+        return ntohs(length);
+    }
+
+public:
+    explicit CarView(const uint8_t* data): data(data) {}
+
+    std::string_view name() const {
+        return std::string_view(reinterpret_cast<const char*>(data + sizeof(uint16_t)),
+                                name_length());
+    }
+
+    uint16_t year() const {
+        uint16_t year;
+        std::memcpy(&year, data + sizeof(uint16_t) + name_length(), sizeof(year));
+        return ntohs(year);
+    }
+
+    uint32_t price() const {
+        uint32_t price;
+        std::memcpy(&price, data + 2 * sizeof(uint16_t) + name_length(), sizeof(price));
+        return ntohl(price);
+    }
+
+    // Bytes que ocupa el auto en el mensaje
+    size_t encoded_size() const {
+        return 2 * sizeof(uint16_t) + sizeof(uint32_t) + name_length();
+    }
+
+    CarDto to_owned() const { return CarDto(name(), year(), price()); }
+};
+
+class MarketView {
+private:
+    const uint8_t* data;  // uint16 cantidad + autos
+    const uint8_t* end_position;
+
+public:
+    class iterator {
+    private:
+        const uint8_t* position;
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef CarView value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const CarView* pointer;
+        typedef CarView reference;
+
+        explicit iterator(const uint8_t* position): position(position) {}
+
+        CarView operator*() const { return CarView(position); }
+
+        iterator& operator++() {
+            position += CarView(position).encoded_size();
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator previous = *this;
+            ++(*this);
+            return previous;
+        }
+
+        bool operator==(const iterator& other) const { return position == other.position; }
+        bool operator!=(const iterator& other) const { return position != other.position; }
+    };
+
+    MarketView(const uint8_t* data, size_t size): data(data), end_position(data + size) {}
+
+    uint16_t size() const {
+        uint16_t count;
+        std::memcpy(&count, data, sizeof(count));
+        return ntohs(count);
+    }
+
+    iterator begin() const { return iterator(data + sizeof(uint16_t)); }
+    iterator end() const { return iterator(end_position); }
+
+    MarketDto to_owned() const {
+        std::vector<CarDto> cars;
+        cars.reserve(size());
+        for (const CarView car: *this) {
+            cars.push_back(car.to_owned());
+        }
+        return MarketDto(std::move(cars));
+    }
+};
+
+#endif  // COMMON_VIEWS_H
@@ -0,0 +1,136 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include <poll.h>
+
+#include "../common_src/common_constants.h"
+#include "../common_src/liberror.h"
+
+Replayer::Replayer(const Recording& recording, const std::string& hostname,
+                   const std::string& port, size_t session_count, size_t max_in_flight,
+                   const std::string& mode):
+        recording(recording), mode(mode) {
+    // Todas conectadas antes de empezar, así la medición no incluye los connect
+    sessions.reserve(session_count);
+    for (size_t i = 0; i < session_count; i++) {
+        sessions.push_back(std::make_unique<ReplaySession>(
+                recording, connect_to_server(hostname, port), max_in_flight));
+    }
+}
+
+Socket Replayer::connect_to_server(const std::string& hostname, const std::string& port) {
+    if (hostname == SHM_HOSTNAME) {
+        return Socket::connect_shm(port.c_str());
+    }
+    return Socket(hostname.c_str(), port.c_str());
+}
+
+bool Replayer::run() {
+    auto start = ReplaySession::Clock::now();
+    for (const auto& session: sessions) {
+        session->start();
+    }
+
+    std::vector<struct pollfd> fds;
+    std::vector<ReplaySession*> active;
+    while (true) {
+        fds.clear();
+        active.clear();
+        for (const auto& session: sessions) {
+            if (!session->finished()) {
+                fds.push_back({session->get_fd(), session->poll_events(), 0});
+                active.push_back(session.get());
+            }
+        }
+        if (active.empty()) {
+            break;
+        }
+
+        int timeout = std::chrono::milliseconds(REPLY_TIMEOUT).count();
+        int ready = ::poll(fds.data(), fds.size(), timeout);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw LibError(errno, "poll failed");
+        }
+        if (ready == 0) {
+            throw std::runtime_error("Timed out waiting for the server");
+        }
+
+        for (size_t i = 0; i < active.size(); i++) {
+            if (fds[i].revents != 0) {
+                active[i]->on_ready();
+            }
+        }
+    }
+
+    print_report(ReplaySession::Clock::now() - start);
+    return std::all_of(sessions.begin(), sessions.end(),
+                       [](const auto& session) { return session->mismatches() == 0; });
+}
+
+void Replayer::print_report(std::chrono::duration<double> elapsed) const {
+    size_t requests = 0;
+    size_t replies = 0;
+    size_t pushes = 0;
+    size_t bytes_sent = 0;
+    size_t bytes_received = 0;
+    size_t mismatches = 0;
+    std::vector<ReplaySession::Clock::duration> latencies;
+    for (const auto& session: sessions) {
+        requests += session->requests_sent();
+        replies += session->replies();
+        pushes += session->pushes();
+        bytes_sent += session->bytes_sent();
+        bytes_received += session->received_bytes();
+        mismatches += session->mismatches();
+        latencies.insert(latencies.end(), session->reply_latencies().begin(),
+                         session->reply_latencies().end());
+    }
+    double seconds = std::max(elapsed.count(), 1e-9);
+
+    std::cout << "Replayed " << recording.requests().size() << " requests x " << sessions.size()
+              << " sessions (" << mode << ") in " << std::fixed << std::setprecision(3)
+              << seconds << " s" << std::endl;
+    std::cout << "Requests: " << requests << " (" << std::setprecision(0) << requests / seconds
+              << " requests/s), replies: " << replies << ", pushes: " << pushes << std::endl;
+    std::cout << "Sent " << bytes_sent << " bytes, received " << bytes_received << " bytes ("
+              << std::setprecision(2) << bytes_received / seconds / 1e6 << " MB/s)" << std::endl;
+
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        auto micros = [&latencies](double fraction) {
+            size_t index = static_cast<size_t>(fraction * (latencies.size() - 1));
+            return std::chrono::duration_cast<std::chrono::microseconds>(latencies[index])
+                    .count();
+        };
+        std::cout << "Reply latency: p50 " << micros(0.5) << " us, p99 " << micros(0.99)
+                  << " us, max " << micros(1.0) << " us" << std::endl;
+    }
+
+    size_t listed = 0;
+    size_t differing = 0;
+    for (size_t i = 0; i < sessions.size(); i++) {
+        if (sessions[i]->mismatches() == 0) {
+            continue;
+        }
+        differing++;
+        if (listed < MAX_LISTED_SESSIONS) {
+            std::cout << "Session " << i + 1 << ", " << sessions[i]->first_mismatch()
+                      << std::endl;
+            listed++;
+        }
+    }
+    if (differing > listed) {
+        std::cout << "... and " << differing - listed << " more sessions with mismatches"
+                  << std::endl;
+    }
+    std::cout << "Mismatches: " << mismatches << std::endl;
+}
@@ -0,0 +1,47 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../common_src/common_socket.h"
+
+#include "replay_recording.h"
+#include "replay_session.h"
+
+/*
+ * Reproduce una grabación en `session_count` conexiones a la vez, todas
+ * atendidas desde un único `poll`, e informa por stdout cuánto tardó, la
+ * latencia de las respuestas y si alguna difirió de la grabada.
+ * */
+class Replayer {
+private:
+    // Sin novedades de ninguna sesión por este tiempo, se da por colgado
+    static constexpr std::chrono::seconds REPLY_TIMEOUT{10};
+    // Sesiones con diferencias que se detallan en el informe
+    static constexpr size_t MAX_LISTED_SESSIONS = 5;
+
+    const Recording& recording;
+    std::string mode;
+    std::vector<std::unique_ptr<ReplaySession>> sessions;
+
+    // Con hostname `shm` se conecta por memoria compartida (véase `ShmChannel`)
+    static Socket connect_to_server(const std::string& hostname, const std::string& port);
+    void print_report(std::chrono::duration<double> elapsed) const;
+
+public:
+    // `max_in_flight` pedidos sin respuesta por sesión; 1 es el ritmo grabado
+    Replayer(const Recording& recording, const std::string& hostname, const std::string& port,
+             size_t session_count, size_t max_in_flight, const std::string& mode);
+
+    // Retorna false si alguna respuesta difirió de la grabada
+    bool run();
+
+    Replayer(const Replayer&) = delete;
+    Replayer& operator=(const Replayer&) = delete;
+};
+
+#endif  // REPLAY_H
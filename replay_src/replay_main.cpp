@@ -0,0 +1,42 @@
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include <signal.h>
+
+#include "replay.h"
+#include "replay_recording.h"
+
+int main(int argc, const char* argv[]) {
+    if (argc < 4 || argc > 6) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <hostname> <port> <dump-dir> [lockstep|max] [sessions]" << std::endl;
+        return 1;
+    }
+
+    std::string hostname = argv[1];
+    std::string port = argv[2];
+    std::string dump_dir = argv[3];
+    // lockstep: cada pedido espera la respuesta del anterior, como en la grabación;
+    // max: todos los pedidos seguidos, sin esperar respuestas
+    std::string mode = argc > 4 ? argv[4] : "lockstep";
+    if (mode != "lockstep" && mode != "max") {
+        std::cerr << "Unknown replay mode: " << mode << std::endl;
+        return 1;
+    }
+
+    // Si el server corta la conexión a mitad de un envío se informa como error
+    signal(SIGPIPE, SIG_IGN);
+
+    try {
+        size_t sessions = argc > 5 ? std::stoul(argv[5]) : 1;
+        Recording recording(dump_dir + "/client_0_AtoB.dump", dump_dir + "/client_0_BtoA.dump");
+        Replayer replayer(recording, hostname, port, sessions, mode == "max" ? SIZE_MAX : 1,
+                          mode);
+        return replayer.run() ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,95 @@
+#include "replay_recording.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include "../common_src/common_constants.h"
+#include "../common_src/common_frame_scanner.h"
+#include "../common_src/common_protocol.h"
+
+Recording::Recording(const std::string& requests_dump, const std::string& replies_dump):
+        request_stream(load_hex_dump(requests_dump)),
+        reply_stream(load_hex_dump(replies_dump)),
+        request_messages(split_messages(request_stream, requests_dump)),
+        push_count(0) {
+    for (const RecordedMessage& message: split_messages(reply_stream, replies_dump)) {
+        if (message.command & PUSH_MESSAGE_FLAG) {
+            push_count++;
+        } else {
+            reply_messages.push_back(message);
+        }
+    }
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+std::vector<uint8_t> Recording::load_hex_dump(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open dump: " + filename);
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::vector<uint8_t> bytes;
+    bytes.reserve(text.size() / 2);
+    int high = -1;
+    for (char c: text) {
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            continue;
+        }
+        int value = hex_value(c);
+        if (value == -1) {
+            throw std::runtime_error("Invalid character in dump: " + filename);
+        }
+        if (high == -1) {
+            high = value;
+        } else {
+            bytes.push_back(static_cast<uint8_t>(high << 4 | value));
+            high = -1;
+        }
+    }
+    if (high != -1) {
+        throw std::runtime_error("Odd number of hex digits in dump: " + filename);
+    }
+    return bytes;
+}
+
+std::vector<RecordedMessage> Recording::split_messages(const std::vector<uint8_t>& stream,
+                                                       const std::string& filename) {
+    std::vector<RecordedMessage> messages;
+    FrameScanner scanner;
+    size_t offset = 0;
+    while (offset < stream.size()) {
+        uint8_t command = stream[offset];
+        FrameLayout layout;
+        if (!Protocol::frame_layout_for(command, layout)) {
+            throw std::runtime_error("Unknown command at byte " + std::to_string(offset) +
+                                     " of dump: " + filename);
+        }
+        scanner.start(layout);
+        if (scanner.advance(stream.data() + offset + 1, stream.size() - offset - 1) != 0) {
+            throw std::runtime_error("Truncated message at byte " + std::to_string(offset) +
+                                     " of dump: " + filename);
+        }
+        size_t size = 1 + scanner.parsed_size();
+        messages.push_back(RecordedMessage{offset, size, command});
+        offset += size;
+    }
+    return messages;
+}
+
+size_t Recording::expected_replies() const {
+    return std::min(request_messages.size(), reply_messages.size());
+}
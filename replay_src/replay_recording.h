@@ -0,0 +1,55 @@
+#ifndef REPLAY_RECORDING_H
+#define REPLAY_RECORDING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Un mensaje (comando + payload) dentro de uno de los streams grabados
+struct RecordedMessage {
+    size_t offset;
+    size_t size;
+    uint8_t command;
+};
+
+/*
+ * Tráfico grabado de una sesión: lo que el cliente envió (AtoB) y lo que
+ * recibió (BtoA), cada stream separado en mensajes con el mismo framing
+ * con el que los recibe `Protocol`.
+ *
+ * Los dumps son texto con los bytes en hexadecimal, como los de
+ * `casos/<caso>/client_0_AtoB.dump`; los espacios y saltos de línea se
+ * ignoran. Cada pedido tiene exactamente una respuesta y llegan en orden;
+ * los push del servidor no responden a ningún pedido y quedan aparte.
+ * */
+class Recording {
+private:
+    std::vector<uint8_t> request_stream;
+    std::vector<uint8_t> reply_stream;
+    std::vector<RecordedMessage> request_messages;
+    std::vector<RecordedMessage> reply_messages;  // Sin los push
+    size_t push_count;
+
+    static std::vector<uint8_t> load_hex_dump(const std::string& filename);
+    // Lanza excepción si el stream tiene un comando desconocido o termina a medias
+    static std::vector<RecordedMessage> split_messages(const std::vector<uint8_t>& stream,
+                                                       const std::string& filename);
+
+public:
+    Recording(const std::string& requests_dump, const std::string& replies_dump);
+
+    // Todos los pedidos seguidos, tal como se enviaron
+    const std::vector<uint8_t>& requests_data() const { return request_stream; }
+    const std::vector<RecordedMessage>& requests() const { return request_messages; }
+    const std::vector<RecordedMessage>& replies() const { return reply_messages; }
+    const uint8_t* reply_data(const RecordedMessage& reply) const {
+        return reply_stream.data() + reply.offset;
+    }
+    size_t pushes() const { return push_count; }
+
+    // Respuestas que se esperan al reproducirla (un último pedido puede no tenerla)
+    size_t expected_replies() const;
+};
+
+#endif  // REPLAY_RECORDING_H
@@ -0,0 +1,202 @@
+#include "replay_session.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include <poll.h>
+
+#include "../common_src/common_constants.h"
+#include "../common_src/common_protocol.h"
+
+ReplaySession::ReplaySession(const Recording& recording, Socket&& socket, size_t max_in_flight):
+        recording(recording),
+        socket(std::move(socket)),
+        max_in_flight(std::max<size_t>(max_in_flight, 1)),
+        released(0),
+        sent_bytes(0),
+        scanning(false),
+        replies_received(0),
+        pushes_received(0),
+        bytes_received(0),
+        mismatch_count(0) {
+    this->socket.set_nonblocking(true);
+}
+
+void ReplaySession::start() {
+    release_requests();
+    send_available();
+}
+
+// Hasta dónde del stream de pedidos se puede enviar
+static size_t released_end(const Recording& recording, size_t released) {
+    if (released == 0) {
+        return 0;
+    }
+    const RecordedMessage& last = recording.requests()[released - 1];
+    return last.offset + last.size;
+}
+
+short ReplaySession::poll_events() {
+    short events = POLLIN;
+    if (sent_bytes < released_end(recording, released)) {
+        events |= POLLOUT;
+    }
+    return socket.prepare_poll(events);
+}
+
+void ReplaySession::on_ready() {
+    send_available();
+    receive_available();
+    // Las respuestas recién llegadas habilitan los pedidos siguientes
+    release_requests();
+    send_available();
+}
+
+bool ReplaySession::finished() const {
+    return replies_received >= recording.expected_replies() &&
+           sent_bytes == recording.requests_data().size();
+}
+
+size_t ReplaySession::requests_sent() const {
+    const std::vector<RecordedMessage>& requests = recording.requests();
+    return std::count_if(requests.begin(), requests.end(), [this](const RecordedMessage& m) {
+        return m.offset + m.size <= sent_bytes;
+    });
+}
+
+void ReplaySession::release_requests() {
+    size_t total = recording.requests().size();
+    size_t limit = total;
+    if (total - std::min(total, replies_received) > max_in_flight) {
+        limit = replies_received + max_in_flight;
+    }
+
+    Clock::time_point now = Clock::now();
+    for (; released < limit; released++) {
+        if (released < recording.expected_replies()) {
+            in_flight.push_back(now);
+        }
+    }
+}
+
+void ReplaySession::send_available() {
+    const std::vector<uint8_t>& stream = recording.requests_data();
+    size_t end = released_end(recording, released);
+    while (sent_bytes < end) {
+        IoResult result = socket.try_sendsome(stream.data() + sent_bytes, end - sent_bytes);
+        if (result.status == IoStatus::WouldBlock) {
+            return;
+        }
+        if (result.status == IoStatus::Closed) {
+            throw std::runtime_error("Server closed the connection");
+        }
+        sent_bytes += result.bytes;
+    }
+}
+
+void ReplaySession::receive_available() {
+    while (!finished()) {
+        size_t old_size = incoming.size();
+        incoming.resize(old_size + RECEIVE_CHUNK);
+        IoResult result = socket.try_recvsome(incoming.data() + old_size, RECEIVE_CHUNK);
+        incoming.resize(old_size + (result.status == IoStatus::Ok ? result.bytes : 0));
+
+        if (result.status == IoStatus::WouldBlock) {
+            return;
+        }
+        if (result.status == IoStatus::Closed) {
+            throw std::runtime_error("Server closed the connection before replying");
+        }
+        bytes_received += result.bytes;
+        scan_replies();
+    }
+}
+
+void ReplaySession::scan_replies() {
+    size_t start = 0;
+    while (start < incoming.size()) {
+        const uint8_t* message = incoming.data() + start;
+        size_t available = incoming.size() - start;
+        if (!scanning) {
+            FrameLayout layout;
+            if (!Protocol::frame_layout_for(message[0], layout)) {
+                throw std::runtime_error("Unknown reply received");
+            }
+            scanner.start(layout);
+            scanning = true;
+        }
+        if (scanner.advance(message + 1, available - 1) != 0) {
+            break;
+        }
+
+        size_t size = 1 + scanner.parsed_size();
+        scanning = false;
+        check_reply(message, size);
+        start += size;
+    }
+    // Lo que queda es el principio de la próxima respuesta
+    incoming.erase(incoming.begin(), incoming.begin() + start);
+}
+
+// Igual byte a byte, salvo el token de sesión, que el servidor elige al azar
+static bool same_reply(const uint8_t* expected, size_t expected_size, const uint8_t* received,
+                       size_t received_size) {
+    if (expected_size != received_size) {
+        return false;
+    }
+    size_t skip_from = expected_size;
+    size_t skip_to = expected_size;
+    if (expected[0] == SEND_SESSION_TOKEN && expected_size > sizeof(SessionToken)) {
+        skip_from = 1;
+        skip_to = 1 + sizeof(SessionToken);
+    }
+    return std::memcmp(expected, received, skip_from) == 0 &&
+           std::memcmp(expected + skip_to, received + skip_to, expected_size - skip_to) == 0;
+}
+
+static std::string describe_message(uint8_t command, size_t size) {
+    std::ostringstream text;
+    text << "0x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(command)
+         << std::dec << " (" << size << " bytes)";
+    return text.str();
+}
+
+void ReplaySession::check_reply(const uint8_t* data, size_t size) {
+    if (Protocol::is_push_message(data[0])) {
+        pushes_received++;
+        return;
+    }
+
+    size_t index = replies_received++;
+    if (!in_flight.empty()) {
+        latencies.push_back(Clock::now() - in_flight.front());
+        in_flight.pop_front();
+    }
+
+    std::string difference;
+    if (index >= recording.expected_replies()) {
+        difference = "unexpected reply " + describe_message(data[0], size);
+    } else {
+        const RecordedMessage& expected = recording.replies()[index];
+        const uint8_t* recorded = recording.reply_data(expected);
+        if (!same_reply(recorded, expected.size, data, size)) {
+            difference = "expected " + describe_message(expected.command, expected.size) +
+                         ", received " + describe_message(data[0], size);
+            if (expected.size == size) {
+                size_t at = std::mismatch(recorded, recorded + size, data).first - recorded;
+                difference += ", first difference at byte " + std::to_string(at);
+            }
+        }
+    }
+
+    if (!difference.empty()) {
+        if (mismatch_count == 0) {
+            mismatch = "reply " + std::to_string(index + 1) + ": " + difference;
+        }
+        mismatch_count++;
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef REPLAY_SESSION_H
+#define REPLAY_SESSION_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "../common_src/common_frame_scanner.h"
+#include "../common_src/common_socket.h"
+
+#include "replay_recording.h"
+
+/*
+ * Una conexión que reproduce una `Recording` contra el servidor.
+ *
+ * Envía los pedidos grabados tal cual, con a lo sumo `max_in_flight` sin
+ * respuesta (1 es el ritmo de la grabación: cada pedido sale al llegar la
+ * respuesta del anterior), y compara cada respuesta con la grabada. Los
+ * push que lleguen se cuentan pero no se comparan.
+ *
+ * El socket es no bloqueante: quien la usa la arranca con `start`, espera
+ * con `poll` sobre `get_fd` los eventos de `poll_events` y llama a
+ * `on_ready`.
+ * */
+class ReplaySession {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    static constexpr size_t RECEIVE_CHUNK = 64 * 1024;
+
+    const Recording& recording;
+    Socket socket;
+    size_t max_in_flight;
+
+    // Pedidos habilitados (según las respuestas) y bytes del stream ya enviados
+    size_t released;
+    size_t sent_bytes;
+    // Cuándo se habilitó cada pedido que todavía espera su respuesta
+    std::deque<Clock::time_point> in_flight;
+
+    // Respuesta en armado: empieza en `incoming[0]`
+    std::vector<uint8_t> incoming;
+    FrameScanner scanner;
+    bool scanning;
+
+    size_t replies_received;
+    size_t pushes_received;
+    size_t bytes_received;
+    std::vector<Clock::duration> latencies;
+    size_t mismatch_count;
+    std::string mismatch;  // Descripción de la primera diferencia
+
+    void release_requests();
+    void send_available();
+    void receive_available();
+    void scan_replies();
+    void check_reply(const uint8_t* data, size_t size);
+
+public:
+    ReplaySession(const Recording& recording, Socket&& socket, size_t max_in_flight);
+
+    // Envía los primeros pedidos; las latencias se miden desde acá
+    void start();
+
+    int get_fd() const { return socket.get_fd(); }
+    short poll_events();
+
+    // Envía y recibe lo que se pueda sin bloquear
+    void on_ready();
+    // Ya se enviaron todos los pedidos y llegaron todas las respuestas
+    bool finished() const;
+
+    size_t requests_sent() const;
+    size_t replies() const { return replies_received; }
+    size_t pushes() const { return pushes_received; }
+    size_t bytes_sent() const { return sent_bytes; }
+    size_t received_bytes() const { return bytes_received; }
+    const std::vector<Clock::duration>& reply_latencies() const { return latencies; }
+    size_t mismatches() const { return mismatch_count; }
+    const std::string& first_mismatch() const { return mismatch; }
+
+    ReplaySession(const ReplaySession&) = delete;
+    ReplaySession& operator=(const ReplaySession&) = delete;
+    ReplaySession(ReplaySession&&) = default;
+    ReplaySession& operator=(ReplaySession&&) = delete;
+};
+
+#endif  // REPLAY_SESSION_H
@@ -1,18 +1,42 @@
 #include "server.h"
 
-#include <algorithm>
+#include <cerrno>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <utility>
 
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
 #include "../common_src/common_constants.h"
+#include "../common_src/liberror.h"
+
+// Lo activa SIGUSR1; el loop vuelca los registros de vuelo en la vuelta siguiente
+static volatile sig_atomic_t flight_recorders_requested = 0;
+
+static void request_flight_recorders(int) { flight_recorders_requested = 1; }
+
+static std::optional<Socket> listen_shm_if_available(const std::string& port) {
+    try {
+        return Socket::listen_shm(port.c_str());
+    } catch (const std::exception& e) {
+        std::cerr << "Shared memory listener disabled: " << e.what() << std::endl;
+        return std::nullopt;
+    }
+}
 
-Server::Server(const std::string& port, const std::string& market_file):
-        acceptor_socket(port.c_str()), initial_money(0), client_money(0) {
+Server::Server(const std::string& port, const std::string& market_file, bool multi_client):
+        acceptor_socket(port.c_str()),
+        shm_acceptor_socket(listen_shm_if_available(port)),
+        initial_money(0),
+        multi_client(multi_client),
+        running(true),
+        session_store(SESSION_TTL, MAX_STORED_SESSIONS),
+        load_shedder(SHED_TARGET, SHED_INTERVAL) {
     load_market_data(market_file);
-    client_money = initial_money;
     std::cout << "Server started" << std::endl;
 }
 
@@ -50,131 +74,373 @@ void Server::parse_line(const std::string& line) {
 
         iss >> name >> year >> price;
         // RAII aplicado: constructor apropiado
-        market_cars.emplace_back(name, year, price * 100);  // precio en centavos
+        market.load_car(CarDto(name, year, price * 100));  // precio en centavos
     }
 }
 
+/*
+ * Loop de eventos: un único hilo espera con `poll` sobre los aceptadores
+ * (TCP y memoria compartida), la consola y todas las sesiones. Cada vez que una sesión tiene datos
+ * se atienden los mensajes completos que haya, y sus respuestas se
+ * envían juntas cuando el socket acepta escribir.
+ *
+ * Hay dos carriles: en cada vuelta primero se atienden los pedidos chicos
+ * (compras, auto actual, ...) de todas las sesiones, y recién después, a
+ * lo sumo uno por sesión, los que responden con el catálogo entero. Los
+ * envíos grandes salen en partes de `SEND_CHUNK`, así una compra no
+ * espera detrás de los catálogos de los demás.
+ *
+ * En modo de un solo cliente los aceptadores dejan de escucharse tras el
+ * primer `accept` y el loop termina cuando ese cliente se desconecta; en
+ * ese modo no hay consola y stdin no se lee.
+ *
+ * SIGUSR1 interrumpe el `poll` y vuelca por stderr los registros de vuelo
+ * de todas las sesiones, aun sin consola.
+ * */
 void Server::run() {
-    Socket client_socket = acceptor_socket.accept();
-    Protocol protocol(std::move(client_socket));
+    bool accepting = true;
+    // La consola (stdin) sólo se escucha en modo multi
+    bool console_open = multi_client;
+    bool shedding = false;
+    LoadShedder::Clock::time_point last_wakeup = LoadShedder::Clock::now();
 
-    try {
-        // PRIMERO: manejar registro de usuario
-        handle_user_registration(protocol);
-
-        // LUEGO: procesar comandos del negocio
-        while (true) {
-            uint8_t command = protocol.receive_command();
-
-            switch (command) {
-                case GET_CURRENT_CAR:
-                    handle_current_car_request(protocol);
-                    break;
-                case GET_MARKET_INFO:
-                    handle_market_info_request(protocol);
-                    break;
-                case BUY_CAR:
-                    handle_car_purchase_request(protocol);
-                    break;
-                default:
-                    std::cerr << "Unknown command received: 0x" << std::hex << (int)command
-                              << std::dec << std::endl;
-                    break;
+    struct sigaction action = {};
+    action.sa_handler = request_flight_recorders;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGUSR1, &action, nullptr) == -1) {
+        throw LibError(errno, "sigaction failed");
+    }
+
+    while (running && (accepting || !sessions.empty())) {
+        if (flight_recorders_requested) {
+            flight_recorders_requested = 0;
+            dump_flight_recorders();
+        }
+
+        // Se reutiliza entre vueltas para no reservar memoria por cada pedido
+        std::vector<struct pollfd>& fds = poll_fds;
+        fds.clear();
+
+        // Primero las sesiones, así sus índices coinciden con `sessions`
+        for (const auto& session: sessions) {
+            short events = 0;
+            if (!session->is_input_closed() && session->pending_output() < OUTPUT_THROTTLE) {
+                events |= POLLIN;
+            }
+            if (session->pending_output() > 0) {
+                events |= POLLOUT;
             }
+            fds.push_back({session->get_fd(), session->prepare_poll(events), 0});
         }
-    } catch (const std::exception& e) {
-        std::string error_msg = e.what();
-        if (error_msg.find("Client disconnected") != std::string::npos) {
-            std::cerr << "Server connection ended: Client disconnected" << std::endl;
-        } else {
-            std::cerr << "Server connection ended: " << e.what() << std::endl;
+        size_t console_index = fds.size();
+        fds.push_back({console_open ? STDIN_FILENO : -1, POLLIN, 0});
+        size_t acceptor_index = fds.size();
+        fds.push_back({accepting ? acceptor_socket.get_fd() : -1, POLLIN, 0});
+        // Sin escucha por memoria compartida queda en -1, que `poll` ignora
+        bool shm_accepting = accepting && shm_acceptor_socket.has_value();
+        fds.push_back({shm_accepting ? shm_acceptor_socket->get_fd() : -1, POLLIN, 0});
+
+        /*
+         * Primero sin esperar: lo que ya está listo llegó mientras se
+         * atendía la vuelta anterior, y esperó desde `last_wakeup`. Si no
+         * hay nada se bloquea (hasta el próximo plazo que venza) y lo que
+         * llegue se ve en cuanto llega.
+         * */
+        bool blocked = false;
+        int ready = ::poll(fds.data(), fds.size(), 0);
+        if (ready == 0) {
+            blocked = true;
+            int timeout = timers.next_timeout_ms(TimerWheel::Clock::now());
+            ready = ::poll(fds.data(), fds.size(), timeout);
         }
-    }
-}
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw LibError(errno, "poll failed");
+        }
+        LoadShedder::Clock::time_point now = LoadShedder::Clock::now();
+        LoadShedder::Clock::time_point arrived_since = blocked ? now : last_wakeup;
+        last_wakeup = now;
+        timers.advance(now);
 
-// ==== HANDLERS QUE TRABAJAN CON DTOs ====
+        // Carril prioritario; las sesiones terminadas quedan en nullptr
+        bulk_ready.clear();
+        for (size_t i = 0; i < sessions.size(); i++) {
+            bool bulk_pending = false;
+            bool finished = false;
+            if (fds[i].revents != 0 || sessions[i]->output_overflowed() ||
+                sessions[i]->timed_out()) {
+                serve_session(*sessions[i], fds[i].revents, arrived_since, bulk_pending,
+                              finished);
+            }
+            if (finished) {
+                sessions[i].reset();
+            } else if (bulk_pending) {
+                bulk_ready.push_back(i);
+            }
+        }
+
+        // Carril masivo
+        for (size_t i: bulk_ready) {
+            bool finished = false;
+            serve_bulk_request(*sessions[i], finished);
+            if (finished) {
+                sessions[i].reset();
+            }
+        }
+
+        // Se compactan en el lugar las sesiones que siguen vivas
+        size_t alive = 0;
+        for (size_t i = 0; i < sessions.size(); i++) {
+            if (sessions[i]) {
+                if (alive != i) {
+                    sessions[alive] = std::move(sessions[i]);
+                }
+                alive++;
+            }
+        }
+        sessions.resize(alive);
+
+        if (load_shedder.is_shedding() != shedding) {
+            shedding = load_shedder.is_shedding();
+            std::cout << (shedding ? "Overload: shedding market requests" : "Overload cleared")
+                      << std::endl;
+        }
 
-void Server::handle_user_registration(Protocol& protocol) {
-    uint8_t first_command = protocol.receive_command();
+        if (fds[console_index].revents != 0) {
+            console_open = read_console();
+        }
 
-    if (first_command != SEND_USERNAME) {
-        throw std::runtime_error("Expected username as first message");
+        for (size_t i = acceptor_index; accepting && i < acceptor_index + 2; i++) {
+            if (fds[i].revents != 0) {
+                accept_client(i == acceptor_index ? acceptor_socket : *shm_acceptor_socket);
+                accepting = multi_client;
+            }
+        }
     }
+}
 
-    // NUEVO: Recibir como DTO
-    UserDto user = protocol.receive_user_registration();
-    client_username = user.username;
-    std::cout << "Hello, " << client_username << std::endl;
+void Server::accept_client(Socket& acceptor) {
+    // No bloqueante: un cliente que manda medio mensaje no frena al resto
+    Socket client_socket = acceptor.accept(true);
+    sessions.push_back(std::make_unique<ClientSession>(std::move(client_socket), market,
+                                                       broadcaster, load_shedder, initial_money,
+                                                       MAX_OUTPUT, timers, TIMEOUTS,
+                                                       session_store));
+}
 
-    // NUEVO: Enviar dinero como DTO
-    MoneyDto initial_balance(initial_money);
-    protocol.send_initial_balance(initial_balance);
-    std::cout << "Initial balance: " << initial_money << std::endl;
+void Server::end_session(const char* reason, bool& finished) {
+    std::cerr << "Server connection ended: " << reason << std::endl;
+    finished = true;
+}
 
-    client_money = initial_money;
+void Server::fail_session(ClientSession& session, const char* reason, bool& finished) {
+    end_session(reason, finished);
+    session.dump_flight_recorder(std::cerr);
 }
 
-void Server::handle_current_car_request(Protocol& protocol) {
-    if (client_current_car.has_value()) {
-        // NUEVO: Enviar auto como DTO
-        protocol.send_current_car_info(client_current_car.value());
+void Server::serve_session(ClientSession& session, short revents,
+                           LoadShedder::Clock::time_point arrived_since, bool& bulk_pending,
+                           bool& finished) {
+    if (session.idle_timed_out()) {
+        end_session(session.timeout_reason(), finished);
+        return;
+    }
+    if (session.timed_out()) {
+        fail_session(session, session.timeout_reason(), finished);
+        return;
+    }
 
-        // Mostrar precio en pesos (dividir por 100)
-        std::cout << "Car " << client_current_car->name << " " << (client_current_car->price / 100)
-                  << " " << client_current_car->year << " sent" << std::endl;
-    } else {
-        // NUEVO: Enviar error como DTO
-        ErrorDto error("No car bought");
-        protocol.send_error_notification(error);
-        std::cout << "Error: No car bought" << std::endl;
+    try {
+        bool readable = (revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+        bool drained = !readable;
+        for (int i = 0; readable && !session.is_input_closed() && i < MAX_MESSAGES_PER_EVENT &&
+                        session.pending_output() < OUTPUT_THROTTLE;
+             i++) {
+            // Cada pedido se mide aparte: lo que sigue en el socket llegó desde esta vuelta
+            session.mark_readable(arrived_since);
+            ReceiveStatus status = session.receive_next_message();
+            if (status == ReceiveStatus::WouldBlock) {
+                drained = true;
+                break;
+            }
+            if (status == ReceiveStatus::Closed) {
+                // Lo que ya se le respondió se le termina de enviar
+                session.close_input();
+            } else if (status == ReceiveStatus::Error) {
+                fail_session(session, session.error_reason(), finished);
+                return;
+            } else if (session.received_bulk_request()) {
+                // Se atiende en el carril masivo, cuando ya respondieron todos
+                bulk_pending = true;
+                break;
+            } else {
+                session.handle_received_message();
+            }
+        }
+
+        // Si no se le lee más es por no leer sus respuestas: esa espera no es sobrecarga
+        if (session.pending_output() >= OUTPUT_THROTTLE) {
+            session.clear_readable();
+        } else if (!drained && !session.is_input_closed()) {
+            session.note_backlog(arrived_since);
+        }
+
+        if (!bulk_pending) {
+            flush_session(session, finished);
+        }
+    } catch (const std::exception& e) {
+        fail_session(session, e.what(), finished);
     }
 }
 
-void Server::handle_market_info_request(Protocol& protocol) {
-    // NUEVO: Enviar market como DTO
-    MarketDto market(market_cars);
-    protocol.send_market_catalog(market);
-    std::cout << market_cars.size() << " cars sent" << std::endl;
+void Server::serve_bulk_request(ClientSession& session, bool& finished) {
+    try {
+        session.handle_received_message();
+        flush_session(session, finished);
+    } catch (const std::exception& e) {
+        fail_session(session, e.what(), finished);
+    }
 }
 
-void Server::handle_car_purchase_request(Protocol& protocol) {
-    // NUEVO: Recibir nombre del auto directamente (no como DTO porque es un parámetro simple)
-    std::string car_name = protocol.receive_car_purchase_request();
-
-    const CarDto* car = find_car_by_name(car_name);
-    if (car == nullptr) {
-        ErrorDto error("Car not found");
-        protocol.send_error_notification(error);
-        std::cout << "Error: Car not found" << std::endl;
+void Server::flush_session(ClientSession& session, bool& finished) {
+    if (session.output_overflowed()) {
+        fail_session(session, "Output queue limit exceeded", finished);
         return;
     }
 
-    // Verificar fondos (convertir precio a pesos para comparar)
-    if (client_money < (car->price / 100)) {
-        ErrorDto error("Insufficient funds");
-        protocol.send_error_notification(error);
-        std::cout << "Error: Insufficient funds" << std::endl;
+    // Todas las respuestas de esta vuelta salen juntas (hasta SEND_CHUNK bytes);
+    // también se leen los avisos de MSG_ZEROCOPY, que despiertan con POLLERR
+    bool flushing = session.pending_output() > 0 || session.zerocopy_pending();
+    if (flushing && session.flush_output(SEND_CHUNK) == IoStatus::Closed) {
+        end_session("Client disconnected", finished);
         return;
     }
 
-    // Comprar el auto - trabajar en pesos
-    client_money -= (car->price / 100);
-    client_current_car = *car;
+    // Cerrar antes de que el kernel suelte los envíos con MSG_ZEROCOPY los descartaría
+    if (session.is_input_closed() && session.pending_output() == 0 &&
+        !session.zerocopy_pending()) {
+        end_session("Client disconnected", finished);
+    }
+}
+
+// ==== CONSOLA ====
+
+bool Server::read_console() {
+    char buf[512];
+    ssize_t n = ::read(STDIN_FILENO, buf, sizeof(buf));
+    if (n <= 0) {
+        // Sin consola (stdin cerrado): se sigue atendiendo a los clientes
+        return false;
+    }
 
-    // NUEVO: Enviar confirmación como DTO
-    CarPurchaseDto purchase(*car, client_money);
-    protocol.send_purchase_confirmation(purchase);
+    console_input.append(buf, n);
 
-    std::cout << "New cars name: " << car->name << " --- remaining balance: " << client_money
-              << std::endl;
+    size_t end;
+    while ((end = console_input.find('\n')) != std::string::npos) {
+        std::string line = console_input.substr(0, end);
+        console_input.erase(0, end + 1);
+        if (!line.empty()) {
+            execute_console_command(line);
+        }
+    }
+    return true;
 }
 
-const CarDto* Server::find_car_by_name(const std::string& name) const {
-    auto it = std::find_if(market_cars.begin(), market_cars.end(),
-                           [&name](const CarDto& car) { return car.name == name; });
+/*
+ * Comandos de consola (mismo formato que el archivo de mercado):
+ *   car <name> <year> <price>   agrega o reemplaza un auto
+ *   price <name> <price>        cambia el precio de un auto
+ *   remove <name>               quita un auto del catálogo
+ *   shed <target> <interval>    ajusta el control de sobrecarga (en ms;
+ *                               target 0 lo desactiva)
+ *   load                        muestra las estadísticas de carga
+ *   transfer <mode>             cómo se envía el catálogo codificado:
+ *                               copy, sendfile o zerocopy
+ *   frames                      vuelca por stderr los últimos mensajes de
+ *                               cada sesión (véase `FlightRecorder`)
+ *   q                           termina el server (modo multi cliente)
+ * */
+void Server::execute_console_command(const std::string& line) {
+    std::istringstream iss(line);
+    std::string command;
+    iss >> command;
+
+    uint32_t previous_version = market.version();
+
+    if (command == "q") {
+        running = false;
+    } else if (command == "car") {
+        std::string name;
+        uint16_t year;
+        uint32_t price;
+        if (iss >> name >> year >> price) {
+            market.add_car(CarDto(name, year, price * 100));  // precio en centavos
+        }
+    } else if (command == "price") {
+        std::string name;
+        uint32_t price;
+        if (iss >> name >> price && !market.reprice_car(name, price * 100)) {
+            std::cerr << "Unknown car: " << name << std::endl;
+        }
+    } else if (command == "remove") {
+        std::string name;
+        if (iss >> name && !market.remove_car(name)) {
+            std::cerr << "Unknown car: " << name << std::endl;
+        }
+    } else if (command == "shed") {
+        unsigned target_ms;
+        unsigned interval_ms;
+        if (iss >> target_ms >> interval_ms && interval_ms > 0) {
+            load_shedder.configure(std::chrono::milliseconds(target_ms),
+                                   std::chrono::milliseconds(interval_ms));
+        }
+    } else if (command == "load") {
+        print_load_stats();
+    } else if (command == "frames") {
+        dump_flight_recorders();
+    } else if (command == "transfer") {
+        std::string mode;
+        iss >> mode;
+        if (mode == "copy") {
+            market.set_transfer(MessageTransfer::Copy);
+        } else if (mode == "sendfile") {
+            market.set_transfer(MessageTransfer::Sendfile);
+        } else if (mode == "zerocopy") {
+            market.set_transfer(MessageTransfer::Zerocopy);
+        } else {
+            std::cerr << "Unknown transfer mode: " << mode << std::endl;
+        }
+    } else {
+        std::cerr << "Unknown console command: " << command << std::endl;
+    }
+
+    publish_changes_since(previous_version);
+}
+
+void Server::publish_changes_since(uint32_t previous_version) {
+    MarketDeltaDto delta;
+    if (market.version() == previous_version ||
+        !market.build_delta_since(previous_version, delta)) {
+        return;
+    }
+
+    size_t delivered = broadcaster.publish(delta);
+    std::cout << "Market version " << market.version() << " pushed to " << delivered
+              << " subscribers" << std::endl;
+}
+
+void Server::print_load_stats() {
+    const LoadShedder::Stats& stats = load_shedder.get_stats();
+    auto max_delay = std::chrono::duration_cast<std::chrono::microseconds>(stats.max_delay);
+    std::cout << "Load: " << stats.requests << " requests, " << stats.shed
+              << " shed, max delay " << max_delay.count() << " us" << std::endl;
+}
 
-    if (it != market_cars.end()) {
-        return &(*it);
+void Server::dump_flight_recorders() {
+    std::cerr << "Flight recorders of " << sessions.size() << " sessions" << std::endl;
+    for (const auto& session: sessions) {
+        session->dump_flight_recorder(std::cerr);
     }
-    return nullptr;
 }
@@ -2,43 +2,118 @@
 #define SERVER_H
 
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
 
+#include <poll.h>
+
 #include "../common_src/common_protocol.h"
 #include "../common_src/common_socket.h"
 
+#include "server_load_shedder.h"
+#include "server_market_broadcaster.h"
+#include "server_market_catalog.h"
+#include "server_session.h"
+#include "server_session_store.h"
+#include "server_timer_wheel.h"
+
 class Server {
 private:
     Socket acceptor_socket;
-    std::vector<CarDto> market_cars;
+    /*
+     * Clientes en la misma máquina: memoria compartida (véase
+     * `ShmChannel`). Es opcional: si no se puede escuchar así, se atiende
+     * sólo por TCP.
+     * */
+    std::optional<Socket> shm_acceptor_socket;
+    MarketCatalog market;
+    MarketBroadcaster broadcaster;
     uint32_t initial_money;
 
-    std::string client_username;
-    uint32_t client_money;
-    std::optional<CarDto> client_current_car;
+    // Si es false se atiende un único cliente y el server termina con él
+    bool multi_client;
+    bool running;
+
+    /*
+     * Límites de la cola de salida de cada sesión: pasado `OUTPUT_THROTTLE`
+     * no se le leen más pedidos hasta que vacíe la cola; si aun así la
+     * cola (p. ej. con pushes del mercado) supera `MAX_OUTPUT` se lo
+     * desconecta. Un cliente lento no frena ni hace crecer sin límite
+     * la memoria del resto.
+     * */
+    static constexpr size_t MAX_OUTPUT = 8 * 1024 * 1024;
+    static constexpr size_t OUTPUT_THROTTLE = 256 * 1024;
+    // Pedidos atendidos como máximo por evento, para no acaparar el loop
+    static constexpr int MAX_MESSAGES_PER_EVENT = 16;
+    // Bytes enviados como máximo por sesión en cada vuelta
+    static constexpr size_t SEND_CHUNK = 256 * 1024;
+
+    /*
+     * Un cliente que se conecta y no se registra, que deja un mensaje a
+     * medias o que no pide nada por mucho tiempo libera su lugar.
+     * */
+    static constexpr SessionTimeouts TIMEOUTS{std::chrono::seconds(10), std::chrono::seconds(10),
+                                              std::chrono::minutes(5)};
+
+    // Plazos de todas las sesiones; declarada antes para sobrevivirlas
+    TimerWheel timers;
+
+    /*
+     * Sesiones que un cliente puede retomar al reconectarse sin volver a
+     * registrarse (véase `SessionStore`); también sobrevive a las sesiones.
+     * */
+    static constexpr std::chrono::minutes SESSION_TTL{10};
+    static constexpr size_t MAX_STORED_SESSIONS = 100000;
+    SessionStore session_store;
+
+    /*
+     * Control de sobrecarga (véase `LoadShedder`): espera máxima tolerada
+     * de un pedido y ventana para considerarla sostenida. Se ajustan en
+     * caliente con el comando `shed` de la consola.
+     * */
+    static constexpr std::chrono::milliseconds SHED_TARGET{5};
+    static constexpr std::chrono::milliseconds SHED_INTERVAL{100};
+    LoadShedder load_shedder;
+    std::vector<std::unique_ptr<ClientSession>> sessions;
+    std::vector<struct pollfd> poll_fds;
+    // Sesiones con un pedido del carril masivo pendiente en esta vuelta
+    std::vector<size_t> bulk_ready;
+    std::string console_input;
 
     void load_market_data(const std::string& filename);
     void parse_line(const std::string& line);
 
-    // Handlers que trabajan con DTOs
-    void handle_user_registration(Protocol& protocol);
-    void handle_current_car_request(Protocol& protocol);
-    void handle_market_info_request(Protocol& protocol);
-    void handle_car_purchase_request(Protocol& protocol);
+    void accept_client(Socket& acceptor);
+    void serve_session(ClientSession& session, short revents,
+                       LoadShedder::Clock::time_point arrived_since, bool& bulk_pending,
+                       bool& finished);
+    void serve_bulk_request(ClientSession& session, bool& finished);
+    void flush_session(ClientSession& session, bool& finished);
+    void end_session(const char* reason, bool& finished);
+    // Termina por una falla: además vuelca los últimos mensajes de la sesión
+    void fail_session(ClientSession& session, const char* reason, bool& finished);
 
-    const CarDto* find_car_by_name(const std::string& name) const;
+    // Consola (stdin): permite modificar el catálogo en caliente
+    bool read_console();
+    void execute_console_command(const std::string& line);
+    void publish_changes_since(uint32_t previous_version);
+    void print_load_stats();
+    // Registro de vuelo de todas las sesiones (comando `frames` o SIGUSR1)
+    void dump_flight_recorders();
 
 public:
-    explicit Server(const std::string& port, const std::string& market_file);
+    explicit Server(const std::string& port, const std::string& market_file,
+                    bool multi_client = false);
 
     void run();
 
     Server(const Server&) = delete;
     Server& operator=(const Server&) = delete;
-    Server(Server&&) = default;
-    Server& operator=(Server&&) = default;
+    // Las sesiones guardan referencias al catálogo y al broadcaster
+    Server(Server&&) = delete;
+    Server& operator=(Server&&) = delete;
 };
 
 #endif  // SERVER_H
@@ -0,0 +1,44 @@
+#include "server_load_shedder.h"
+
+LoadShedder::LoadShedder(Clock::duration target, Clock::duration interval):
+        target(target),
+        interval(interval),
+        above_target(false),
+        shedding(false),
+        stats{0, 0, Clock::duration::zero()} {}
+
+void LoadShedder::configure(Clock::duration new_target, Clock::duration new_interval) {
+    target = new_target;
+    interval = new_interval;
+    above_target = false;
+    shedding = false;
+}
+
+bool LoadShedder::admit(Clock::duration delay, Clock::time_point now, bool sheddable) {
+    stats.requests++;
+    if (delay > stats.max_delay) {
+        stats.max_delay = delay;
+    }
+    if (target == Clock::duration::zero()) {
+        return true;
+    }
+
+    // Un solo pedido que esperó poco alcanza para ver que la cola se vació
+    if (delay < target) {
+        above_target = false;
+        shedding = false;
+        return true;
+    }
+
+    if (!above_target) {
+        above_target = true;
+        first_above_target = now;
+    }
+    shedding = now - first_above_target >= interval;
+    if (!shedding || !sheddable) {
+        return true;
+    }
+
+    stats.shed++;
+    return false;
+}
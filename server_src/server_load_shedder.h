@@ -0,0 +1,58 @@
+#ifndef SERVER_LOAD_SHEDDER_H
+#define SERVER_LOAD_SHEDDER_H
+
+#include <chrono>
+#include <cstdint>
+
+/*
+ * Control de sobrecarga al estilo CoDel.
+ *
+ * Por cada pedido se mide cuánto esperó desde que llegó hasta que se lo
+ * atiende. Una ráfaga corta hace subir esa espera un momento; si desde
+ * el primer pedido que esperó más que `target` pasa todo un `interval`
+ * sin que ninguno espere menos, la cola no se vacía nunca: hay
+ * sobrecarga; el tiempo sin pedidos no cuenta. Mientras dure, los
+ * pedidos descartables que esperaron más que `target` se rechazan en
+ * lugar de atenderse, y apenas un pedido vuelve a esperar poco se deja
+ * de rechazar.
+ *
+ * Los pedidos no descartables (p. ej. una compra) nunca se rechazan,
+ * pero su espera cuenta igual para detectar la sobrecarga.
+ * */
+class LoadShedder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        uint64_t requests;
+        uint64_t shed;
+        Clock::duration max_delay;
+    };
+
+private:
+    Clock::duration target;  // Cero: sin control de sobrecarga
+    Clock::duration interval;
+
+    // Desde cuándo los pedidos esperan más que `target` (si `above_target`)
+    bool above_target;
+    Clock::time_point first_above_target;
+    bool shedding;
+
+    Stats stats;
+
+public:
+    LoadShedder(Clock::duration target, Clock::duration interval);
+
+    void configure(Clock::duration new_target, Clock::duration new_interval);
+
+    /*
+     * Registra un pedido que esperó `delay` y decide si se atiende.
+     * Retorna false si es `sheddable` y corresponde rechazarlo.
+     * */
+    bool admit(Clock::duration delay, Clock::time_point now, bool sheddable);
+
+    bool is_shedding() const { return shedding; }
+    const Stats& get_stats() const { return stats; }
+};
+
+#endif  // SERVER_LOAD_SHEDDER_H
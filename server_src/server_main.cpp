@@ -1,19 +1,28 @@
 #include <exception>
 #include <iostream>
+#include <string>
+
+#include <signal.h>
 
 #include "server.h"
 
 int main(int argc, const char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <port> <market-file>" << std::endl;
+    // El modo "multi" atiende varios clientes a la vez hasta recibir 'q' por stdin
+    bool multi_client = (argc == 4 && std::string(argv[3]) == "multi");
+    if (argc != 3 && !multi_client) {
+        std::cerr << "Usage: " << argv[0] << " <port> <market-file> [multi]" << std::endl;
         return 1;
     }
 
     std::string port = argv[1];
     std::string market_file = argv[2];
 
+    // El catálogo sale con sendfile, que ante un cliente ya desconectado
+    // genera SIGPIPE en lugar de sólo fallar con EPIPE
+    signal(SIGPIPE, SIG_IGN);
+
     try {
-        Server server(port, market_file);
+        Server server(port, market_file, multi_client);
         server.run();
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
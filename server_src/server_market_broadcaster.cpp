@@ -0,0 +1,31 @@
+#include "server_market_broadcaster.h"
+
+#include <algorithm>
+#include <exception>
+
+void MarketBroadcaster::subscribe(Protocol& protocol) {
+    if (std::find(subscribers.begin(), subscribers.end(), &protocol) == subscribers.end()) {
+        subscribers.push_back(&protocol);
+    }
+}
+
+void MarketBroadcaster::unsubscribe(Protocol& protocol) {
+    subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), &protocol),
+                      subscribers.end());
+}
+
+size_t MarketBroadcaster::publish(const MarketDeltaDto& delta) {
+    // Una sola serialización para todos los suscriptos
+    Protocol::encode_market_update(delta, message);
+
+    size_t delivered = 0;
+    for (Protocol* subscriber: subscribers) {
+        try {
+            subscriber->send_encoded_message(message);
+            delivered++;
+        } catch (const std::exception&) {
+            // La sesión detectará la conexión rota en su próxima lectura
+        }
+    }
+    return delivered;
+}
@@ -0,0 +1,36 @@
+#ifndef SERVER_MARKET_BROADCASTER_H
+#define SERVER_MARKET_BROADCASTER_H
+
+#include <cstddef>
+#include <vector>
+
+#include "../common_src/common_protocol.h"
+
+/*
+ * Registro de clientes suscriptos a los cambios del catálogo.
+ *
+ * Cada cambio se serializa una única vez y el mismo mensaje se envía
+ * a todos los suscriptos (fan-out). El broadcaster no es dueño de los
+ * `Protocol`: cada sesión se debe desuscribir antes de destruirse.
+ * */
+class MarketBroadcaster {
+private:
+    std::vector<Protocol*> subscribers;
+    MessageBuffer message;
+
+public:
+    MarketBroadcaster() = default;
+
+    void subscribe(Protocol& protocol);
+    void unsubscribe(Protocol& protocol);
+
+    // Retorna a cuántos suscriptos se les pudo enviar el cambio
+    size_t publish(const MarketDeltaDto& delta);
+
+    size_t subscriber_count() const { return subscribers.size(); }
+
+    MarketBroadcaster(const MarketBroadcaster&) = delete;
+    MarketBroadcaster& operator=(const MarketBroadcaster&) = delete;
+};
+
+#endif  // SERVER_MARKET_BROADCASTER_H
@@ -0,0 +1,159 @@
+#include "server_market_catalog.h"
+
+#include <algorithm>
+#include <utility>
+
+MarketCatalog::MarketCatalog():
+        current_version(1), history_base_version(1), transfer(MessageTransfer::Sendfile) {}
+
+void MarketCatalog::load_car(CarDto car) {
+    market.cars.push_back(std::move(car));
+    encoded.fill(nullptr);
+}
+
+void MarketCatalog::record(CatalogChange::Kind kind, CarDto car) {
+    current_version++;
+    encoded.fill(nullptr);
+    history.emplace_back(current_version, kind, std::move(car));
+
+    // Historial acotado: lo que se descarta ya no se puede enviar como delta
+    if (history.size() > MAX_HISTORY) {
+        history_base_version = history.front().version;
+        history.pop_front();
+    }
+}
+
+CarDto* MarketCatalog::find_mutable(std::string_view name) {
+    auto it = std::find_if(market.cars.begin(), market.cars.end(),
+                           [&name](const CarDto& car) { return car.name == name; });
+    return (it != market.cars.end()) ? &(*it) : nullptr;
+}
+
+void MarketCatalog::add_car(CarDto car) {
+    record(CatalogChange::Kind::Added, car);
+
+    CarDto* existing = find_mutable(car.name);
+    if (existing != nullptr) {
+        *existing = std::move(car);
+    } else {
+        market.cars.push_back(std::move(car));
+    }
+}
+
+bool MarketCatalog::remove_car(std::string_view name) {
+    auto it = std::find_if(market.cars.begin(), market.cars.end(),
+                           [&name](const CarDto& car) { return car.name == name; });
+    if (it == market.cars.end()) {
+        return false;
+    }
+
+    CarDto removed = std::move(*it);
+    market.cars.erase(it);
+    record(CatalogChange::Kind::Removed, std::move(removed));
+    return true;
+}
+
+bool MarketCatalog::reprice_car(std::string_view name, uint32_t price) {
+    CarDto* car = find_mutable(name);
+    if (car == nullptr) {
+        return false;
+    }
+
+    car->price = price;
+    record(CatalogChange::Kind::Repriced, *car);
+    return true;
+}
+
+const CarDto* MarketCatalog::find_car_by_name(std::string_view name) const {
+    auto it = std::find_if(market.cars.begin(), market.cars.end(),
+                           [&name](const CarDto& car) { return car.name == name; });
+
+    if (it != market.cars.end()) {
+        return &(*it);
+    }
+    return nullptr;
+}
+
+bool MarketCatalog::build_delta_since(uint32_t known_version, MarketDeltaDto& delta) const {
+    if (known_version < history_base_version || known_version > current_version) {
+        return false;
+    }
+
+    delta = MarketDeltaDto();
+    delta.from_version = known_version;
+    delta.to_version = current_version;
+
+    // Reducimos los cambios a su efecto neto por nombre de auto
+    for (const auto& change: history) {
+        if (change.version <= known_version) {
+            continue;
+        }
+
+        const std::pmr::string& name = change.car.name;
+        auto added = std::find_if(delta.added.begin(), delta.added.end(),
+                                  [&name](const CarDto& car) { return car.name == name; });
+        auto repriced =
+                std::find_if(delta.repriced.begin(), delta.repriced.end(),
+                             [&name](const PriceChangeDto& p) { return p.name == name; });
+        auto removed = std::find(delta.removed.begin(), delta.removed.end(), name);
+
+        switch (change.kind) {
+            case CatalogChange::Kind::Added:
+                // Un alta pisa cualquier cambio de precio previo. Una baja previa
+                // se conserva: así el cliente también lo mueve al final de la lista.
+                if (repriced != delta.repriced.end()) {
+                    delta.repriced.erase(repriced);
+                }
+                if (added != delta.added.end()) {
+                    *added = change.car;
+                } else {
+                    delta.added.push_back(change.car);
+                }
+                break;
+            case CatalogChange::Kind::Removed:
+                if (added != delta.added.end()) {
+                    delta.added.erase(added);
+                }
+                if (repriced != delta.repriced.end()) {
+                    delta.repriced.erase(repriced);
+                }
+                if (removed == delta.removed.end()) {
+                    delta.removed.push_back(name);
+                }
+                break;
+            case CatalogChange::Kind::Repriced:
+                if (added != delta.added.end()) {
+                    added->price = change.car.price;
+                } else if (repriced != delta.repriced.end()) {
+                    repriced->price = change.car.price;
+                } else {
+                    delta.repriced.emplace_back(name, change.car.price);
+                }
+                break;
+        }
+    }
+
+    return true;
+}
+
+std::shared_ptr<const SharedMessage> MarketCatalog::encoded_market(uint8_t encoding) {
+    size_t index = 0;
+    if (encoding == MARKET_ENCODING_COMPACT) {
+        index = 1;
+    } else if (encoding == MARKET_ENCODING_COLUMNS) {
+        index = 2;
+    }
+
+    if (!encoded[index]) {
+        MessageBuffer message;
+        Protocol::encode_market_catalog(market, encoding, message);
+        encoded[index] = std::make_shared<SharedMessage>(std::move(message), transfer);
+    }
+    return encoded[index];
+}
+
+void MarketCatalog::set_transfer(MessageTransfer new_transfer) {
+    // Los ya encolados terminan de enviarse como estaban
+    transfer = new_transfer;
+    encoded.fill(nullptr);
+}
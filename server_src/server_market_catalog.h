@@ -0,0 +1,93 @@
+#ifndef SERVER_MARKET_CATALOG_H
+#define SERVER_MARKET_CATALOG_H
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../common_src/common_protocol.h"
+
+// Cambio puntual del catálogo, asociado a la versión que lo introdujo
+struct CatalogChange {
+    enum class Kind : uint8_t { Added, Removed, Repriced };
+
+    uint32_t version;
+    Kind kind;
+    CarDto car;  // Para Removed solo importa el nombre; para Repriced nombre y precio
+
+    CatalogChange(uint32_t v, Kind k, const CarDto& c): version(v), kind(k), car(c) {}
+    CatalogChange(uint32_t v, Kind k, CarDto&& c): version(v), kind(k), car(std::move(c)) {}
+};
+
+/*
+ * Catálogo del mercado versionado.
+ *
+ * Cada modificación incrementa la versión y queda registrada en un
+ * historial acotado. A partir de ese historial se arma la diferencia
+ * neta entre la versión que tiene un cliente y la actual; si la versión
+ * del cliente es más vieja que el historial se le envía el catálogo completo.
+ * */
+class MarketCatalog {
+private:
+    // Los autos se guardan como DTO para enviarlos sin copiarlos
+    MarketDto market;
+    uint32_t current_version;
+
+    std::deque<CatalogChange> history;
+    // Versión a partir de la cual el historial está completo
+    uint32_t history_base_version;
+
+    static const size_t MAX_HISTORY = 256;
+
+    /*
+     * Catálogo ya codificado, uno por codificación, armado a demanda y
+     * descartado con cualquier cambio. Quien lo esté enviando conserva
+     * el de su versión hasta terminar.
+     * */
+    std::array<std::shared_ptr<const SharedMessage>, 3> encoded;
+    MessageTransfer transfer;
+
+    void record(CatalogChange::Kind kind, CarDto car);
+    CarDto* find_mutable(std::string_view name);
+
+public:
+    MarketCatalog();
+
+    // Carga inicial: no genera versiones ni historial
+    void load_car(CarDto car);
+
+    // Modificaciones versionadas. Agregar un auto existente lo reemplaza.
+    void add_car(CarDto car);
+    bool remove_car(std::string_view name);
+    bool reprice_car(std::string_view name, uint32_t price);
+
+    const CarDto* find_car_by_name(std::string_view name) const;
+    const std::vector<CarDto>& get_cars() const { return market.cars; }
+    const MarketDto& as_market() const { return market; }
+
+    // Respuesta a GET_MARKET_INFO (comando incluido), compartida por todos los pedidos
+    std::shared_ptr<const SharedMessage> encoded_market(uint8_t encoding);
+
+    // Cómo se envía el catálogo codificado (por defecto con sendfile)
+    void set_transfer(MessageTransfer new_transfer);
+    MessageTransfer get_transfer() const { return transfer; }
+    uint32_t version() const { return current_version; }
+
+    /*
+     * Arma en `delta` los cambios netos desde `known_version` hasta la
+     * versión actual. Retorna false si el historial no alcanza, en cuyo
+     * caso hay que enviar el catálogo completo.
+     * */
+    bool build_delta_since(uint32_t known_version, MarketDeltaDto& delta) const;
+
+    MarketCatalog(const MarketCatalog&) = delete;
+    MarketCatalog& operator=(const MarketCatalog&) = delete;
+    MarketCatalog(MarketCatalog&&) = default;
+    MarketCatalog& operator=(MarketCatalog&&) = default;
+};
+
+#endif  // SERVER_MARKET_CATALOG_H
@@ -0,0 +1,471 @@
+#include "server_session.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "../common_src/common_constants.h"
+
+ClientSession::ClientSession(Socket&& skt, MarketCatalog& market, MarketBroadcaster& broadcaster,
+                             LoadShedder& load_shedder, uint32_t initial_money,
+                             size_t max_output, TimerWheel& timers,
+                             const SessionTimeouts& timeouts, SessionStore& session_store):
+        protocol(std::move(skt)),
+        market(market),
+        broadcaster(broadcaster),
+        load_shedder(load_shedder),
+        initial_money(initial_money),
+        registered(false),
+        client_money(initial_money),
+        market_encoding(MARKET_ENCODING_PLAIN),
+        session_store(session_store),
+        resumable(false),
+        session_token{},
+        input_closed(false),
+        subscribed(false),
+        readable(false),
+        backlog_first(0),
+        backlog_count(0),
+        timers(timers),
+        timeouts(timeouts),
+        deadline_kind(Deadline::None),
+        deadline([this]() { deadline_expired = true; }),
+        deadline_expired(false) {
+    protocol.enable_output_queue(max_output);
+    update_deadline(false);
+}
+
+ClientSession::~ClientSession() {
+    broadcaster.unsubscribe(protocol);
+    if (resumable) {
+        session_store.detach(session_token, this, session_state(), SessionStore::Clock::now());
+    }
+}
+
+ReceiveStatus ClientSession::receive_next_message() {
+    // Si el mensaje no llegó completo se continúa en el próximo evento
+    ReceiveStatus status = protocol.receive_available();
+    if (status == ReceiveStatus::WouldBlock) {
+        readable = false;
+        update_deadline(false);
+    }
+    return status;
+}
+
+bool ClientSession::is_bulk_request(uint8_t command) {
+    // Pueden responderse con el catálogo entero
+    return command == GET_MARKET_INFO || command == GET_MARKET_SYNC ||
+           command == SUBSCRIBE_MARKET;
+}
+
+// Pedidos que pueden ir en un lote (SEND_BATCH). La sincronización es el
+// catálogo de un cliente que lo guarda (véase `market_cache` en el cliente)
+static bool is_batchable_request(uint8_t command) {
+    return command == GET_CURRENT_CAR || command == GET_MARKET_INFO || command == BUY_CAR ||
+           command == GET_MARKET_SYNC;
+}
+
+bool ClientSession::received_bulk_request() const {
+    uint8_t command = protocol.received_command();
+    if (command == SEND_BATCH) {
+        const std::vector<uint8_t>& requests = protocol.received_batch_commands();
+        return registered && std::any_of(requests.begin(), requests.end(), is_bulk_request);
+    }
+    return registered && is_bulk_request(command);
+}
+
+void ClientSession::handle_received_message() {
+    uint8_t command = protocol.receive_command();
+
+    // Lo que el pedido reservó en la arena se libera al terminar de atenderlo
+    struct ArenaReset {
+        RequestArena& arena;
+        ~ArenaReset() { arena.reset(); }
+    } arena_reset{arena};
+
+    // Con sobrecarga se rechaza el pedido caro (el catálogo); las compras nunca
+    LoadShedder::Clock::time_point now = LoadShedder::Clock::now();
+    LoadShedder::Clock::duration delay = now - received_since(now);
+    readable = false;
+    bool sheddable = command == GET_MARKET_INFO;
+    if (command == SEND_BATCH) {
+        const std::vector<uint8_t>& requests = protocol.received_batch_commands();
+        sheddable = std::find(requests.begin(), requests.end(), GET_MARKET_INFO) != requests.end();
+    }
+    bool admitted = load_shedder.admit(delay, now, registered && sheddable);
+
+    // PRIMERO: el registro del usuario
+    if (!registered) {
+        handle_user_registration(command);
+    } else if (command == SEND_BATCH) {
+        handle_batch_request(admitted);
+    } else if (!admitted) {
+        reject_busy();
+    } else {
+        handle_command(command);
+    }
+
+    update_deadline(true);
+}
+
+void ClientSession::handle_command(uint8_t command) {
+    // LUEGO: comandos del negocio
+    switch (command) {
+        case GET_CURRENT_CAR:
+            handle_current_car_request();
+            break;
+        case GET_MARKET_INFO:
+            handle_market_info_request();
+            break;
+        case BUY_CAR:
+            handle_car_purchase_request();
+            break;
+        case GET_MARKET_SYNC:
+            handle_market_sync_request();
+            break;
+        case SUBSCRIBE_MARKET:
+            handle_market_subscription_request();
+            break;
+        case NEGOTIATE_MARKET_ENCODING:
+            handle_market_encoding_request();
+            break;
+        default:
+            std::cerr << "Unknown command received: 0x" << std::hex << (int)command << std::dec
+                      << std::endl;
+            break;
+    }
+}
+
+void ClientSession::handle_batch_request(bool admitted) {
+    // Se valida entero antes de empezar: o se atiende todo o nada
+    const std::vector<uint8_t>& requests = protocol.received_batch_commands();
+    if (!std::all_of(requests.begin(), requests.end(), is_batchable_request)) {
+        throw std::runtime_error("Invalid request in batch");
+    }
+
+    // Los pedidos se atienden en orden y sus respuestas salen en un solo mensaje;
+    // con sobrecarga sólo se rechaza el catálogo, como fuera de un lote
+    protocol.receive_batch_size();
+    protocol.begin_batch();
+    for (size_t i = 0; i < requests.size(); i++) {
+        uint8_t command = protocol.receive_command();
+        if (command == GET_MARKET_INFO && !admitted) {
+            reject_busy();
+        } else {
+            handle_command(command);
+        }
+    }
+    protocol.send_batch_reply();
+}
+
+void ClientSession::mark_readable(LoadShedder::Clock::time_point since) {
+    if (!readable) {
+        readable = true;
+        readable_since = since;
+    }
+}
+
+void ClientSession::clear_readable() {
+    // Lo que espera por no leer sus respuestas no es sobrecarga
+    readable = false;
+    backlog_count = 0;
+}
+
+void ClientSession::note_backlog(LoadShedder::Clock::time_point since) {
+    size_t pending = protocol.pending_input();
+    if (pending == 0) {
+        return;
+    }
+    uint64_t end = protocol.received_bytes() + pending;
+    if (backlog_count > 0) {
+        BacklogMark& last = backlog[(backlog_first + backlog_count - 1) % MAX_BACKLOG_MARKS];
+        if (end <= last.end) {
+            return;
+        }
+        if (backlog_count == MAX_BACKLOG_MARKS) {
+            // Sin lugar: lo nuevo cuenta desde la última marca, que es anterior
+            last.end = end;
+            return;
+        }
+    }
+    backlog[(backlog_first + backlog_count) % MAX_BACKLOG_MARKS] = BacklogMark{end, since};
+    backlog_count++;
+}
+
+LoadShedder::Clock::time_point ClientSession::received_since(LoadShedder::Clock::time_point now) {
+    // Las marcas que terminan antes de este pedido ya se atendieron
+    uint64_t position = protocol.received_message_position();
+    while (backlog_count > 0 && backlog[backlog_first].end <= position) {
+        backlog_first = (backlog_first + 1) % MAX_BACKLOG_MARKS;
+        backlog_count--;
+    }
+
+    LoadShedder::Clock::time_point since = readable ? readable_since : now;
+    if (backlog_count > 0 && backlog[backlog_first].since < since) {
+        since = backlog[backlog_first].since;
+    }
+    return since;
+}
+
+void ClientSession::reject_busy() {
+    // Respuesta inmediata: el cliente puede reintentar más tarde
+    ErrorDto error("Server busy", arena.get());
+    protocol.send_error_notification(error);
+    std::cout << "Error: Server busy" << std::endl;
+}
+
+void ClientSession::close_input() {
+    input_closed = true;
+    update_deadline(false);
+}
+
+// ==== SESIÓN QUE SE PUEDE RETOMAR ====
+
+SessionState ClientSession::session_state() const {
+    return SessionState{client_username, client_money, client_current_car, market_encoding};
+}
+
+void ClientSession::save_session() {
+    if (resumable) {
+        session_store.update(session_token, this, session_state());
+    }
+}
+
+// ==== PLAZOS ====
+
+void ClientSession::update_deadline(bool activity) {
+    Deadline next = Deadline::Idle;
+    if (input_closed) {
+        // Lo que queda por enviarle tampoco puede esperar para siempre
+        next = Deadline::Idle;
+    } else if (!registered) {
+        next = Deadline::Handshake;
+    } else if (protocol.receiving_message()) {
+        next = Deadline::Request;
+    } else if (subscribed) {
+        // Un suscripto espera los pushes sin mandar nada
+        next = Deadline::None;
+    }
+
+    if (next == deadline_kind && !(next == Deadline::Idle && activity)) {
+        return;
+    }
+    deadline_kind = next;
+
+    switch (next) {
+        case Deadline::None:
+            timers.cancel(deadline);
+            break;
+        case Deadline::Handshake:
+            timers.schedule(deadline, timeouts.handshake);
+            break;
+        case Deadline::Request:
+            timers.schedule(deadline, timeouts.request);
+            break;
+        case Deadline::Idle:
+            timers.schedule(deadline, timeouts.idle);
+            break;
+    }
+}
+
+const char* ClientSession::timeout_reason() const {
+    switch (deadline_kind) {
+        case Deadline::Handshake:
+            return "Handshake timeout";
+        case Deadline::Request:
+            return "Request timeout";
+        default:
+            return "Idle timeout";
+    }
+}
+
+void ClientSession::dump_flight_recorder(std::ostream& out) const {
+    out << "Session " << protocol.get_fd();
+    if (registered) {
+        out << " (" << client_username << ")";
+    }
+    out << ": ";
+    protocol.dump_flight_recorder(out);
+}
+
+static const char* encoding_name(uint8_t encoding) {
+    switch (encoding) {
+        case MARKET_ENCODING_COMPACT:
+            return "compact";
+        case MARKET_ENCODING_COLUMNS:
+            return "columns";
+        default:
+            return "plain";
+    }
+}
+
+// ==== HANDLERS QUE TRABAJAN CON DTOs ====
+
+void ClientSession::handle_user_registration(uint8_t first_command) {
+    if (first_command == RESUME_SESSION) {
+        handle_session_resume();
+        return;
+    }
+    if (first_command != SEND_USERNAME) {
+        throw std::runtime_error("Expected username as first message");
+    }
+
+    // NUEVO: Recibir como DTO
+    UserDto user = protocol.receive_user_registration();
+    client_username = user.username;
+    std::cout << "Hello, " << client_username << std::endl;
+
+    // NUEVO: Enviar dinero como DTO
+    MoneyDto initial_balance(initial_money);
+    protocol.send_initial_balance(initial_balance);
+    std::cout << "Initial balance: " << initial_money << std::endl;
+
+    client_money = initial_money;
+    registered = true;
+}
+
+void ClientSession::handle_session_resume() {
+    SessionResumeDto resume = protocol.receive_session_resume();
+
+    // Un token vencido o desconocido no es un error: se empieza de cero
+    SessionState state;
+    bool resumed = resume.token != SessionToken{} &&
+                   session_store.resume(resume.token, resume.username, this, state);
+    if (resumed) {
+        client_username = state.username;
+        client_money = state.money;
+        client_current_car = std::move(state.current_car);
+        market_encoding = state.market_encoding;
+        session_token = resume.token;
+        std::cout << "Welcome back, " << client_username << std::endl;
+        std::cout << "Resumed balance: " << client_money << std::endl;
+    } else {
+        client_username = std::string_view(resume.username);
+        client_money = initial_money;
+        session_token = session_store.create(this, session_state());
+        std::cout << "Hello, " << client_username << std::endl;
+        std::cout << "Initial balance: " << initial_money << std::endl;
+    }
+
+    // El cliente no espera esta respuesta: sus pedidos pueden venir detrás
+    protocol.send_session(SessionDto(session_token, client_money, resumed));
+    resumable = true;
+    registered = true;
+}
+
+void ClientSession::handle_current_car_request() {
+    if (client_current_car.has_value()) {
+        // NUEVO: Enviar auto como DTO
+        protocol.send_current_car_info(client_current_car.value());
+
+        // Mostrar precio en pesos (dividir por 100)
+        std::cout << "Car " << client_current_car->name << " " << (client_current_car->price / 100)
+                  << " " << client_current_car->year << " sent" << std::endl;
+    } else {
+        // NUEVO: Enviar error como DTO
+        ErrorDto error("No car bought", arena.get());
+        protocol.send_error_notification(error);
+        std::cout << "Error: No car bought" << std::endl;
+    }
+}
+
+void ClientSession::handle_market_info_request() {
+    // Se codifica una vez por versión y se encola sin copiarlo (véase MarketCatalog)
+    protocol.send_shared_message(market.encoded_market(market_encoding));
+    std::cout << market.get_cars().size() << " cars sent" << std::endl;
+}
+
+void ClientSession::handle_car_purchase_request() {
+    // NUEVO: Recibir nombre del auto directamente (no como DTO porque es un parámetro simple)
+    std::pmr::string car_name = protocol.receive_car_purchase_request(arena.get());
+
+    const CarDto* car = market.find_car_by_name(car_name);
+    if (car == nullptr) {
+        ErrorDto error("Car not found", arena.get());
+        protocol.send_error_notification(error);
+        std::cout << "Error: Car not found" << std::endl;
+        return;
+    }
+
+    // Verificar fondos (convertir precio a pesos para comparar)
+    if (client_money < (car->price / 100)) {
+        ErrorDto error("Insufficient funds", arena.get());
+        protocol.send_error_notification(error);
+        std::cout << "Error: Insufficient funds" << std::endl;
+        return;
+    }
+
+    // Comprar el auto - trabajar en pesos
+    client_money -= (car->price / 100);
+    client_current_car = *car;
+
+    // NUEVO: Enviar confirmación como DTO
+    CarPurchaseDto purchase(*car, client_money, arena.get());
+    protocol.send_purchase_confirmation(purchase);
+    save_session();
+
+    std::cout << "New cars name: " << car->name << " --- remaining balance: " << client_money
+              << std::endl;
+}
+
+void ClientSession::handle_market_encoding_request() {
+    MarketEncodingDto supported = protocol.receive_market_encoding_request();
+
+    // Elegimos la mejor codificación que soporten ambos; plain siempre está.
+    // Compact ocupa menos en la red; columns se decodifica más rápido.
+    if (supported.encodings & MARKET_ENCODING_COMPACT) {
+        market_encoding = MARKET_ENCODING_COMPACT;
+    } else if (supported.encodings & MARKET_ENCODING_COLUMNS) {
+        market_encoding = MARKET_ENCODING_COLUMNS;
+    } else {
+        market_encoding = MARKET_ENCODING_PLAIN;
+    }
+
+    protocol.send_market_encoding(MarketEncodingDto(market_encoding));
+    save_session();
+    std::cout << "Market encoding: " << encoding_name(market_encoding) << std::endl;
+}
+
+void ClientSession::handle_market_sync_request() {
+    MarketVersionDto known = protocol.receive_market_sync_request();
+    send_market_sync(known);
+}
+
+void ClientSession::handle_market_subscription_request() {
+    MarketVersionDto known = protocol.receive_market_subscription_request();
+
+    // Primero dejamos al cliente en la versión actual, recién después
+    // empieza a recibir los cambios por push
+    send_market_sync(known);
+    broadcaster.subscribe(protocol);
+    subscribed = true;
+    std::cout << client_username << " subscribed to market updates" << std::endl;
+}
+
+void ClientSession::send_market_sync(const MarketVersionDto& known) {
+    if (known.version == market.version()) {
+        protocol.send_market_up_to_date(MarketVersionDto(market.version()));
+        std::cout << "Market up to date" << std::endl;
+        return;
+    }
+
+    // Si el historial alcanza y el delta es más chico que el catálogo se
+    // envía solo la diferencia, si no el catálogo completo
+    MarketDeltaDto delta;
+    if (market.build_delta_since(known.version, delta)) {
+        size_t entries = delta.added.size() + delta.removed.size() + delta.repriced.size();
+        if (entries < market.get_cars().size()) {
+            protocol.send_market_delta(delta);
+            std::cout << "Market delta sent: " << delta.added.size() << " added, "
+                      << delta.removed.size() << " removed, " << delta.repriced.size()
+                      << " repriced" << std::endl;
+            return;
+        }
+    }
+
+    MarketSnapshotDto snapshot(market.version(), market.get_cars());
+    protocol.send_market_snapshot(snapshot);
+    std::cout << market.get_cars().size() << " cars sent" << std::endl;
+}
@@ -0,0 +1,205 @@
+#ifndef SERVER_SESSION_H
+#define SERVER_SESSION_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+
+#include "../common_src/common_arena.h"
+#include "../common_src/common_protocol.h"
+#include "../common_src/common_socket.h"
+
+#include "server_load_shedder.h"
+#include "server_market_broadcaster.h"
+#include "server_market_catalog.h"
+#include "server_session_store.h"
+#include "server_timer_wheel.h"
+
+// Plazos de una sesión; al vencer alguno el server la termina
+struct SessionTimeouts {
+    std::chrono::milliseconds handshake;  // Para registrarse desde que se conecta
+    std::chrono::milliseconds request;    // Para completar un mensaje ya empezado
+    std::chrono::milliseconds idle;       // Sin pedidos (no aplica a los suscriptos)
+};
+
+/*
+ * Estado y handlers de la conexión con un cliente.
+ *
+ * El catálogo y el broadcaster son compartidos por todas las sesiones
+ * y le pertenecen al `Server`.
+ * */
+class ClientSession {
+private:
+    Protocol protocol;
+    MarketCatalog& market;
+    MarketBroadcaster& broadcaster;
+    LoadShedder& load_shedder;
+    uint32_t initial_money;
+
+    bool registered;
+    std::string client_username;
+    uint32_t client_money;
+    std::optional<CarDto> client_current_car;
+
+    // Codificación negociada para las respuestas a GET_MARKET_INFO
+    uint8_t market_encoding;
+
+    // Sólo si se registró con RESUME_SESSION (véase `SessionStore`)
+    SessionStore& session_store;
+    bool resumable;
+    SessionToken session_token;
+
+    SessionState session_state() const;
+    // Guarda en `session_store` los cambios que se recuperan al retomarla
+    void save_session();
+
+    // Memoria para los DTOs de un pedido; se vacía al terminar cada uno
+    RequestArena arena;
+
+    // El cliente cerró su lado: sólo queda terminar de enviarle lo pendiente
+    bool input_closed;
+    bool subscribed;
+
+    // Desde cuándo hay pedidos esperando en el socket
+    bool readable;
+    LoadShedder::Clock::time_point readable_since;
+
+    /*
+     * Lo que quedó sin leer en el socket al dejar de leerle en una vuelta
+     * (véase `note_backlog`): hasta qué posición del stream de entrada
+     * había llegado y desde cuándo. Un pedido que empieza antes de `end`
+     * esperó desde `since`, aunque se lo lea varias vueltas después.
+     * */
+    struct BacklogMark {
+        uint64_t end;
+        LoadShedder::Clock::time_point since;
+    };
+    static constexpr size_t MAX_BACKLOG_MARKS = 8;
+    std::array<BacklogMark, MAX_BACKLOG_MARKS> backlog;
+    size_t backlog_first;
+    size_t backlog_count;
+
+    // Desde cuándo espera el pedido recibido (el de `readable` si no hay otra marca)
+    LoadShedder::Clock::time_point received_since(LoadShedder::Clock::time_point now);
+
+    /*
+     * Un solo timer por sesión, con el plazo que corresponda al estado:
+     * registro pendiente, mensaje a medio llegar o inactividad. El de
+     * registro y el de un mensaje cuentan desde que empiezan; el de
+     * inactividad se renueva con cada pedido.
+     * */
+    enum class Deadline { None, Handshake, Request, Idle };
+
+    TimerWheel& timers;
+    SessionTimeouts timeouts;
+    Deadline deadline_kind;
+    TimerWheel::Timer deadline;
+    bool deadline_expired;
+
+    void update_deadline(bool activity);
+
+    // Handlers que trabajan con DTOs
+    void handle_user_registration(uint8_t first_command);
+    void handle_session_resume();
+    void handle_command(uint8_t command);
+    void handle_batch_request(bool admitted);
+    void reject_busy();
+    void handle_current_car_request();
+    void handle_market_info_request();
+    void handle_car_purchase_request();
+    void handle_market_sync_request();
+    void handle_market_subscription_request();
+    void handle_market_encoding_request();
+
+    // Respuesta común a sync y suscripción: up to date, delta o snapshot
+    void send_market_sync(const MarketVersionDto& known);
+
+public:
+    /*
+     * Las respuestas se encolan (hasta `max_output` bytes, véase
+     * `Protocol::enable_output_queue`) y salen con `flush_output`. Los
+     * plazos se agendan en `timers` y las sesiones que se pueden retomar
+     * quedan en `session_store`; ambos deben sobrevivir a la sesión.
+     * */
+    ClientSession(Socket&& skt, MarketCatalog& market, MarketBroadcaster& broadcaster,
+                  LoadShedder& load_shedder, uint32_t initial_money, size_t max_output,
+                  TimerWheel& timers, const SessionTimeouts& timeouts,
+                  SessionStore& session_store);
+
+    /*
+     * Recibe lo que haya llegado del cliente (el socket es no bloqueante).
+     * Un mensaje que llega en partes se sigue armando en las próximas
+     * llamadas; cuando se completa retorna `Complete` y queda pendiente
+     * hasta `handle_received_message`.
+     *
+     * La desconexión del cliente y los mensajes inválidos se informan en
+     * el `ReceiveStatus` (el motivo de un `Error` en `error_reason`); las
+     * excepciones quedan para fallas inesperadas.
+     * */
+    ReceiveStatus receive_next_message();
+
+    /*
+     * Carriles de prioridad: un pedido masivo (véase `is_bulk_request`),
+     * o un lote que incluya alguno, puede esperar a que se atiendan los
+     * chicos de todas las sesiones.
+     * */
+    static bool is_bulk_request(uint8_t command);
+    bool received_bulk_request() const;
+
+    // Lo que esperó el pedido (véase `mark_readable`) se informa al `LoadShedder`
+    void handle_received_message();
+
+    /*
+     * El socket tiene datos que llegaron desde `since`: el próximo pedido
+     * que se atienda esperó desde entonces. Si ya estaba marcado se
+     * conserva el instante anterior (p. ej. un pedido que espera en el
+     * carril masivo). Cada pedido atendido lo olvida, así el siguiente se
+     * mide desde su propia llegada; también se olvida al vaciar el socket,
+     * o con `clear_readable` cuando no se le lee por su culpa.
+     * */
+    void mark_readable(LoadShedder::Clock::time_point since);
+    void clear_readable();
+
+    /*
+     * Se dejó de leerle en esta vuelta sin vaciar el socket (un pedido
+     * masivo o el máximo de pedidos por evento): lo que todavía espera
+     * ahí llegó desde `since`, y así se lo mide cuando se lo atienda.
+     * */
+    void note_backlog(LoadShedder::Clock::time_point since);
+    const char* error_reason() const { return protocol.receive_error_reason(); }
+
+    // Envía sin bloquear lo que se pueda (hasta `max_bytes`) de las respuestas encoladas
+    IoStatus flush_output(size_t max_bytes) { return protocol.flush_output(max_bytes); }
+    size_t pending_output() const { return protocol.pending_output(); }
+    bool output_overflowed() const { return protocol.output_overflowed(); }
+    // El kernel todavía no soltó algún envío con MSG_ZEROCOPY (véase `Protocol`)
+    bool zerocopy_pending() const { return protocol.zerocopy_pending(); }
+
+    void close_input();
+    bool is_input_closed() const { return input_closed; }
+
+    // Venció el plazo actual de la sesión (el motivo en `timeout_reason`)
+    bool timed_out() const { return deadline_expired; }
+    const char* timeout_reason() const;
+    // Terminarla por inactividad es lo normal, no una falla
+    bool idle_timed_out() const { return deadline_expired && deadline_kind == Deadline::Idle; }
+
+    // Últimos mensajes de la sesión, para diagnosticar (véase `FlightRecorder`)
+    void dump_flight_recorder(std::ostream& out) const;
+
+    int get_fd() const { return protocol.get_fd(); }
+    short prepare_poll(short events) { return protocol.prepare_poll(events); }
+
+    ~ClientSession();
+
+    // El broadcaster guarda la dirección del protocolo: no se copia ni se mueve
+    ClientSession(const ClientSession&) = delete;
+    ClientSession& operator=(const ClientSession&) = delete;
+    ClientSession(ClientSession&&) = delete;
+    ClientSession& operator=(ClientSession&&) = delete;
+};
+
+#endif  // SERVER_SESSION_H
@@ -0,0 +1,99 @@
+#include "server_session_store.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/random.h>
+
+#include "../common_src/liberror.h"
+
+size_t SessionStore::TokenHash::operator()(const SessionToken& token) const {
+    size_t hash;
+    std::memcpy(&hash, token.data(), sizeof(hash));
+    return hash;
+}
+
+SessionStore::SessionStore(Clock::duration ttl, size_t capacity):
+        ttl(ttl), capacity(capacity) {}
+
+static SessionToken random_token() {
+    SessionToken token;
+    size_t filled = 0;
+    while (filled < token.size()) {
+        ssize_t n = getrandom(token.data() + filled, token.size() - filled, 0);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw LibError(errno, "getrandom failed");
+        }
+        filled += n;
+    }
+    return token;
+}
+
+SessionToken SessionStore::create(const ClientSession* owner, const SessionState& state) {
+    expire(Clock::now());
+
+    // Todo en 0 significa "sin token"; repetirse es casi imposible pero gratis de evitar
+    SessionToken token;
+    do {
+        token = random_token();
+    } while (token == SessionToken{} || entries.count(token) != 0);
+
+    entries.emplace(token, Entry{state, owner, Clock::time_point()});
+    return token;
+}
+
+bool SessionStore::resume(const SessionToken& token, std::string_view username,
+                          const ClientSession* owner, SessionState& state) {
+    // Lo vencido se descarta antes de buscar: si no, se retomaría pasado el `ttl`
+    expire(Clock::now());
+
+    auto it = entries.find(token);
+    if (it == entries.end() || it->second.state.username != username) {
+        return false;
+    }
+
+    it->second.owner = owner;
+    state = it->second.state;
+    return true;
+}
+
+void SessionStore::update(const SessionToken& token, const ClientSession* owner,
+                          const SessionState& state) {
+    auto it = entries.find(token);
+    if (it != entries.end() && it->second.owner == owner) {
+        it->second.state = state;
+    }
+}
+
+void SessionStore::detach(const SessionToken& token, const ClientSession* owner,
+                          const SessionState& state, Clock::time_point now) {
+    auto it = entries.find(token);
+    if (it == entries.end() || it->second.owner != owner) {
+        return;
+    }
+
+    it->second.state = state;
+    it->second.owner = nullptr;
+    it->second.detached_at = now;
+    detached.emplace_back(token, now);
+    expire(now);
+}
+
+void SessionStore::expire(Clock::time_point now) {
+    while (!detached.empty()) {
+        const auto& [token, since] = detached.front();
+        if (now - since < ttl && entries.size() <= capacity) {
+            break;
+        }
+
+        auto it = entries.find(token);
+        if (it != entries.end() && it->second.owner == nullptr &&
+            it->second.detached_at == since) {
+            entries.erase(it);
+        }
+        detached.pop_front();
+    }
+}
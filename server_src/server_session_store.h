@@ -0,0 +1,90 @@
+#ifndef SERVER_SESSION_STORE_H
+#define SERVER_SESSION_STORE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "../common_src/common_protocol.h"
+
+class ClientSession;
+
+// Lo que se recupera al retomar una sesión
+struct SessionState {
+    std::string username;
+    uint32_t money;
+    std::optional<CarDto> current_car;
+    uint8_t market_encoding;
+};
+
+/*
+ * Sesiones que se pueden retomar con su token (véase `RESUME_SESSION`).
+ *
+ * Cada token tiene a lo sumo un dueño: la sesión conectada que lo usa.
+ * Si el cliente se reconecta antes de que el server note que la conexión
+ * anterior murió, la nueva se queda con el token y lo que haga la vieja
+ * ya no cuenta.
+ *
+ * Al desconectarse, el estado se guarda por `ttl`. Si hay más de
+ * `capacity` sesiones guardadas se descartan las desconectadas hace más
+ * tiempo.
+ * */
+class SessionStore {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Entry {
+        SessionState state;
+        const ClientSession* owner;  // nullptr: desconectada
+        Clock::time_point detached_at;
+    };
+
+    // Los tokens son aleatorios: alcanza con sus primeros bytes
+    struct TokenHash {
+        size_t operator()(const SessionToken& token) const;
+    };
+
+    std::unordered_map<SessionToken, Entry, TokenHash> entries;
+    /*
+     * Desconexiones en orden, para vencerlas de la más vieja a la más
+     * nueva. Una sesión que se retomó deja acá su desconexión anterior:
+     * se la reconoce porque ya no coincide el instante y se la ignora.
+     * */
+    std::deque<std::pair<SessionToken, Clock::time_point>> detached;
+    Clock::duration ttl;
+    size_t capacity;
+
+    void expire(Clock::time_point now);
+
+public:
+    SessionStore(Clock::duration ttl, size_t capacity);
+
+    // Registra una sesión nueva de `owner` y retorna su token
+    SessionToken create(const ClientSession* owner, const SessionState& state);
+
+    /*
+     * Si `token` sigue guardado (no venció su `ttl`) y es del mismo
+     * `username`, `owner` pasa a ser su dueño y se retorna true con el
+     * estado en `state`.
+     * */
+    bool resume(const SessionToken& token, std::string_view username,
+                const ClientSession* owner, SessionState& state);
+
+    // Actualiza el estado guardado, si `owner` sigue siendo el dueño
+    void update(const SessionToken& token, const ClientSession* owner,
+                const SessionState& state);
+    // Ídem, y la sesión queda desconectada desde `now`
+    void detach(const SessionToken& token, const ClientSession* owner,
+                const SessionState& state, Clock::time_point now);
+
+    size_t size() const { return entries.size(); }
+};
+
+#endif  // SERVER_SESSION_STORE_H
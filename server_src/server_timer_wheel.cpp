@@ -0,0 +1,174 @@
+#include "server_timer_wheel.h"
+
+#include <algorithm>
+#include <climits>
+#include <utility>
+
+TimerWheel::Timer::Timer(std::function<void()> on_expire):
+        on_expire(std::move(on_expire)),
+        wheel(nullptr),
+        bucket(nullptr),
+        prev(nullptr),
+        next(nullptr),
+        expires(0) {}
+
+TimerWheel::Timer::~Timer() {
+    if (wheel != nullptr) {
+        wheel->cancel(*this);
+    }
+}
+
+TimerWheel::TimerWheel():
+        origin(Clock::now()), current_tick(0), scheduled(0), slots(), occupied() {}
+
+uint64_t TimerWheel::tick_of(Clock::time_point time) const { return (time - origin) / TICK; }
+
+// Rotación a derecha de los 64 bits de ocupación (std::rotr es de C++20)
+static uint64_t rotate_right(uint64_t bits, unsigned shift) {
+    return (bits >> shift) | (bits << ((64 - shift) & 63));
+}
+
+void TimerWheel::place(Timer& timer) {
+    // El nivel es el primero cuyo rango alcanza al vencimiento
+    uint64_t delta = timer.expires - current_tick;
+    unsigned level = 0;
+    while (level < LEVELS - 1 && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    unsigned slot = (timer.expires >> (SLOT_BITS * level)) & (SLOTS - 1);
+
+    Timer*& head = slots[level][slot];
+    timer.prev = nullptr;
+    timer.next = head;
+    if (head != nullptr) {
+        head->prev = &timer;
+    }
+    head = &timer;
+    timer.bucket = &head;
+    timer.wheel = this;
+    occupied[level] |= uint64_t(1) << slot;
+}
+
+void TimerWheel::unlink(Timer& timer) {
+    if (timer.prev != nullptr) {
+        timer.prev->next = timer.next;
+    } else {
+        *timer.bucket = timer.next;
+    }
+    if (timer.next != nullptr) {
+        timer.next->prev = timer.prev;
+    }
+
+    if (*timer.bucket == nullptr) {
+        size_t index = timer.bucket - &slots[0][0];
+        occupied[index / SLOTS] &= ~(uint64_t(1) << (index % SLOTS));
+    }
+    timer.wheel = nullptr;
+    timer.bucket = nullptr;
+    timer.prev = nullptr;
+    timer.next = nullptr;
+}
+
+void TimerWheel::schedule(Timer& timer, Clock::duration delay) {
+    if (timer.wheel == this) {
+        unlink(timer);
+    } else {
+        if (timer.wheel != nullptr) {
+            timer.wheel->cancel(timer);
+        }
+        scheduled++;
+    }
+
+    // Al menos un tick: el slot del tick actual ya se recorrió
+    uint64_t ticks = 1;
+    if (delay > Clock::duration::zero()) {
+        ticks = std::clamp<uint64_t>((delay + TICK - Clock::duration(1)) / TICK, 1, MAX_DELAY);
+    }
+
+    timer.expires = current_tick + ticks;
+    place(timer);
+}
+
+void TimerWheel::cancel(Timer& timer) {
+    if (timer.wheel != this) {
+        return;
+    }
+    unlink(timer);
+    scheduled--;
+}
+
+void TimerWheel::cascade(unsigned level) {
+    unsigned slot = (current_tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+    Timer* timer = slots[level][slot];
+    slots[level][slot] = nullptr;
+    occupied[level] &= ~(uint64_t(1) << slot);
+
+    while (timer != nullptr) {
+        Timer* next = timer->next;
+        place(*timer);
+        timer = next;
+    }
+}
+
+void TimerWheel::run_tick() {
+    current_tick++;
+
+    // Al completar una vuelta de un nivel se baja el slot que sigue del de arriba
+    for (unsigned level = 1; level < LEVELS; level++) {
+        if ((current_tick & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) != 0) {
+            break;
+        }
+        cascade(level);
+    }
+
+    // Un timer reagendado desde su callback cae en otro slot (al menos un tick después)
+    Timer*& head = slots[0][current_tick & (SLOTS - 1)];
+    while (head != nullptr) {
+        Timer& timer = *head;
+        unlink(timer);
+        scheduled--;
+        timer.on_expire();
+    }
+}
+
+void TimerWheel::advance(Clock::time_point now) {
+    uint64_t target = tick_of(now);
+    while (current_tick < target) {
+        if (scheduled == 0) {
+            // Sin timers no hay nada que recorrer
+            current_tick = target;
+            break;
+        }
+        run_tick();
+    }
+}
+
+int TimerWheel::next_timeout_ms(Clock::time_point now) const {
+    if (scheduled == 0) {
+        return -1;
+    }
+
+    /*
+     * Cota inferior del próximo vencimiento: el primer slot ocupado del
+     * nivel 0 o, para los niveles de arriba, el tick en el que su primer
+     * slot ocupado se redistribuye. Alcanza con despertar ahí y recalcular.
+     * */
+    uint64_t next_tick = UINT64_MAX;
+    for (unsigned level = 0; level < LEVELS; level++) {
+        if (occupied[level] == 0) {
+            continue;
+        }
+        unsigned shift = SLOT_BITS * level;
+        uint64_t first_block = (current_tick >> shift) + 1;
+        uint64_t rotated = rotate_right(occupied[level], first_block & (SLOTS - 1));
+        uint64_t block = first_block + __builtin_ctzll(rotated);
+        next_tick = std::min(next_tick, block << shift);
+    }
+
+    Clock::time_point deadline = origin + next_tick * TICK;
+    if (deadline <= now) {
+        return 0;
+    }
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+    return (remaining > INT_MAX) ? INT_MAX : static_cast<int>(remaining);
+}
@@ -0,0 +1,101 @@
+#ifndef SERVER_TIMER_WHEEL_H
+#define SERVER_TIMER_WHEEL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/*
+ * Rueda de timers jerárquica (estilo kernel de Linux) para los plazos
+ * de las sesiones.
+ *
+ * El tiempo avanza en ticks de `TICK`. Cada nivel tiene `SLOTS` listas;
+ * el nivel 0 guarda los timers de los próximos 64 ticks, el nivel 1 los
+ * de los próximos 64 * 64, etc. Cuando el nivel 0 da la vuelta, el slot
+ * que toca del nivel siguiente se redistribuye hacia abajo.
+ *
+ * Agendar y cancelar son O(1) (listas intrusivas) y `advance` sólo hace
+ * trabajo por tick transcurrido y por timer vencido, sin importar
+ * cuántos timers haya pendientes.
+ * */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr Clock::duration TICK = std::chrono::milliseconds(10);
+
+    /*
+     * Timer intrusivo: vive dentro de su dueño (p. ej. la sesión) y la
+     * rueda sólo lo enlaza. Al destruirse se cancela solo.
+     * */
+    class Timer {
+    private:
+        friend class TimerWheel;
+
+        std::function<void()> on_expire;
+        TimerWheel* wheel;  // Rueda en la que está agendado, o nullptr
+        Timer** bucket;     // Lista (slot) en la que está enlazado
+        Timer* prev;
+        Timer* next;
+        uint64_t expires;  // Tick en el que vence
+
+    public:
+        explicit Timer(std::function<void()> on_expire);
+
+        bool is_scheduled() const { return wheel != nullptr; }
+
+        ~Timer();
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+        Timer(Timer&&) = delete;
+        Timer& operator=(Timer&&) = delete;
+    };
+
+private:
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr unsigned SLOTS = 1 << SLOT_BITS;
+    static constexpr unsigned LEVELS = 4;
+    // Con 4 niveles de 64 slots se cubren 2^24 ticks (unas 46 horas)
+    static constexpr uint64_t MAX_DELAY = (uint64_t(1) << (SLOT_BITS * LEVELS)) - 1;
+
+    Clock::time_point origin;
+    uint64_t current_tick;  // Los timers que vencen hasta este tick ya se dispararon
+    size_t scheduled;
+
+    Timer* slots[LEVELS][SLOTS];
+    uint64_t occupied[LEVELS];  // Bit i: el slot i del nivel no está vacío
+
+    uint64_t tick_of(Clock::time_point time) const;
+    void place(Timer& timer);
+    void unlink(Timer& timer);
+    void cascade(unsigned level);
+    void run_tick();
+
+public:
+    TimerWheel();
+
+    // Agenda (o reagenda) el timer para dentro de `delay`, redondeado al tick
+    void schedule(Timer& timer, Clock::duration delay);
+    void cancel(Timer& timer);
+
+    // Dispara, en orden de tick, los timers vencidos hasta `now`
+    void advance(Clock::time_point now);
+
+    /*
+     * Milisegundos hasta que haya que volver a llamar a `advance` (para
+     * usar de timeout de `poll`), o -1 si no hay timers agendados.
+     * */
+    int next_timeout_ms(Clock::time_point now) const;
+
+    size_t size() const { return scheduled; }
+
+    // Los timers guardan la dirección de la rueda
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+    TimerWheel(TimerWheel&&) = delete;
+    TimerWheel& operator=(TimerWheel&&) = delete;
+};
+
+#endif  // SERVER_TIMER_WHEEL_H
@@ -0,0 +1,129 @@
+/*
+ * Velocidad de las columnas numéricas del catálogo (véase `ByteSwap` y
+ * `CatalogCodec::encode_columns`).
+ *
+ *   - Los kernels de `ByteSwap` sobre arrays de 4 MiB contra un
+ *     `htons`/`htonl` por elemento, como hacía el código por campo.
+ *   - El catálogo de 60k autos por columnas contra el formato plano
+ *     (`MessageBuffer::append_car`, un campo por llamada).
+ *
+ * Se informa en GB/s de datos de entrada (para decodificar, del mensaje).
+ * */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+
+#include "../common_src/common_byteswap.h"
+#include "../common_src/common_catalog_codec.h"
+#include "../common_src/common_protocol.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Cada medición repite hasta pasar este tiempo y se queda con la mejor vuelta
+const Clock::duration MIN_TIME = std::chrono::milliseconds(200);
+
+double best_seconds(const std::function<void()>& run) {
+    double best = 1e9;
+    Clock::time_point start = Clock::now();
+    while (Clock::now() - start < MIN_TIME) {
+        Clock::time_point before = Clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - before).count());
+    }
+    return best;
+}
+
+void print_rate(const std::string& name, size_t bytes, double seconds) {
+    std::cout << "  " << std::left << std::setw(34) << name << std::right << std::fixed
+              << std::setprecision(2) << std::setw(8) << bytes / seconds / 1e9 << " GB/s"
+              << std::endl;
+}
+
+void bench_kernels() {
+    const size_t BYTES = 4 * 1024 * 1024;
+    std::vector<uint16_t> source16(BYTES / 2);
+    std::vector<uint16_t> target16(BYTES / 2);
+    std::vector<uint32_t> source32(BYTES / 4);
+    std::vector<uint32_t> target32(BYTES / 4);
+    for (size_t i = 0; i < source32.size(); i++) {
+        source32[i] = static_cast<uint32_t>(i * 2654435761u);
+    }
+    for (size_t i = 0; i < source16.size(); i++) {
+        source16[i] = static_cast<uint16_t>(i * 40503u);
+    }
+
+    std::cout << "Byte swap of 4 MiB arrays (" << ByteSwap::implementation() << ")" << std::endl;
+    print_rate("uint16 htons per element", BYTES, best_seconds([&]() {
+                   for (size_t i = 0; i < source16.size(); i++) {
+                       target16[i] = htons(source16[i]);
+                   }
+               }));
+    print_rate("uint16 ByteSwap", BYTES, best_seconds([&]() {
+                   ByteSwap::copy_big_endian_16(source16.data(), target16.data(),
+                                                source16.size());
+               }));
+    print_rate("uint32 htonl per element", BYTES, best_seconds([&]() {
+                   for (size_t i = 0; i < source32.size(); i++) {
+                       target32[i] = htonl(source32[i]);
+                   }
+               }));
+    print_rate("uint32 ByteSwap", BYTES, best_seconds([&]() {
+                   ByteSwap::copy_big_endian_32(source32.data(), target32.data(),
+                                                source32.size());
+               }));
+}
+
+bool bench_catalog() {
+    const char* BRANDS[] = {"Toyota",     "Honda",   "Ford",    "Chevrolet",
+                            "Volkswagen", "Renault", "Peugeot", "Fiat"};
+    std::vector<CarDto> cars;
+    for (uint32_t i = 0; i < 60000; i++) {
+        cars.emplace_back(std::string(BRANDS[(i / 7500) % 8]) + "Model" + std::to_string(i % 7500),
+                          2000 + i % 25, (10000 + (i * 7919) % 40000) * 100);
+    }
+
+    MessageBuffer plain;
+    MessageBuffer columns;
+    double plain_encode = best_seconds([&]() {
+        plain.clear();
+        plain.append_uint16(static_cast<uint16_t>(cars.size()));
+        for (const CarDto& car: cars) {
+            plain.append_car(car);
+        }
+    });
+    double columns_encode = best_seconds([&]() {
+        columns.clear();
+        CatalogCodec::encode_columns(cars, columns);
+    });
+    size_t decoded = 0;
+    double columns_decode = best_seconds([&]() {
+        decoded = CatalogCodec::decode_columns(columns.data(), columns.size()).size();
+    });
+
+    std::cout << "Catalog of " << cars.size() << " cars (" << plain.size() << " bytes plain, "
+              << columns.size() << " by columns)" << std::endl;
+    print_rate("encode plain (per field)", plain.size(), plain_encode);
+    print_rate("encode columns", columns.size(), columns_encode);
+    print_rate("decode columns", columns.size(), columns_decode);
+    if (decoded != cars.size()) {
+        std::cout << "  decoded " << decoded << " cars, expected " << cars.size() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main() {
+    bench_kernels();
+    return bench_catalog() ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+/*
+ * Bytes en el cable y tiempos de la codificación compacta del catálogo
+ * (véase `CatalogCodec`) contra el formato plano de `SEND_MARKET_INFO`.
+ *
+ * El catálogo tiene 60k autos con 8 prefijos de marca repetidos.
+ *
+ *   - Codificar: el formato plano como lo arma `serialize_market` (un
+ *     `append_car` por auto) contra `CatalogCodec::encode`.
+ *   - Recibir: el mensaje ya codificado se escribe desde otro hilo en un
+ *     `Socket::pair` y se recibe con `Protocol` (`receive_market_catalog`,
+ *     que lee campo por campo, contra `receive_market_catalog_compact`).
+ *   - Decodificar en memoria: `CatalogCodec::decode` solo.
+ *
+ * Cada medición repite hasta pasar un tiempo mínimo y se queda con la
+ * mejor vuelta.
+ * */
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../common_src/common_catalog_codec.h"
+#include "../common_src/common_constants.h"
+#include "../common_src/common_protocol.h"
+#include "../common_src/common_socket.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t CATALOG_CARS = 60000;
+const Clock::duration MIN_TIME = std::chrono::milliseconds(300);
+// Catálogos que se reciben con `Protocol` (se informa el más rápido)
+const int RECEIVES = 10;
+
+double best_seconds(const std::function<void()>& run) {
+    double best = 1e9;
+    Clock::time_point start = Clock::now();
+    while (Clock::now() - start < MIN_TIME) {
+        Clock::time_point before = Clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - before).count());
+    }
+    return best;
+}
+
+void print_ms(const std::string& name, double plain, double compact) {
+    std::cout << "  " << std::left << std::setw(24) << name << std::right << std::fixed
+              << std::setprecision(2) << "plain " << std::setw(8) << plain * 1e3
+              << " ms   compact " << std::setw(8) << compact * 1e3 << " ms" << std::endl;
+}
+
+/*
+ * Recibe `RECEIVES` veces `frame` con `receive` mientras otro hilo lo
+ * escribe; retorna lo que tardó el más rápido. Falla si alguno no llegó
+ * completo.
+ * */
+double receive_seconds(const MessageBuffer& frame,
+                       const std::function<MarketDto(Protocol&)>& receive) {
+    auto sockets = Socket::pair();
+    Socket writer = std::move(sockets.first);
+    Protocol reader(std::move(sockets.second));
+
+    std::thread sender([&]() {
+        for (int i = 0; i < RECEIVES; i++) {
+            writer.sendall(frame.data(), frame.size());
+        }
+    });
+    double best = 1e9;
+    size_t received = 0;
+    for (int i = 0; i < RECEIVES; i++) {
+        Clock::time_point before = Clock::now();
+        reader.receive_command();
+        received += receive(reader).cars.size();
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - before).count());
+    }
+    sender.join();
+    if (received != CATALOG_CARS * RECEIVES) {
+        throw std::runtime_error("catalog incomplete");
+    }
+    return best;
+}
+
+}  // namespace
+
+int main() {
+    const char* BRANDS[] = {"Toyota",     "Honda",   "Ford",    "Chevrolet",
+                            "Volkswagen", "Renault", "Peugeot", "Fiat"};
+    MarketDto market;
+    for (uint32_t i = 0; i < CATALOG_CARS; i++) {
+        market.cars.emplace_back(
+                std::string(BRANDS[(i / 7500) % 8]) + "Model" + std::to_string(i % 7500),
+                2000 + i % 25, (10000 + (i * 7919) % 40000) * 100);
+    }
+
+    // Los mensajes completos, como salen del server
+    MessageBuffer plain;
+    MessageBuffer compact;
+    double plain_encode = best_seconds([&]() {
+        plain.clear();
+        plain.append_byte(SEND_MARKET_INFO);
+        plain.append_uint16(market.cars.size());
+        for (const CarDto& car: market.cars) {
+            plain.append_car(car);
+        }
+    });
+    double compact_encode = best_seconds([&]() {
+        compact.clear();
+        compact.append_byte(SEND_MARKET_INFO_COMPACT);
+        compact.append_uint32(0);
+        CatalogCodec::encode(market.cars, compact);
+        compact.patch_uint32(1, compact.size() - 1 - sizeof(uint32_t));
+    });
+
+    double plain_receive = receive_seconds(plain, [](Protocol& reader) {
+        return reader.receive_market_catalog();
+    });
+    double compact_receive = receive_seconds(compact, [](Protocol& reader) {
+        return reader.receive_market_catalog_compact();
+    });
+
+    size_t decoded = 0;
+    const uint8_t* payload = compact.data() + 1 + sizeof(uint32_t);
+    size_t payload_size = compact.size() - 1 - sizeof(uint32_t);
+    double compact_decode = best_seconds(
+            [&]() { decoded = CatalogCodec::decode(payload, payload_size).size(); });
+
+    std::cout << "Catalog of " << CATALOG_CARS << " cars: plain " << plain.size()
+              << " bytes, compact " << compact.size() << " bytes (" << std::fixed
+              << std::setprecision(1) << 100.0 * compact.size() / plain.size() << "%)"
+              << std::endl;
+    print_ms("encode", plain_encode, compact_encode);
+    print_ms("receive with Protocol", plain_receive, compact_receive);
+    std::cout << "  " << std::left << std::setw(24) << "decode in memory" << std::right
+              << std::setw(28) << "compact " << std::setw(8) << std::setprecision(2)
+              << compact_decode * 1e3 << " ms" << std::endl;
+    if (decoded != CATALOG_CARS) {
+        std::cout << "  decoded " << decoded << " cars, expected " << CATALOG_CARS << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Límites de tamaño al recibir un catálogo.
+ *
+ *   - Un catálogo compacto o por columnas cuyo largo supera
+ *     `Protocol::MAX_CATALOG_PAYLOAD` se rechaza con una excepción apenas
+ *     se lee el largo, sin reservar memoria para él ni esperar el resto.
+ *   - Uno dentro del límite se recibe entero.
+ *   - El formato plano lleva la cantidad de autos en 2 bytes: un catálogo
+ *     de `Protocol::MAX_PLAIN_CATALOG_CARS` autos se envía y se recibe
+ *     entero, y uno con un auto más se rechaza al codificarlo en lugar de
+ *     truncar la cantidad. Compacto y por columnas no tienen ese límite.
+ * */
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../common_src/common_constants.h"
+#include "../common_src/common_protocol.h"
+#include "../common_src/common_socket.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cout << "  FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+/*
+ * Escribe `frame` desde otro hilo en un extremo de un par de sockets (un
+ * catálogo grande no entra en el buffer del socket), lo cierra y lo
+ * recibe del otro con `receive`. Retorna el mensaje de la excepción, o ""
+ * si no hubo.
+ * */
+std::string receive_frame(const MessageBuffer& frame,
+                          const std::function<void(Protocol&)>& receive) {
+    std::pair<Socket, Socket> sockets = Socket::pair();
+    // Se cierra al enviar: si se esperara más de lo enviado, falla en vez de colgarse
+    std::thread sender([&]() {
+        Socket writer = std::move(sockets.first);
+        try {
+            writer.sendall(frame.data(), frame.size());
+        } catch (const std::exception&) {
+            // El receptor ya cerró: su excepción es la que cuenta
+        }
+    });
+
+    std::string error;
+    {
+        Protocol reader(std::move(sockets.second));
+        try {
+            reader.receive_command();
+            receive(reader);
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+    }
+    sender.join();
+    return error;
+}
+
+// Sólo el comando y un largo de payload, sin el payload
+MessageBuffer payload_header(uint8_t command, uint32_t size) {
+    MessageBuffer frame;
+    frame.append_byte(command);
+    frame.append_uint32(size);
+    return frame;
+}
+
+struct CatalogReceiver {
+    const char* name;
+    uint8_t command;
+    uint8_t encoding;
+    std::function<MarketDto(Protocol&)> receive;
+};
+
+const std::vector<CatalogReceiver> RECEIVERS = {
+        {"SEND_MARKET_INFO_COMPACT", SEND_MARKET_INFO_COMPACT, MARKET_ENCODING_COMPACT,
+         [](Protocol& p) { return p.receive_market_catalog_compact(); }},
+        {"SEND_MARKET_INFO_COLUMNS", SEND_MARKET_INFO_COLUMNS, MARKET_ENCODING_COLUMNS,
+         [](Protocol& p) { return p.receive_market_catalog_columns(); }},
+};
+
+void test_payload_limit() {
+    for (const CatalogReceiver& receiver: RECEIVERS) {
+        auto receive = [&](Protocol& p) { receiver.receive(p); };
+        for (uint32_t size: {static_cast<uint32_t>(Protocol::MAX_CATALOG_PAYLOAD + 1),
+                             UINT32_MAX}) {
+            std::string error = receive_frame(payload_header(receiver.command, size), receive);
+            check(error == "Catalog payload too large",
+                  std::string(receiver.name) + ": a " + std::to_string(size) +
+                          "-byte payload is rejected (got \"" + error + "\")");
+        }
+    }
+
+    MarketDto market;
+    market.cars.emplace_back("ToyotaCorolla", 2018, 1200000);
+    market.cars.emplace_back("HondaCivic", 2020, 1400000);
+    for (const CatalogReceiver& receiver: RECEIVERS) {
+        MessageBuffer frame;
+        Protocol::encode_market_catalog(market, receiver.encoding, frame);
+        size_t received = 0;
+        std::string error = receive_frame(
+                frame, [&](Protocol& p) { received = receiver.receive(p).cars.size(); });
+        check(error.empty() && received == market.cars.size(),
+              std::string(receiver.name) + ": a catalog within the limit arrives");
+    }
+}
+
+MarketDto generated_market(size_t cars) {
+    MarketDto market;
+    market.cars.reserve(cars);
+    for (size_t i = 0; i < cars; i++) {
+        market.cars.emplace_back("Model" + std::to_string(i), 2000 + i % 25, 1000000 + i);
+    }
+    return market;
+}
+
+void test_plain_catalog_boundary() {
+    const size_t LIMIT = Protocol::MAX_PLAIN_CATALOG_CARS;
+
+    MessageBuffer frame;
+    Protocol::encode_market_catalog(generated_market(LIMIT), MARKET_ENCODING_PLAIN, frame);
+    MarketDto received;
+    std::string error = receive_frame(frame, [&](Protocol& p) {
+        received = p.receive_market_catalog();
+    });
+    check(error.empty() && received.cars.size() == LIMIT &&
+                  std::string_view(received.cars.back().name) ==
+                          "Model" + std::to_string(LIMIT - 1),
+          "a plain catalog of " + std::to_string(LIMIT) + " cars arrives whole");
+
+    const MarketDto oversize = generated_market(LIMIT + 1);
+    error = "";
+    try {
+        Protocol::encode_market_catalog(oversize, MARKET_ENCODING_PLAIN, frame);
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    check(error == "Too many cars for the plain market format",
+          "a plain catalog of " + std::to_string(LIMIT + 1) + " cars is rejected (got \"" +
+                  error + "\")");
+
+    for (const CatalogReceiver& receiver: RECEIVERS) {
+        Protocol::encode_market_catalog(oversize, receiver.encoding, frame);
+        size_t cars = 0;
+        error = receive_frame(frame,
+                              [&](Protocol& p) { cars = receiver.receive(p).cars.size(); });
+        check(error.empty() && cars == oversize.cars.size(),
+              std::string(receiver.name) + ": a catalog of " + std::to_string(LIMIT + 1) +
+                      " cars arrives whole");
+    }
+}
+
+}  // namespace
+
+int main() {
+    std::cout << "Catalog size limits" << std::endl;
+    test_payload_limit();
+    test_plain_catalog_boundary();
+
+    if (failures > 0) {
+        std::cout << failures << " catalog limit checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All catalog limit checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * CPU que gasta el server por GB de catálogo enviado, según cómo sale
+ * (véase `MessageTransfer` y `SharedMessage`): copiándolo al kernel en
+ * cada envío, con `sendfile` desde un memfd o con `MSG_ZEROCOPY`.
+ *
+ * Con un catálogo de 60k autos (~1.4 MB por respuesta), 1000 conexiones
+ * lo descargan en lazo cerrado, sin control de sobrecarga (con 1000
+ * pedidos en espera se rechazarían catálogos). Se mide el tiempo de CPU
+ * del proceso del server (usuario más sistema) mientras dura cada
+ * prueba. Por loopback el kernel igual copia lo que se envía con
+ * `MSG_ZEROCOPY`.
+ * */
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "test_bench_server.h"
+#include "test_load_generator.h"
+
+namespace {
+
+const size_t CATALOG_CARS = 60000;
+const size_t DOWNLOADERS = 1000;
+const std::chrono::seconds PHASE(4);
+
+}  // namespace
+
+int main() {
+    BenchServer server(CATALOG_CARS, 1000000);
+    LoadGenerator load(server.get_port(), DOWNLOADERS, "ToyotaModel0");
+    server.console("shed 0 100");
+
+    std::cout << DOWNLOADERS << " concurrent downloads of a " << CATALOG_CARS << "-car catalog ("
+              << load.get_catalog_size() << " bytes)" << std::endl;
+    for (const char* transfer: {"copy", "sendfile", "zerocopy"}) {
+        server.console(std::string("transfer ") + transfer);
+
+        std::chrono::nanoseconds cpu_before = server.cpu_time();
+        LoadGenerator::Results results =
+                load.run_closed(PHASE, [](size_t) { return LoadGenerator::Request::Market; });
+        std::chrono::nanoseconds cpu = server.cpu_time() - cpu_before;
+
+        double gigabytes = results.market.size() * load.get_catalog_size() / 1e9;
+        double cpu_seconds = std::chrono::duration<double>(cpu).count();
+        std::cout << "  " << std::left << std::setw(10) << transfer << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(6) << gigabytes << " GB with "
+                  << cpu_seconds << " s of server CPU: " << std::setprecision(3)
+                  << (gigabytes > 0 ? cpu_seconds / gigabytes : 0) << " CPU s/GB, "
+                  << std::setprecision(0) << results.market.size() / results.seconds
+                  << " catalogs/s" << std::endl;
+    }
+    return 0;
+}
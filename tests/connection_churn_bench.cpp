@@ -0,0 +1,76 @@
+/*
+ * Conexiones por segundo que atiende el server cuando los clientes entran
+ * y salen sin parar (véase `ReceiveStatus` e `IoStatus`: los cortes ya no
+ * pasan por excepciones).
+ *
+ * Cada cliente se conecta, se registra, pide el auto actual y corta. Se
+ * mide con cierre normal (el server ve fin de archivo) y con cierre
+ * abortivo (`SO_LINGER` en 0: el server ve ECONNRESET).
+ * */
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <sys/socket.h>
+
+#include "../common_src/common_constants.h"
+#include "../common_src/common_protocol.h"
+#include "../common_src/common_socket.h"
+#include "../common_src/liberror.h"
+
+#include "test_bench_server.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int CONNECTIONS = 5000;
+
+void visit(const std::string& port, bool reset) {
+    Protocol client(Socket("127.0.0.1", port.c_str()));
+    client.send_user_registration(UserDto("churn"));
+    if (client.receive_command() != SEND_INITIAL_MONEY) {
+        throw std::runtime_error("registration failed");
+    }
+    client.receive_initial_balance();
+
+    client.send_current_car_request();
+    if (client.receive_command() != SEND_ERROR_MESSAGE) {
+        throw std::runtime_error("unexpected current car");
+    }
+    client.receive_error_notification();
+
+    if (reset) {
+        struct linger linger = {1, 0};
+        if (::setsockopt(client.get_fd(), SOL_SOCKET, SO_LINGER, &linger, sizeof(linger)) ==
+            -1) {
+            throw LibError(errno, "setsockopt SO_LINGER failed");
+        }
+    }
+}
+
+void bench_churn(const std::string& port, const char* name, bool reset) {
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < CONNECTIONS; i++) {
+        visit(port, reset);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "  " << std::left << std::setw(16) << name << std::right << std::fixed
+              << std::setprecision(0) << std::setw(8) << CONNECTIONS / seconds
+              << " connections/s" << std::endl;
+}
+
+}  // namespace
+
+int main() {
+    BenchServer server(3, 100000);
+
+    std::cout << "Connection churn: " << CONNECTIONS
+              << " clients that register, ask for their car and leave" << std::endl;
+    bench_churn(server.get_port(), "clean close", false);
+    bench_churn(server.get_port(), "reset", true);
+    return 0;
+}
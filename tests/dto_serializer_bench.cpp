@@ -0,0 +1,159 @@
+/*
+ * Serializadores generados (véase `DtoSerializer`) contra el código por
+ * campo que reemplazaron, reproducido acá tal cual era.
+ *
+ *   - Codificar: un `extend` con el tamaño exacto contra un
+ *     `append_*` (con su chequeo de capacidad) por campo.
+ *   - Decodificar de un par de sockets unix: un `recvall` por tramo
+ *     entre largos de strings contra uno por campo.
+ *
+ * Se informa en ns por mensaje.
+ * */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+
+#include "../common_src/common_dto_serializer.h"
+#include "../common_src/common_protocol.h"
+#include "../common_src/common_socket.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int ENCODE_ROUNDS = 200000;
+// Mensajes por tanda al decodificar: entran enteros en el buffer del socket
+const int DECODE_BATCH = 1000;
+const int DECODE_BATCHES = 50;
+
+// ==== CÓDIGO POR CAMPO (el de antes de los serializadores generados) ====
+
+void encode_by_field(const MoneyDto& money, MessageBuffer& buffer) {
+    buffer.append_uint32(money.amount);
+}
+
+void encode_by_field(const CarDto& car, MessageBuffer& buffer) {
+    buffer.append_string(car.name);
+    buffer.append_uint16(car.year);
+    buffer.append_uint32(car.price);
+}
+
+void encode_by_field(const CarPurchaseDto& purchase, MessageBuffer& buffer) {
+    encode_by_field(purchase.car, buffer);
+    buffer.append_uint32(purchase.remaining_money);
+}
+
+void receive_by_field(Socket& socket, MoneyDto& money) {
+    uint32_t amount;
+    socket.recvall(&amount, sizeof(amount));
+    money.amount = ntohl(amount);
+}
+
+void receive_by_field(Socket& socket, CarDto& car) {
+    uint16_t name_length;
+    socket.recvall(&name_length, sizeof(name_length));
+    name_length = ntohs(name_length);
+
+    std::string name(name_length, '\0');
+    socket.recvall(&name[0], name_length);
+
+    uint16_t year;
+    socket.recvall(&year, sizeof(year));
+    uint32_t price;
+    socket.recvall(&price, sizeof(price));
+    car = CarDto(name, ntohs(year), ntohl(price));
+}
+
+void receive_by_field(Socket& socket, CarPurchaseDto& purchase) {
+    receive_by_field(socket, purchase.car);
+    uint32_t remaining_money;
+    socket.recvall(&remaining_money, sizeof(remaining_money));
+    purchase.remaining_money = ntohl(remaining_money);
+}
+
+// ==== MEDICIÓN ====
+
+double nanoseconds_per(Clock::duration duration, int messages) {
+    return std::chrono::duration<double, std::nano>(duration).count() / messages;
+}
+
+template <typename Dto>
+void bench_dto(const char* name, const Dto& dto) {
+    MessageBuffer buffer;
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < ENCODE_ROUNDS; i++) {
+        buffer.clear();
+        encode_by_field(dto, buffer);
+    }
+    double encode_field = nanoseconds_per(Clock::now() - start, ENCODE_ROUNDS);
+
+    start = Clock::now();
+    for (int i = 0; i < ENCODE_ROUNDS; i++) {
+        buffer.clear();
+        DtoSerializer<Dto>::encode(dto, buffer);
+    }
+    double encode_generated = nanoseconds_per(Clock::now() - start, ENCODE_ROUNDS);
+
+    // Una tanda de mensajes ya en el socket, lista para leer
+    MessageBuffer batch;
+    for (int i = 0; i < DECODE_BATCH; i++) {
+        DtoSerializer<Dto>::encode(dto, batch);
+    }
+    std::pair<Socket, Socket> sockets = Socket::pair();
+    std::vector<uint8_t> scratch;
+    Dto received;
+
+    Clock::duration decode_field = Clock::duration::zero();
+    Clock::duration decode_generated = Clock::duration::zero();
+    for (int i = 0; i < DECODE_BATCHES; i++) {
+        sockets.first.sendall(batch.data(), batch.size());
+        start = Clock::now();
+        for (int j = 0; j < DECODE_BATCH; j++) {
+            receive_by_field(sockets.second, received);
+        }
+        decode_field += Clock::now() - start;
+
+        sockets.first.sendall(batch.data(), batch.size());
+        start = Clock::now();
+        for (int j = 0; j < DECODE_BATCH; j++) {
+            received = DtoSerializer<Dto>::receive(sockets.second, scratch);
+        }
+        decode_generated += Clock::now() - start;
+    }
+    // Lo recibido se vuelve a codificar igual que el original
+    MessageBuffer original;
+    MessageBuffer decoded_again;
+    DtoSerializer<Dto>::encode(dto, original);
+    DtoSerializer<Dto>::encode(received, decoded_again);
+    if (original.size() != decoded_again.size() ||
+        !std::equal(original.data(), original.data() + original.size(), decoded_again.data())) {
+        throw std::runtime_error(std::string(name) + " decoded wrong");
+    }
+
+    int decoded = DECODE_BATCH * DECODE_BATCHES;
+    std::cout << "  " << std::left << std::setw(16) << name << std::right << std::fixed
+              << std::setprecision(0) << "encode " << std::setw(5) << encode_field << " -> "
+              << std::setw(5) << encode_generated << " ns   decode " << std::setw(5)
+              << nanoseconds_per(decode_field, decoded) << " -> " << std::setw(5)
+              << nanoseconds_per(decode_generated, decoded) << " ns" << std::endl;
+}
+
+}  // namespace
+
+int main() {
+    std::cout << "DTO serializers, per message: by field -> generated" << std::endl;
+    CarDto car("ToyotaCorollaCross", 2022, 3150000);
+    bench_dto("MoneyDto", MoneyDto(1000000));
+    bench_dto("CarDto", car);
+    bench_dto("CarPurchaseDto", CarPurchaseDto(car, 6850000));
+    return 0;
+}
@@ -0,0 +1,311 @@
+/*
+ * Latencia del fan-out de un cambio del catálogo a 10k suscriptos.
+ *
+ * El proceso padre hace de server: acepta las conexiones TCP por
+ * loopback, las suscribe a un `MarketBroadcaster` con la cola de salida
+ * de las sesiones y, en cada vuelta, cambia un precio, publica el delta
+ * y vacía las colas (lo que haría el loop del `Server` al poder escribir).
+ * Un proceso hijo tiene los extremos de los clientes, espera con `epoll`
+ * y anota cuándo le llegó el push a cada uno.
+ *
+ * Son dos procesos porque 10k conexiones de los dos lados no entran en
+ * el límite de descriptores de uno solo. Ambos usan el mismo reloj
+ * monótono: el padre le pasa al hijo, por un pipe, el instante en que
+ * empezó a publicar y cuánto tardó.
+ *
+ * Se informa el tiempo de publicar (serializar y encolar para todos) y de
+ * vaciar las colas, y la latencia de cada entrega (p50, p99 y máxima),
+ * además de cuánto tardó en llegarle al último suscripto de cada vuelta.
+ * */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../common_src/common_constants.h"
+#include "../common_src/common_protocol.h"
+#include "../common_src/common_socket.h"
+#include "../common_src/liberror.h"
+#include "../server_src/server_market_broadcaster.h"
+#include "../server_src/server_market_catalog.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t SUBSCRIBERS = 10000;
+const int WARMUP_ROUNDS = 2;
+const int MEASURED_ROUNDS = 20;
+/*
+ * Los clientes se conectan de a tandas y esperan a que el padre las
+ * acepte: la cola del aceptador es de 20 (véase `Socket`) y, llena, cada
+ * conexión de más tarda un reintento de SYN (1 s).
+ * */
+const size_t CONNECT_BATCH = 16;
+// Lo que cada sesión del server puede tener encolado (véase `ClientSession`)
+const size_t MAX_OUTPUT = 8 * 1024 * 1024;
+
+// Lo que el padre le pasa al hijo por cada vuelta
+struct RoundTimes {
+    int64_t start;    // Antes de publicar (`Clock`, en ns)
+    int64_t publish;  // Serializar y encolar para todos (ns)
+    int64_t flush;    // Vaciar las colas (ns)
+};
+
+void write_all(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written == -1) {
+            throw LibError(errno, "pipe write failed");
+        }
+        bytes += written;
+        size -= written;
+    }
+}
+
+void read_all(int fd, void* data, size_t size) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t got = ::read(fd, bytes, size);
+        if (got == -1) {
+            throw LibError(errno, "pipe read failed");
+        }
+        if (got == 0) {
+            throw std::runtime_error("pipe closed");
+        }
+        bytes += got;
+        size -= got;
+    }
+}
+
+int64_t nanoseconds(Clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+int64_t percentile(std::vector<int64_t>& values, double fraction) {
+    size_t index = static_cast<size_t>(fraction * (values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+void print_us(const char* name, std::vector<int64_t>& values) {
+    std::cout << "  " << std::left << std::setw(24) << name << std::right << std::fixed
+              << std::setprecision(1) << "p50 " << std::setw(9) << percentile(values, 0.5) / 1e3
+              << " us   p99 " << std::setw(9) << percentile(values, 0.99) / 1e3
+              << " us   max " << std::setw(9) << percentile(values, 1.0) / 1e3 << " us"
+              << std::endl;
+}
+
+/*
+ * Suscriptos: conecta `subscribers` clientes (de a tandas que el padre
+ * confirma por `rounds_in`), avisa por `ready` y en cada vuelta espera el
+ * push en todos antes de leer los tiempos del padre y confirmarle que
+ * puede seguir.
+ * */
+int run_subscribers(const std::string& port, size_t subscribers, int ready, int rounds_in) {
+    std::vector<Protocol> clients;
+    clients.reserve(subscribers);
+    char ok = 1;
+    for (size_t i = 0; i < subscribers; i++) {
+        clients.emplace_back(Socket("127.0.0.1", port.c_str()));
+        if ((i + 1) % CONNECT_BATCH == 0 || i + 1 == subscribers) {
+            read_all(rounds_in, &ok, 1);
+        }
+    }
+
+    int epoll_fd = ::epoll_create1(0);
+    if (epoll_fd == -1) {
+        throw LibError(errno, "epoll_create1 failed");
+    }
+    for (size_t i = 0; i < subscribers; i++) {
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = i;
+        if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clients[i].get_fd(), &event) == -1) {
+            throw LibError(errno, "epoll_ctl failed");
+        }
+    }
+    write_all(ready, &ok, 1);
+
+    std::vector<struct epoll_event> events(1024);
+    std::vector<int64_t> arrivals(subscribers);
+    std::vector<int64_t> delivery;
+    std::vector<int64_t> last_delivery;
+    std::vector<int64_t> publish;
+    std::vector<int64_t> flush;
+    for (int round = 0; round < WARMUP_ROUNDS + MEASURED_ROUNDS; round++) {
+        size_t received = 0;
+        while (received < subscribers) {
+            int count = ::epoll_wait(epoll_fd, events.data(), events.size(), -1);
+            if (count == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw LibError(errno, "epoll_wait failed");
+            }
+            int64_t now = nanoseconds(Clock::now().time_since_epoch());
+            for (int i = 0; i < count; i++) {
+                Protocol& client = clients[events[i].data.u64];
+                if (client.receive_command() != PUSH_MARKET_UPDATE) {
+                    throw std::runtime_error("unexpected message");
+                }
+                client.receive_market_update();
+                arrivals[events[i].data.u64] = now;
+                received++;
+            }
+        }
+
+        RoundTimes times;
+        read_all(rounds_in, &times, sizeof(times));
+        write_all(ready, &ok, 1);
+        if (round < WARMUP_ROUNDS) {
+            continue;
+        }
+        for (int64_t arrival: arrivals) {
+            delivery.push_back(arrival - times.start);
+        }
+        last_delivery.push_back(*std::max_element(arrivals.begin(), arrivals.end()) -
+                                times.start);
+        publish.push_back(times.publish);
+        flush.push_back(times.flush);
+    }
+    ::close(epoll_fd);
+
+    std::cout << "Fan-out of a price change to " << subscribers << " subscribers over loopback ("
+              << MEASURED_ROUNDS << " rounds after " << WARMUP_ROUNDS << " warm-up)"
+              << std::endl;
+    print_us("publish (enqueue)", publish);
+    print_us("flush queues", flush);
+    print_us("delivery latency", delivery);
+    print_us("last subscriber", last_delivery);
+    return 0;
+}
+
+// Cuántos suscriptos entran en el límite de descriptores de cada proceso
+size_t fit_subscribers() {
+    struct rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        throw LibError(errno, "getrlimit failed");
+    }
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+
+    // Los estándar, el aceptador, los pipes y el epoll
+    const rlim_t RESERVED = 16;
+    if (limit.rlim_cur >= SUBSCRIBERS + RESERVED) {
+        return SUBSCRIBERS;
+    }
+    size_t fit = limit.rlim_cur > RESERVED ? limit.rlim_cur - RESERVED : 0;
+    std::cout << "  open files limited to " << limit.rlim_cur << ": using " << fit
+              << " subscribers" << std::endl;
+    return fit;
+}
+
+}  // namespace
+
+int main() {
+    size_t subscribers = fit_subscribers();
+
+    MarketCatalog market;
+    market.load_car(CarDto("ToyotaCorolla", 2018, 1200000));
+    market.load_car(CarDto("HondaCivic", 2020, 1400000));
+    market.load_car(CarDto("FordFocus", 2017, 1100000));
+    MarketBroadcaster broadcaster;
+
+    // Puerto libre cualquiera
+    Socket acceptor("0");
+    struct sockaddr_in address = {};
+    socklen_t address_length = sizeof(address);
+    if (::getsockname(acceptor.get_fd(), reinterpret_cast<struct sockaddr*>(&address),
+                      &address_length) == -1) {
+        throw LibError(errno, "getsockname failed");
+    }
+    std::string port = std::to_string(ntohs(address.sin_port));
+
+    int ready[2];
+    int rounds[2];
+    if (::pipe(ready) == -1 || ::pipe(rounds) == -1) {
+        throw LibError(errno, "pipe failed");
+    }
+    std::cout.flush();
+    pid_t child = ::fork();
+    if (child == -1) {
+        throw LibError(errno, "fork failed");
+    }
+    if (child == 0) {
+        acceptor.close();
+        ::close(ready[0]);
+        ::close(rounds[1]);
+        int status = run_subscribers(port, subscribers, ready[1], rounds[0]);
+        std::cout.flush();
+        ::_exit(status);
+    }
+    ::close(ready[1]);
+    ::close(rounds[0]);
+
+    std::vector<std::unique_ptr<Protocol>> sessions;
+    sessions.reserve(subscribers);
+    char ok = 1;
+    for (size_t i = 0; i < subscribers; i++) {
+        sessions.push_back(std::make_unique<Protocol>(acceptor.accept(true)));
+        sessions.back()->enable_output_queue(MAX_OUTPUT);
+        broadcaster.subscribe(*sessions.back());
+        if ((i + 1) % CONNECT_BATCH == 0 || i + 1 == subscribers) {
+            write_all(rounds[1], &ok, 1);
+        }
+    }
+    read_all(ready[0], &ok, 1);
+
+    uint32_t price = 1200000;
+    for (int round = 0; round < WARMUP_ROUNDS + MEASURED_ROUNDS; round++) {
+        uint32_t previous_version = market.version();
+        price += 100;
+
+        Clock::time_point start = Clock::now();
+        market.reprice_car("ToyotaCorolla", price);
+        MarketDeltaDto delta;
+        market.build_delta_since(previous_version, delta);
+        if (broadcaster.publish(delta) != sessions.size()) {
+            throw std::runtime_error("subscriber closed");
+        }
+        Clock::time_point published = Clock::now();
+
+        // Las colas son chicas: en loopback entran enteras en el buffer del socket
+        for (const auto& session: sessions) {
+            while (session->pending_output() > 0) {
+                if (session->flush_output(SIZE_MAX) == IoStatus::Closed) {
+                    throw std::runtime_error("subscriber closed");
+                }
+            }
+        }
+        Clock::time_point flushed = Clock::now();
+
+        RoundTimes times{nanoseconds(start.time_since_epoch()), nanoseconds(published - start),
+                         nanoseconds(flushed - published)};
+        write_all(rounds[1], &times, sizeof(times));
+        read_all(ready[0], &ok, 1);
+    }
+
+    int status;
+    if (::waitpid(child, &status, 0) == -1) {
+        throw LibError(errno, "waitpid failed");
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
@@ -0,0 +1,68 @@
+/*
+ * Memoria que retiene el server por cada conexión inactiva (véase
+ * `BufferPool`).
+ *
+ * Cada cliente se registra, pide una vez el catálogo de 1500 autos
+ * (~35 KB de respuesta) y queda conectado sin pedir nada más. Se mide la
+ * memoria residente del server antes y después: lo que crece, repartido
+ * entre las conexiones, es lo que cada una retiene cuando no hace nada.
+ * Antes de medir la base un cliente pide el catálogo, para que no cuente
+ * lo que el server arma una sola vez para todos.
+ * */
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "../common_src/common_constants.h"
+#include "../common_src/common_protocol.h"
+#include "../common_src/common_socket.h"
+
+#include "test_bench_server.h"
+
+namespace {
+
+const size_t CATALOG_CARS = 1500;
+const size_t CONNECTIONS = 1000;
+
+std::unique_ptr<Protocol> connect_and_fetch_catalog(const std::string& port) {
+    auto client = std::make_unique<Protocol>(Socket("127.0.0.1", port.c_str()));
+    client->send_user_registration(UserDto("idle"));
+    if (client->receive_command() != SEND_INITIAL_MONEY) {
+        throw std::runtime_error("registration failed");
+    }
+    client->receive_initial_balance();
+
+    client->send_market_info_request();
+    if (client->receive_command() != SEND_MARKET_INFO) {
+        throw std::runtime_error("catalog request failed");
+    }
+    if (client->receive_market_catalog().cars.size() != CATALOG_CARS) {
+        throw std::runtime_error("catalog incomplete");
+    }
+    return client;
+}
+
+}  // namespace
+
+int main() {
+    BenchServer server(CATALOG_CARS, 100000);
+
+    std::vector<std::unique_ptr<Protocol>> clients;
+    clients.push_back(connect_and_fetch_catalog(server.get_port()));
+    size_t baseline = server.resident_memory();
+
+    for (size_t i = 1; i <= CONNECTIONS; i++) {
+        clients.push_back(connect_and_fetch_catalog(server.get_port()));
+    }
+    size_t loaded = server.resident_memory();
+
+    std::cout << "Server memory with " << CONNECTIONS << " idle connections after a "
+              << CATALOG_CARS << "-car catalog each" << std::endl;
+    std::cout << "  resident " << baseline / 1024 << " KiB -> " << loaded / 1024 << " KiB: "
+              << (loaded > baseline ? (loaded - baseline) / CONNECTIONS : 0)
+              << " bytes per idle connection" << std::endl;
+    return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * Control de sobrecarga bajo el doble de la carga que el server soporta
+ * (véase `LoadShedder`).
+ *
+ * Con un catálogo de 1500 autos se mide primero la capacidad: cuántos
+ * catálogos por segundo responde el server con conexiones en lazo
+ * cerrado. Después se le manda el doble en lazo abierto, con un 10% de
+ * compras, sin control de sobrecarga y con el de siempre (comando `shed`
+ * de la consola): los pedidos de catálogo que esperan de más se rechazan
+ * con "Server busy".
+ * */
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+
+#include "test_bench_server.h"
+#include "test_load_generator.h"
+
+namespace {
+
+const size_t CATALOG_CARS = 1500;
+const size_t CONNECTIONS = 32;
+const double OVERLOAD = 2.0;
+const double PURCHASES = 0.1;
+
+void run_overload(LoadGenerator& load, double capacity, const char* name) {
+    LoadGenerator::Results open =
+            load.run_open(std::chrono::seconds(2), OVERLOAD * capacity, PURCHASES);
+    size_t sent = open.market.size() + open.market_busy.size() + open.purchase.size();
+
+    std::cout << "Open loop at " << std::setprecision(1) << OVERLOAD << "x, " << name << " ("
+              << std::setprecision(0) << sent / open.seconds << " requests/s, "
+              << 100 * PURCHASES << "% purchases): " << open.market_busy.size() << " shed"
+              << std::endl;
+    LoadGenerator::print_latencies("catalog", open.market);
+    LoadGenerator::print_latencies("server busy", open.market_busy);
+    LoadGenerator::print_latencies("purchase", open.purchase);
+}
+
+}  // namespace
+
+int main() {
+    BenchServer server(CATALOG_CARS, 1000000);
+    LoadGenerator load(server.get_port(), CONNECTIONS, "ToyotaModel0");
+
+    LoadGenerator::Results closed = load.run_closed(
+            std::chrono::seconds(1), [](size_t) { return LoadGenerator::Request::Market; });
+    double capacity = (closed.market.size() + closed.market_busy.size()) / closed.seconds;
+    std::cout << std::fixed << std::setprecision(0) << "Capacity with " << CONNECTIONS
+              << " connections in closed loop: " << capacity << " catalogs/s ("
+              << CATALOG_CARS << " cars)" << std::endl;
+    LoadGenerator::print_latencies("catalog", closed.market);
+
+    // Objetivo 0: sin control de sobrecarga (véase `LoadShedder::configure`)
+    server.console("shed 0 100");
+    run_overload(load, capacity, "no shedding");
+    server.console("shed 5 100");
+    run_overload(load, capacity, "shedding (5 ms target)");
+    return 0;
+}
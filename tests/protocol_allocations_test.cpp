@@ -0,0 +1,348 @@
+/*
+ * Reservas de memoria por mensaje del protocolo.
+ *
+ * Cada comando va y viene por dos `Protocol` sobre un par de sockets
+ * unix, como en una conexión real: los pedidos los envía el cliente
+ * (bloqueante) y el server los recibe con `receive_available`; las
+ * respuestas las encola el server y el cliente las recibe bloqueando.
+ *
+ * Tras unas vueltas de calentamiento (buffers que crecen, el pool) se
+ * cuentan los `operator new` de cada vuelta (véase `AllocCounter`) y el
+ * test falla si algún comando pasa de su presupuesto. Los presupuestos
+ * son los medidos: si un cambio los baja, hay que bajarlos acá también.
+ * */
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "../common_src/common_arena.h"
+#include "../common_src/common_constants.h"
+#include "../common_src/common_protocol.h"
+#include "../common_src/common_socket.h"
+#include "../common_src/common_views.h"
+
+#include "test_alloc_counter.h"
+
+namespace {
+
+const int WARMUP_ROUNDS = 4;
+const int MEASURED_ROUNDS = 16;
+
+// Los dos extremos de una conexión; el server como el real: no bloqueante y con cola
+struct Connection {
+    Protocol client;
+    Protocol server;
+    RequestArena arena;
+
+    explicit Connection(std::pair<Socket, Socket> sockets):
+            client(std::move(sockets.first)), server(std::move(sockets.second)) {
+        server.enable_output_queue(1024 * 1024);
+    }
+
+    // Lo que envió el cliente, ya completo del lado del server
+    void deliver_request() {
+        ReceiveStatus status;
+        while ((status = server.receive_available()) == ReceiveStatus::WouldBlock) {}
+        if (status != ReceiveStatus::Complete) {
+            throw std::runtime_error("request not received");
+        }
+    }
+
+    // Lo que encoló el server, ya en el socket del cliente
+    void deliver_reply() {
+        while (server.pending_output() > 0) {
+            if (server.flush_output() == IoStatus::Closed) {
+                throw std::runtime_error("reply not sent");
+            }
+        }
+    }
+
+    void expect(uint8_t received, uint8_t expected) {
+        if (received != expected) {
+            throw std::runtime_error("unexpected command");
+        }
+    }
+};
+
+std::pair<Socket, Socket> server_nonblocking(std::pair<Socket, Socket> sockets) {
+    sockets.second.set_nonblocking(true);
+    return sockets;
+}
+
+struct Case {
+    const char* name;
+    uint8_t command;
+    uint64_t budget;  // `operator new` por vuelta, ya en régimen
+    std::function<void(Connection&)> round;
+};
+
+// Nombres de hasta 15 caracteres: caben en el string sin reservar (SSO)
+std::vector<CarDto> sample_cars() {
+    return {CarDto("ToyotaCorolla", 2018, 1200000), CarDto("HondaCivic", 2020, 1400000),
+            CarDto("FordFocus", 2017, 1100000)};
+}
+
+std::shared_ptr<const SharedMessage> encoded_catalog(const MarketDto& market, uint8_t encoding) {
+    MessageBuffer message;
+    Protocol::encode_market_catalog(market, encoding, message);
+    return std::make_shared<const SharedMessage>(std::move(message), MessageTransfer::Copy);
+}
+
+}  // namespace
+
+int main() {
+    const MarketDto market(sample_cars());
+    const CarDto car = market.cars[0];
+    const SessionToken token{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+
+    // Lo que el server arma una vez y reenvía (véase `MarketCatalog`, `MarketBroadcaster`)
+    auto plain_catalog = encoded_catalog(market, MARKET_ENCODING_PLAIN);
+    auto compact_catalog = encoded_catalog(market, MARKET_ENCODING_COMPACT);
+    auto columns_catalog = encoded_catalog(market, MARKET_ENCODING_COLUMNS);
+
+    MarketDeltaDto delta;
+    delta.from_version = 3;
+    delta.to_version = 5;
+    delta.added.push_back(market.cars[1]);
+    delta.removed.emplace_back("FordFocus");
+    delta.repriced.emplace_back("ToyotaCorolla", 1150000);
+    MessageBuffer update;
+    Protocol::encode_market_update(delta, update);
+
+    const MarketSnapshotDto snapshot(5, market.cars);
+
+    std::vector<Case> cases = {
+            // ==== PEDIDOS (cliente -> server) ====
+            {"SEND_USERNAME", SEND_USERNAME, 0,
+             [](Connection& c) {
+                 c.client.send_user_registration(UserDto("juan"));
+                 c.deliver_request();
+                 c.expect(c.server.receive_command(), SEND_USERNAME);
+                 c.server.receive_user_registration();
+             }},
+            {"RESUME_SESSION", RESUME_SESSION, 0,
+             [&](Connection& c) {
+                 c.client.send_session_resume(SessionResumeDto(token, "juan"));
+                 c.deliver_request();
+                 c.expect(c.server.receive_command(), RESUME_SESSION);
+                 c.server.receive_session_resume();
+             }},
+            {"GET_CURRENT_CAR", GET_CURRENT_CAR, 0,
+             [](Connection& c) {
+                 c.client.send_current_car_request();
+                 c.deliver_request();
+                 c.expect(c.server.receive_command(), GET_CURRENT_CAR);
+             }},
+            {"GET_MARKET_INFO", GET_MARKET_INFO, 0,
+             [](Connection& c) {
+                 c.client.send_market_info_request();
+                 c.deliver_request();
+                 c.expect(c.server.receive_command(), GET_MARKET_INFO);
+             }},
+            {"BUY_CAR", BUY_CAR, 0,
+             [](Connection& c) {
+                 c.client.send_car_purchase_request("ToyotaCorolla");
+                 c.deliver_request();
+                 c.expect(c.server.receive_command(), BUY_CAR);
+                 c.server.receive_car_purchase_request(c.arena.get());
+                 c.arena.reset();
+             }},
+            {"GET_MARKET_SYNC", GET_MARKET_SYNC, 0,
+             [](Connection& c) {
+                 c.client.send_market_sync_request(MarketVersionDto(3));
+                 c.deliver_request();
+                 c.expect(c.server.receive_command(), GET_MARKET_SYNC);
+                 c.server.receive_market_sync_request();
+             }},
+            {"SUBSCRIBE_MARKET", SUBSCRIBE_MARKET, 0,
+             [](Connection& c) {
+                 c.client.send_market_subscription_request(MarketVersionDto(3));
+                 c.deliver_request();
+                 c.expect(c.server.receive_command(), SUBSCRIBE_MARKET);
+                 c.server.receive_market_subscription_request();
+             }},
+            {"NEGOTIATE_MARKET_ENCODING", NEGOTIATE_MARKET_ENCODING, 0,
+             [](Connection& c) {
+                 c.client.send_market_encoding_request(MarketEncodingDto(
+                         MARKET_ENCODING_PLAIN | MARKET_ENCODING_COMPACT));
+                 c.deliver_request();
+                 c.expect(c.server.receive_command(), NEGOTIATE_MARKET_ENCODING);
+                 c.server.receive_market_encoding_request();
+             }},
+            {"SEND_BATCH", SEND_BATCH, 0,
+             [](Connection& c) {
+                 c.client.begin_batch();
+                 c.client.send_current_car_request();
+                 c.client.send_car_purchase_request("HondaCivic");
+                 c.client.send_batch_request();
+                 c.deliver_request();
+                 c.expect(c.server.receive_command(), SEND_BATCH);
+                 c.server.receive_batch_size();
+                 c.expect(c.server.receive_command(), GET_CURRENT_CAR);
+                 c.expect(c.server.receive_command(), BUY_CAR);
+                 c.server.receive_car_purchase_request(c.arena.get());
+                 c.arena.reset();
+             }},
+
+            /*
+             * ==== RESPUESTAS (server -> cliente) ====
+             *
+             * Las que se reciben como DTO con vectores (catálogo, delta) reservan
+             * esos vectores, que son el resultado; la vista no reserva nada.
+             * */
+            {"SEND_INITIAL_MONEY", SEND_INITIAL_MONEY, 0,
+             [](Connection& c) {
+                 c.server.send_initial_balance(MoneyDto(1000));
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_INITIAL_MONEY);
+                 c.client.receive_initial_balance();
+             }},
+            {"SEND_SESSION_TOKEN", SEND_SESSION_TOKEN, 0,
+             [&](Connection& c) {
+                 c.server.send_session(SessionDto(token, 1000, true));
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_SESSION_TOKEN);
+                 c.client.receive_session();
+             }},
+            {"SEND_CURRENT_CAR", SEND_CURRENT_CAR, 0,
+             [&](Connection& c) {
+                 c.server.send_current_car_info(car);
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_CURRENT_CAR);
+                 c.client.receive_current_car_info();
+             }},
+            {"SEND_MARKET_INFO (view)", SEND_MARKET_INFO, 0,
+             [&](Connection& c) {
+                 c.server.send_shared_message(plain_catalog);
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_MARKET_INFO);
+                 c.client.receive_market_catalog_view();
+             }},
+            {"SEND_MARKET_INFO (dto)", SEND_MARKET_INFO, 1,
+             [&](Connection& c) {
+                 c.server.send_shared_message(plain_catalog);
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_MARKET_INFO);
+                 c.client.receive_market_catalog();
+             }},
+            {"SEND_MARKET_INFO_COMPACT", SEND_MARKET_INFO_COMPACT, 2,
+             [&](Connection& c) {
+                 c.server.send_shared_message(compact_catalog);
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_MARKET_INFO_COMPACT);
+                 c.client.receive_market_catalog_compact();
+             }},
+            {"SEND_MARKET_INFO_COLUMNS", SEND_MARKET_INFO_COLUMNS, 4,
+             [&](Connection& c) {
+                 c.server.send_shared_message(columns_catalog);
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_MARKET_INFO_COLUMNS);
+                 c.client.receive_market_catalog_columns();
+             }},
+            {"SEND_CAR_BOUGHT", SEND_CAR_BOUGHT, 0,
+             [&](Connection& c) {
+                 c.server.send_purchase_confirmation(CarPurchaseDto(car, 880, c.arena.get()));
+                 c.arena.reset();
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_CAR_BOUGHT);
+                 c.client.receive_purchase_confirmation();
+             }},
+            {"SEND_ERROR_MESSAGE", SEND_ERROR_MESSAGE, 0,
+             [](Connection& c) {
+                 c.server.send_error_notification(ErrorDto("Car not found", c.arena.get()));
+                 c.arena.reset();
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_ERROR_MESSAGE);
+                 c.client.receive_error_notification();
+             }},
+            {"SEND_MARKET_UP_TO_DATE", SEND_MARKET_UP_TO_DATE, 0,
+             [](Connection& c) {
+                 c.server.send_market_up_to_date(MarketVersionDto(5));
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_MARKET_UP_TO_DATE);
+                 c.client.receive_market_up_to_date();
+             }},
+            {"SEND_MARKET_DELTA", SEND_MARKET_DELTA, 3,
+             [&](Connection& c) {
+                 c.server.send_market_delta(delta);
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_MARKET_DELTA);
+                 c.client.receive_market_delta();
+             }},
+            {"SEND_MARKET_SNAPSHOT", SEND_MARKET_SNAPSHOT, 1,
+             [&](Connection& c) {
+                 c.server.send_market_snapshot(snapshot);
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_MARKET_SNAPSHOT);
+                 c.client.receive_market_snapshot();
+             }},
+            {"SEND_MARKET_ENCODING", SEND_MARKET_ENCODING, 0,
+             [](Connection& c) {
+                 c.server.send_market_encoding(MarketEncodingDto(MARKET_ENCODING_COMPACT));
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_MARKET_ENCODING);
+                 c.client.receive_market_encoding();
+             }},
+            {"SEND_BATCH_REPLY", SEND_BATCH_REPLY, 0,
+             [&](Connection& c) {
+                 c.server.begin_batch();
+                 c.server.send_current_car_info(car);
+                 c.server.send_error_notification(ErrorDto("Car not found", c.arena.get()));
+                 c.server.send_batch_reply();
+                 c.arena.reset();
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), SEND_BATCH_REPLY);
+                 c.client.receive_batch_size();
+                 c.expect(c.client.receive_command(), SEND_CURRENT_CAR);
+                 c.client.receive_current_car_info();
+                 c.expect(c.client.receive_command(), SEND_ERROR_MESSAGE);
+                 c.client.receive_error_notification();
+             }},
+            {"PUSH_MARKET_UPDATE", PUSH_MARKET_UPDATE, 3,
+             [&](Connection& c) {
+                 c.server.send_encoded_message(update);
+                 c.deliver_reply();
+                 c.expect(c.client.receive_command(), PUSH_MARKET_UPDATE);
+                 c.client.receive_market_update();
+             }},
+    };
+
+    Connection connection(server_nonblocking(Socket::pair()));
+    int failures = 0;
+
+    std::cout << "Allocations per round after " << WARMUP_ROUNDS << " warm-up rounds (max of "
+              << MEASURED_ROUNDS << ")" << std::endl;
+    for (const Case& test_case: cases) {
+        for (int i = 0; i < WARMUP_ROUNDS; i++) {
+            test_case.round(connection);
+        }
+
+        uint64_t worst = 0;
+        for (int i = 0; i < MEASURED_ROUNDS; i++) {
+            uint64_t before = AllocCounter::allocations();
+            test_case.round(connection);
+            worst = std::max(worst, AllocCounter::allocations() - before);
+        }
+
+        bool ok = worst <= test_case.budget;
+        failures += ok ? 0 : 1;
+        std::cout << "  0x" << std::hex << std::setw(2) << std::setfill('0')
+                  << static_cast<int>(test_case.command) << std::dec << std::setfill(' ') << ' '
+                  << std::left << std::setw(28) << test_case.name << std::right << std::setw(4)
+                  << worst << " (budget " << test_case.budget << ")"
+                  << (ok ? "" : "  OVER BUDGET") << std::endl;
+    }
+
+    if (failures > 0) {
+        std::cout << failures << " messages over their allocation budget" << std::endl;
+        return 1;
+    }
+    std::cout << "All messages within their allocation budget" << std::endl;
+    return 0;
+}
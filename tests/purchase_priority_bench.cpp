@@ -0,0 +1,47 @@
+/*
+ * Latencia de las compras con descargas del catálogo en curso (véase el
+ * carril prioritario y `SEND_CHUNK` en el `Server`).
+ *
+ * Con un catálogo de 60k autos (~1.4 MB por respuesta), un comprador en
+ * lazo cerrado compra una y otra vez: primero solo y después mientras
+ * otras 16 conexiones descargan el catálogo sin parar. Las compras no
+ * deberían esperar a que terminen los catálogos de los demás.
+ * */
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+
+#include "test_bench_server.h"
+#include "test_load_generator.h"
+
+namespace {
+
+const size_t CATALOG_CARS = 60000;
+const size_t DOWNLOADERS = 16;
+const std::chrono::seconds PHASE(2);
+
+}  // namespace
+
+int main() {
+    BenchServer server(CATALOG_CARS, 1000000);
+
+    LoadGenerator buyer(server.get_port(), 1, "ToyotaModel0");
+    LoadGenerator::Results alone =
+            buyer.run_closed(PHASE, [](size_t) { return LoadGenerator::Request::Purchase; });
+
+    // La conexión 0 compra y las demás descargan el catálogo
+    LoadGenerator mixed(server.get_port(), 1 + DOWNLOADERS, "ToyotaModel0");
+    LoadGenerator::Results loaded = mixed.run_closed(PHASE, [](size_t connection) {
+        return connection == 0 ? LoadGenerator::Request::Purchase : LoadGenerator::Request::Market;
+    });
+
+    std::cout << "Purchases in closed loop with a " << CATALOG_CARS << "-car catalog" << std::endl;
+    LoadGenerator::print_latencies("alone", alone.purchase);
+    std::cout << "With " << DOWNLOADERS << " connections downloading the catalog ("
+              << std::fixed << std::setprecision(0) << loaded.market.size() / loaded.seconds
+              << " catalogs/s)" << std::endl;
+    LoadGenerator::print_latencies("purchase", loaded.purchase);
+    LoadGenerator::print_latencies("catalog", loaded.market);
+    return 0;
+}
@@ -0,0 +1,206 @@
+/*
+ * El camino de un pedido en el server, ya en régimen, no reserva memoria.
+ *
+ * Una `ClientSession` real (catálogo, broadcaster, shedder, timers y
+ * sesiones guardadas como en el `Server`) atiende pedidos que llegan por
+ * un par de sockets unix. Se cuentan los `operator new` (véase
+ * `AllocCounter`) desde que la sesión empieza a leer el pedido hasta que
+ * terminó de enviar la respuesta: tras el calentamiento deben ser 0.
+ *
+ * La sincronización que responde con un delta o un snapshot queda
+ * afuera: arma el DTO con sus vectores a propósito (véase
+ * `ClientSession::send_market_sync`).
+ * */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <streambuf>
+#include <utility>
+#include <vector>
+
+#include "../common_src/common_constants.h"
+#include "../common_src/common_protocol.h"
+#include "../common_src/common_socket.h"
+#include "../common_src/common_views.h"
+#include "../server_src/server_load_shedder.h"
+#include "../server_src/server_market_broadcaster.h"
+#include "../server_src/server_market_catalog.h"
+#include "../server_src/server_session.h"
+#include "../server_src/server_session_store.h"
+#include "../server_src/server_timer_wheel.h"
+
+#include "test_alloc_counter.h"
+
+namespace {
+
+const int WARMUP_ROUNDS = 4;
+const int MEASURED_ROUNDS = 64;
+
+// Los handlers informan por stdout: se descarta sin dejar de formatearlo
+class DiscardBuffer: public std::streambuf {
+protected:
+    int overflow(int c) override { return traits_type::not_eof(c); }
+};
+
+struct Case {
+    const char* name;
+    std::function<void(Protocol&)> send_request;
+    std::function<void(Protocol&)> receive_reply;
+};
+
+void expect(uint8_t received, uint8_t expected) {
+    if (received != expected) {
+        throw std::runtime_error("unexpected reply");
+    }
+}
+
+}  // namespace
+
+int main() {
+    // Lo que el `Server` comparte entre sesiones
+    MarketCatalog market;
+    market.load_car(CarDto("ToyotaCorolla", 2018, 1200000));
+    market.load_car(CarDto("HondaCivic", 2020, 1400000));
+    market.load_car(CarDto("FordFocus", 2017, 1100000));
+    market.load_car(CarDto("Lamborghini", 2023, 900000000));
+    MarketBroadcaster broadcaster;
+    LoadShedder load_shedder(std::chrono::milliseconds(5), std::chrono::milliseconds(100));
+    TimerWheel timers;
+    SessionStore session_store(std::chrono::minutes(10), 1024);
+    const SessionTimeouts timeouts{std::chrono::seconds(10), std::chrono::seconds(10),
+                                   std::chrono::minutes(5)};
+
+    std::pair<Socket, Socket> sockets = Socket::pair();
+    sockets.second.set_nonblocking(true);
+    Protocol client(std::move(sockets.first));
+    ClientSession session(std::move(sockets.second), market, broadcaster, load_shedder, 1000000,
+                          8 * 1024 * 1024, timers, timeouts, session_store);
+
+    DiscardBuffer discard;
+    std::streambuf* stdout_buffer = std::cout.rdbuf(&discard);
+
+    // Atiende lo que mandó el cliente y envía la respuesta; retorna cuánto reservó
+    auto serve = [&]() {
+        uint64_t before = AllocCounter::allocations();
+        ReceiveStatus status;
+        while ((status = session.receive_next_message()) == ReceiveStatus::WouldBlock) {}
+        if (status != ReceiveStatus::Complete) {
+            throw std::runtime_error("request not received");
+        }
+        session.mark_readable(LoadShedder::Clock::now());
+        session.handle_received_message();
+        while (session.pending_output() > 0) {
+            if (session.flush_output(SIZE_MAX) == IoStatus::Closed) {
+                throw std::runtime_error("reply not sent");
+            }
+        }
+        return AllocCounter::allocations() - before;
+    };
+
+    // Registro (una vez, fuera de régimen) con token, para que las compras se guarden
+    client.send_session_resume(SessionResumeDto(SessionToken{}, "juan"));
+    serve();
+    expect(client.receive_command(), SEND_SESSION_TOKEN);
+    client.receive_session();
+
+    std::vector<Case> cases = {
+            {"GET_CURRENT_CAR", [](Protocol& p) { p.send_current_car_request(); },
+             [](Protocol& p) {
+                 uint8_t command = p.receive_command();
+                 if (command == SEND_CURRENT_CAR) {
+                     p.receive_current_car_info();
+                 } else {
+                     expect(command, SEND_ERROR_MESSAGE);
+                     p.receive_error_notification();
+                 }
+             }},
+            {"GET_MARKET_INFO", [](Protocol& p) { p.send_market_info_request(); },
+             [](Protocol& p) {
+                 expect(p.receive_command(), SEND_MARKET_INFO);
+                 p.receive_market_catalog_view();
+             }},
+            {"BUY_CAR (bought)", [](Protocol& p) { p.send_car_purchase_request("HondaCivic"); },
+             [](Protocol& p) {
+                 expect(p.receive_command(), SEND_CAR_BOUGHT);
+                 p.receive_purchase_confirmation();
+             }},
+            {"BUY_CAR (not found)", [](Protocol& p) { p.send_car_purchase_request("Trabant"); },
+             [](Protocol& p) {
+                 expect(p.receive_command(), SEND_ERROR_MESSAGE);
+                 p.receive_error_notification();
+             }},
+            {"BUY_CAR (no funds)", [](Protocol& p) { p.send_car_purchase_request("Lamborghini"); },
+             [](Protocol& p) {
+                 expect(p.receive_command(), SEND_ERROR_MESSAGE);
+                 p.receive_error_notification();
+             }},
+            {"GET_MARKET_SYNC (up to date)",
+             [&](Protocol& p) { p.send_market_sync_request(MarketVersionDto(market.version())); },
+             [](Protocol& p) {
+                 expect(p.receive_command(), SEND_MARKET_UP_TO_DATE);
+                 p.receive_market_up_to_date();
+             }},
+            {"NEGOTIATE_MARKET_ENCODING",
+             [](Protocol& p) {
+                 p.send_market_encoding_request(MarketEncodingDto(MARKET_ENCODING_PLAIN));
+             },
+             [](Protocol& p) {
+                 expect(p.receive_command(), SEND_MARKET_ENCODING);
+                 p.receive_market_encoding();
+             }},
+            {"SEND_BATCH",
+             [](Protocol& p) {
+                 p.begin_batch();
+                 p.send_current_car_request();
+                 p.send_car_purchase_request("Trabant");
+                 p.send_market_info_request();
+                 p.send_batch_request();
+             },
+             [](Protocol& p) {
+                 expect(p.receive_command(), SEND_BATCH_REPLY);
+                 p.receive_batch_size();
+                 expect(p.receive_command(), SEND_CURRENT_CAR);
+                 p.receive_current_car_info();
+                 expect(p.receive_command(), SEND_ERROR_MESSAGE);
+                 p.receive_error_notification();
+                 expect(p.receive_command(), SEND_MARKET_INFO);
+                 p.receive_market_catalog_view();
+             }},
+    };
+
+    std::vector<std::pair<const char*, uint64_t>> results;
+    for (const Case& test_case: cases) {
+        uint64_t worst = 0;
+        for (int i = 0; i < WARMUP_ROUNDS + MEASURED_ROUNDS; i++) {
+            test_case.send_request(client);
+            uint64_t allocations = serve();
+            test_case.receive_reply(client);
+            if (i >= WARMUP_ROUNDS) {
+                worst = std::max(worst, allocations);
+            }
+        }
+        results.emplace_back(test_case.name, worst);
+    }
+
+    std::cout.rdbuf(stdout_buffer);
+
+    int failures = 0;
+    std::cout << "Server allocations per request after " << WARMUP_ROUNDS
+              << " warm-up rounds (max of " << MEASURED_ROUNDS << ")" << std::endl;
+    for (const auto& [name, worst]: results) {
+        failures += worst == 0 ? 0 : 1;
+        std::cout << "  " << std::left << std::setw(30) << name << std::right << std::setw(4)
+                  << worst << (worst == 0 ? "" : "  EXPECTED 0") << std::endl;
+    }
+
+    if (failures > 0) {
+        std::cout << failures << " requests allocate in steady state" << std::endl;
+        return 1;
+    }
+    std::cout << "No request allocates in steady state" << std::endl;
+    return 0;
+}
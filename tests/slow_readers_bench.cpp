@@ -0,0 +1,94 @@
+/*
+ * Los clientes rápidos no se frenan por los lentos (véase la cola de
+ * salida de `Protocol` y `OUTPUT_THROTTLE` en el `Server`).
+ *
+ * Con un catálogo de 60k autos (~1.4 MB por respuesta), unos clientes
+ * rápidos piden su auto actual uno tras otro y se mide cuántos pedidos
+ * por segundo completan: primero solos y después con lectores lentos que
+ * piden el catálogo varias veces y nunca leen la respuesta. Con los
+ * lentos se descarta una primera vuelta, en la que el server todavía
+ * atiende sus pedidos: se mide cuando ya tienen la cola llena.
+ * */
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../common_src/common_constants.h"
+#include "../common_src/common_protocol.h"
+#include "../common_src/common_socket.h"
+
+#include "test_bench_server.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t CATALOG_CARS = 60000;
+const size_t FAST_CLIENTS = 8;
+const size_t SLOW_READERS = 4;
+const int CATALOGS_PER_SLOW_READER = 4;
+const Clock::duration PHASE = std::chrono::seconds(1);
+
+std::unique_ptr<Protocol> register_client(const std::string& port) {
+    auto client = std::make_unique<Protocol>(Socket("127.0.0.1", port.c_str()));
+    client->send_user_registration(UserDto("bench"));
+    if (client->receive_command() != SEND_INITIAL_MONEY) {
+        throw std::runtime_error("registration failed");
+    }
+    client->receive_initial_balance();
+    return client;
+}
+
+// Pedidos por segundo que completan los clientes rápidos, de a uno por vez
+double fast_throughput(std::vector<std::unique_ptr<Protocol>>& fast_clients) {
+    size_t completed = 0;
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + PHASE;
+    while (Clock::now() < end) {
+        for (const auto& client: fast_clients) {
+            client->send_current_car_request();
+            if (client->receive_command() != SEND_ERROR_MESSAGE) {
+                throw std::runtime_error("unexpected current car");
+            }
+            client->receive_error_notification();
+            completed++;
+        }
+    }
+    return completed / std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+}  // namespace
+
+int main() {
+    BenchServer server(CATALOG_CARS, 100000);
+
+    std::vector<std::unique_ptr<Protocol>> fast_clients;
+    for (size_t i = 0; i < FAST_CLIENTS; i++) {
+        fast_clients.push_back(register_client(server.get_port()));
+    }
+    double alone = fast_throughput(fast_clients);
+
+    std::vector<std::unique_ptr<Protocol>> slow_readers;
+    for (size_t i = 0; i < SLOW_READERS; i++) {
+        slow_readers.push_back(register_client(server.get_port()));
+        for (int j = 0; j < CATALOGS_PER_SLOW_READER; j++) {
+            slow_readers.back()->send_market_info_request();
+        }
+    }
+    fast_throughput(fast_clients);
+    double with_slow = fast_throughput(fast_clients);
+
+    std::cout << "Fast clients (" << FAST_CLIENTS << ", one request at a time) with a "
+              << CATALOG_CARS << "-car catalog" << std::endl;
+    std::cout << std::fixed << std::setprecision(0) << "  alone                  " << std::setw(8)
+              << alone << " requests/s" << std::endl;
+    std::cout << "  with " << SLOW_READERS << " slow readers     " << std::setw(8) << with_slow
+              << " requests/s (" << std::setprecision(1) << 100 * with_slow / alone << "%)"
+              << std::endl;
+    return 0;
+}
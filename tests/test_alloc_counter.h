@@ -0,0 +1,28 @@
+#ifndef TEST_ALLOC_COUNTER_H
+#define TEST_ALLOC_COUNTER_H
+
+#include <cstdint>
+
+/*
+ * Cuenta las llamadas al `operator new` global de todo el programa.
+ *
+ * Enlazar `test_alloc_counter.o` reemplaza los `operator new`/`delete`
+ * globales (todas sus variantes) por versiones que cuentan y reservan
+ * con `malloc`. Para saber cuánto reservó un tramo de código se toma
+ * `allocations()` antes y después:
+ *
+ *     uint64_t before = AllocCounter::allocations();
+ *     ...
+ *     uint64_t used = AllocCounter::allocations() - before;
+ * */
+namespace AllocCounter {
+
+// `operator new` llamados desde que empezó el programa
+uint64_t allocations();
+
+// Bytes pedidos en esas llamadas
+uint64_t allocated_bytes();
+
+}  // namespace AllocCounter
+
+#endif  // TEST_ALLOC_COUNTER_H
@@ -0,0 +1,157 @@
+#include "test_bench_server.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../common_src/common_socket.h"
+#include "../common_src/liberror.h"
+#include "../server_src/server.h"
+
+static std::string write_market_file(size_t cars, uint32_t money) {
+    char path[] = "/tmp/bench_market_XXXXXX";
+    int fd = ::mkstemp(path);
+    if (fd == -1) {
+        throw LibError(errno, "mkstemp failed");
+    }
+    ::close(fd);
+
+    const char* BRANDS[] = {"Toyota",     "Honda",   "Ford",    "Chevrolet",
+                            "Volkswagen", "Renault", "Peugeot", "Fiat"};
+    std::ofstream file(path);
+    file << "money " << money << "\n";
+    for (size_t i = 0; i < cars; i++) {
+        file << "car " << BRANDS[i % 8] << "Model" << i << " " << 2000 + i % 25 << " "
+             << 10000 + (i * 7919) % 40000 << "\n";
+    }
+    if (!file) {
+        throw std::runtime_error("Failed to write market file");
+    }
+    return path;
+}
+
+// Un puerto que nadie usa: el que elige el sistema para un socket de prueba
+static std::string free_port() {
+    Socket probe("0");
+    struct sockaddr_in address = {};
+    socklen_t address_length = sizeof(address);
+    if (::getsockname(probe.get_fd(), reinterpret_cast<struct sockaddr*>(&address),
+                      &address_length) == -1) {
+        throw LibError(errno, "getsockname failed");
+    }
+    return std::to_string(ntohs(address.sin_port));
+}
+
+BenchServer::BenchServer(size_t cars, uint32_t money):
+        market_file(write_market_file(cars, money)), port(free_port()), pid(-1), console_fd(-1) {
+    int console_pipe[2];
+    if (::pipe(console_pipe) == -1) {
+        throw LibError(errno, "pipe failed");
+    }
+    // Lo que quedó en el buffer no se debe imprimir dos veces
+    std::cout.flush();
+    pid = ::fork();
+    if (pid == -1) {
+        throw LibError(errno, "fork failed");
+    }
+    if (pid == 0) {
+        // La consola es el pipe y la salida se descarta
+        int null_fd = ::open("/dev/null", O_RDWR);
+        ::dup2(console_pipe[0], STDIN_FILENO);
+        ::close(console_pipe[0]);
+        ::close(console_pipe[1]);
+        ::dup2(null_fd, STDOUT_FILENO);
+        ::dup2(null_fd, STDERR_FILENO);
+        ::signal(SIGPIPE, SIG_IGN);
+        try {
+            Server server(port, market_file, true);
+            server.run();
+        } catch (const std::exception&) {
+            ::_exit(1);
+        }
+        ::_exit(0);
+    }
+    ::close(console_pipe[0]);
+    console_fd = console_pipe[1];
+    wait_until_accepting();
+}
+
+void BenchServer::wait_until_accepting() {
+    for (int attempt = 0; attempt < 500; attempt++) {
+        int status;
+        if (::waitpid(pid, &status, WNOHANG) == pid) {
+            pid = -1;
+            throw std::runtime_error("Bench server exited on startup");
+        }
+        try {
+            Socket probe("127.0.0.1", port.c_str());
+            return;
+        } catch (const std::exception&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    throw std::runtime_error("Bench server not accepting connections");
+}
+
+void BenchServer::console(const std::string& command) {
+    std::string line = command + "\n";
+    if (::write(console_fd, line.data(), line.size()) != static_cast<ssize_t>(line.size())) {
+        throw LibError(errno, "console write failed");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+size_t BenchServer::resident_memory() const {
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) {
+            return std::stoul(line.substr(6)) * 1024;  // En kB
+        }
+    }
+    throw std::runtime_error("VmRSS not found");
+}
+
+std::chrono::nanoseconds BenchServer::cpu_time() const {
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    std::getline(stat, line);
+
+    // Los campos que siguen al nombre (que puede tener espacios, entre paréntesis);
+    // utime y stime son el 14 y el 15 de la línea entera
+    std::istringstream fields(line.substr(line.rfind(')') + 2));
+    std::string field;
+    for (int i = 3; i < 14; i++) {
+        fields >> field;
+    }
+    unsigned long long user;
+    unsigned long long system;
+    fields >> user >> system;
+    long ticks_per_second = ::sysconf(_SC_CLK_TCK);
+    return std::chrono::nanoseconds((user + system) * 1000000000ull / ticks_per_second);
+}
+
+BenchServer::~BenchServer() {
+    if (console_fd != -1) {
+        ::close(console_fd);
+    }
+    if (pid > 0) {
+        ::kill(pid, SIGTERM);
+        ::waitpid(pid, nullptr, 0);
+    }
+    ::unlink(market_file.c_str());
+}
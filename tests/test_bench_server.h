@@ -0,0 +1,56 @@
+#ifndef TEST_BENCH_SERVER_H
+#define TEST_BENCH_SERVER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <sys/types.h>
+
+/*
+ * Un `Server` real (modo "multi") corriendo en un proceso hijo, para los
+ * benchmarks que miden al server de punta a punta.
+ *
+ * El catálogo tiene `cars` autos generados ("ToyotaModel0", ...) con
+ * nombres de largo parecido y precios de hasta 50000 pesos. El server
+ * escucha en un puerto libre de loopback (y en memoria compartida con
+ * ese mismo nombre, véase `Socket::connect_shm`); su salida se descarta.
+ * El constructor retorna cuando ya acepta conexiones y el destructor lo
+ * termina. Su consola se maneja con `console`.
+ *
+ * En caso de error se lanza una excepción.
+ * */
+class BenchServer {
+private:
+    std::string market_file;
+    std::string port;
+    pid_t pid;
+    int console_fd;  // Escritura del pipe que el server lee como stdin
+
+    void wait_until_accepting();
+
+public:
+    BenchServer(size_t cars, uint32_t money);
+
+    const std::string& get_port() const { return port; }
+
+    /*
+     * Envía un comando a la consola del server (p. ej. "shed 0 100").
+     * La consola no responde: se espera un momento a que lo aplique.
+     * */
+    void console(const std::string& command);
+
+    // Memoria residente del proceso del server (VmRSS), en bytes
+    size_t resident_memory() const;
+
+    // Tiempo de CPU (usuario más sistema) que consumió el server hasta ahora
+    std::chrono::nanoseconds cpu_time() const;
+
+    ~BenchServer();
+
+    BenchServer(const BenchServer&) = delete;
+    BenchServer& operator=(const BenchServer&) = delete;
+};
+
+#endif  // TEST_BENCH_SERVER_H
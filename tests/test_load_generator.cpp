@@ -0,0 +1,286 @@
+#include "test_load_generator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "../common_src/common_constants.h"
+#include "../common_src/common_socket.h"
+#include "../common_src/liberror.h"
+
+static const size_t READ_SIZE = 1024 * 1024;
+// Tras el plazo, cuánto se espera como mucho por las respuestas pendientes
+static const LoadGenerator::Clock::duration DRAIN_LIMIT = std::chrono::seconds(60);
+
+static uint16_t read_uint16(const uint8_t* data) {
+    uint16_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return ntohs(value);
+}
+
+LoadGenerator::LoadGenerator(const std::string& port, size_t count,
+                             const std::string& car_name):
+        catalog_size(0), read_buffer(READ_SIZE) {
+    purchase_request.push_back(static_cast<char>(BUY_CAR));
+    uint16_t length = htons(static_cast<uint16_t>(car_name.size()));
+    purchase_request.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    purchase_request.append(car_name);
+
+    connections.resize(count);
+    for (Connection& connection: connections) {
+        connection.protocol = std::make_unique<Protocol>(Socket("127.0.0.1", port.c_str()));
+        Protocol& protocol = *connection.protocol;
+        protocol.send_user_registration(UserDto("load"));
+        if (protocol.receive_command() != SEND_INITIAL_MONEY) {
+            throw std::runtime_error("registration failed");
+        }
+        protocol.receive_initial_balance();
+
+        if (catalog_size == 0) {
+            protocol.send_market_info_request();
+            if (protocol.receive_command() != SEND_MARKET_INFO) {
+                throw std::runtime_error("catalog request failed");
+            }
+            // Comando y cantidad; cada auto: uint16 largo + nombre + uint16 año + uint32 precio
+            catalog_size = 1 + sizeof(uint16_t);
+            for (const CarDto& car: protocol.receive_market_catalog().cars) {
+                catalog_size += sizeof(uint16_t) + car.name.size() + 6;
+            }
+        }
+
+        // De acá en más se habla directo por el socket, sin bloquear
+        int one = 1;
+        if (::setsockopt(protocol.get_fd(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) == -1 ||
+            ::fcntl(protocol.get_fd(), F_SETFL, O_NONBLOCK) == -1) {
+            throw LibError(errno, "socket setup failed");
+        }
+        connection.header_size = 0;
+        connection.remaining = 0;
+    }
+}
+
+void LoadGenerator::send(Connection& connection, Request request) {
+    static const char MARKET_REQUEST = GET_MARKET_INFO;
+    const char* data = &MARKET_REQUEST;
+    size_t size = 1;
+    if (request == Request::Purchase) {
+        data = purchase_request.data();
+        size = purchase_request.size();
+    }
+
+    connection.pending.push_back({request, Clock::now()});
+    connection.output.append(data, size);
+    flush(connection);
+}
+
+void LoadGenerator::flush(Connection& connection) {
+    while (!connection.output.empty()) {
+        ssize_t sent = ::send(connection.protocol->get_fd(), connection.output.data(),
+                              connection.output.size(), MSG_NOSIGNAL);
+        if (sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;
+            }
+            throw LibError(errno, "send failed");
+        }
+        connection.output.erase(0, sent);
+    }
+}
+
+size_t LoadGenerator::parse_replies(Connection& connection, const uint8_t* data, size_t size,
+                                    Results& results) {
+    const size_t HEADER_SIZE = sizeof(connection.header);
+    size_t replies = 0;
+    size_t position = 0;
+    while (position < size) {
+        if (connection.header_size < HEADER_SIZE) {
+            size_t taken = std::min(HEADER_SIZE - connection.header_size, size - position);
+            std::memcpy(connection.header + connection.header_size, data + position, taken);
+            connection.header_size += taken;
+            position += taken;
+            if (connection.header_size < HEADER_SIZE) {
+                break;
+            }
+
+            // Un string (el auto o el error); la compra agrega año, precio y saldo
+            uint16_t length = read_uint16(connection.header + 1);
+            switch (connection.header[0]) {
+                case SEND_MARKET_INFO:
+                    connection.remaining = catalog_size - HEADER_SIZE;
+                    break;
+                case SEND_CAR_BOUGHT:
+                    connection.remaining = length + 10;
+                    break;
+                case SEND_ERROR_MESSAGE:
+                    connection.remaining = length;
+                    break;
+                default:
+                    throw std::runtime_error("unexpected reply");
+            }
+        }
+
+        size_t skipped = std::min(connection.remaining, size - position);
+        position += skipped;
+        connection.remaining -= skipped;
+        if (connection.remaining == 0) {
+            complete_reply(connection, results);
+            connection.header_size = 0;
+            replies++;
+        }
+    }
+    return replies;
+}
+
+void LoadGenerator::complete_reply(Connection& connection, Results& results) {
+    if (connection.pending.empty()) {
+        throw std::runtime_error("reply without request");
+    }
+    Pending pending = connection.pending.front();
+    connection.pending.pop_front();
+
+    double latency = std::chrono::duration<double, std::milli>(Clock::now() - pending.sent).count();
+    if (pending.request == Request::Purchase) {
+        results.purchase.push_back(latency);
+    } else if (connection.header[0] == SEND_MARKET_INFO) {
+        results.market.push_back(latency);
+    } else {
+        results.market_busy.push_back(latency);
+    }
+}
+
+size_t LoadGenerator::receive(int timeout_ms, Results& results, std::vector<size_t>& answered) {
+    poll_fds.clear();
+    for (const Connection& connection: connections) {
+        short events = connection.output.empty() ? POLLIN : POLLIN | POLLOUT;
+        poll_fds.push_back({connection.protocol->get_fd(), events, 0});
+    }
+    if (::poll(poll_fds.data(), poll_fds.size(), timeout_ms) == -1 && errno != EINTR) {
+        throw LibError(errno, "poll failed");
+    }
+
+    size_t replies = 0;
+    answered.clear();
+    for (size_t i = 0; i < connections.size(); i++) {
+        if (poll_fds[i].revents == 0) {
+            continue;
+        }
+        if (poll_fds[i].revents & POLLOUT) {
+            flush(connections[i]);
+        }
+        size_t parsed = 0;
+        ssize_t received;
+        while ((received = ::recv(poll_fds[i].fd, read_buffer.data(), read_buffer.size(), 0)) >
+               0) {
+            parsed += parse_replies(connections[i], read_buffer.data(), received, results);
+        }
+        if (received == 0) {
+            throw std::runtime_error("server closed a connection");
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            throw LibError(errno, "recv failed");
+        }
+
+        if (parsed > 0) {
+            answered.push_back(i);
+            replies += parsed;
+        }
+    }
+    return replies;
+}
+
+size_t LoadGenerator::pending_count() const {
+    size_t count = 0;
+    for (const Connection& connection: connections) {
+        count += connection.pending.size();
+    }
+    return count;
+}
+
+void LoadGenerator::drain(Results& results) {
+    std::vector<size_t> answered;
+    Clock::time_point limit = Clock::now() + DRAIN_LIMIT;
+    while (pending_count() > 0) {
+        if (Clock::now() > limit) {
+            throw std::runtime_error("replies still pending after the drain limit");
+        }
+        receive(50, results, answered);
+    }
+}
+
+LoadGenerator::Results LoadGenerator::run_closed(
+        Clock::duration duration, const std::function<Request(size_t connection)>& request_of) {
+    Results results{};
+    results.seconds = std::chrono::duration<double>(duration).count();
+
+    Clock::time_point end = Clock::now() + duration;
+    for (size_t i = 0; i < connections.size(); i++) {
+        send(connections[i], request_of(i));
+    }
+    std::vector<size_t> answered;
+    while (Clock::now() < end) {
+        receive(10, results, answered);
+        if (Clock::now() >= end) {
+            break;
+        }
+        for (size_t i: answered) {
+            if (connections[i].pending.empty()) {
+                send(connections[i], request_of(i));
+            }
+        }
+    }
+    drain(results);
+    return results;
+}
+
+LoadGenerator::Results LoadGenerator::run_open(Clock::duration duration, double rate,
+                                               double purchases) {
+    Results results{};
+    results.seconds = std::chrono::duration<double>(duration).count();
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    auto interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / rate));
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + duration;
+    Clock::time_point next = start;
+    std::vector<size_t> answered;
+    Clock::time_point now;
+    while ((now = Clock::now()) < end) {
+        // Si se atrasó, se ponen al día los pedidos que correspondían
+        while (next <= now) {
+            Request request = uniform(random) < purchases ? Request::Purchase : Request::Market;
+            send(connections[random() % connections.size()], request);
+            next += interval;
+        }
+        receive(1, results, answered);
+    }
+    drain(results);
+    return results;
+}
+
+void LoadGenerator::print_latencies(const char* name, std::vector<double>& latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    auto at = [&](double fraction) {
+        if (latencies.empty()) {
+            return 0.0;
+        }
+        return latencies[static_cast<size_t>(fraction * (latencies.size() - 1))];
+    };
+    std::cout << "  " << std::left << std::setw(14) << name << std::right << std::setw(8)
+              << latencies.size() << " replies" << std::fixed << std::setprecision(2)
+              << "   p50 " << std::setw(8) << at(0.5) << " ms   p99 " << std::setw(8) << at(0.99)
+              << " ms   max " << std::setw(8) << at(1.0) << " ms" << std::endl;
+}
@@ -0,0 +1,112 @@
+#ifndef TEST_LOAD_GENERATOR_H
+#define TEST_LOAD_GENERATOR_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+
+#include "../common_src/common_protocol.h"
+
+/*
+ * Generador de carga para los benchmarks: muchas conexiones TCP ya
+ * registradas contra un server que piden el catálogo o compran un auto
+ * sin bloquearse, y miden cuánto tardó cada respuesta.
+ *
+ *   - En lazo cerrado cada conexión tiene siempre un pedido en curso: al
+ *     llegar la respuesta manda el siguiente.
+ *   - En lazo abierto los pedidos salen a un ritmo fijo, a conexiones al
+ *     azar, llegue o no la respuesta de los anteriores. Si el server deja
+ *     de leer, esperan en la conexión y su espera cuenta.
+ *
+ * Terminado el plazo no se envía nada más, pero se esperan las
+ * respuestas pendientes. Las respuestas se reconocen por su formato en
+ * el cable (catálogo plano, compra o error) sin decodificarlas ni
+ * guardarlas: el catálogo no cambia durante la prueba (las compras no lo
+ * modifican), así que se pide una vez al empezar y después se saltea
+ * por su tamaño. Así el generador gasta poco en cada respuesta y la CPU
+ * queda para el server.
+ * */
+class LoadGenerator {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Request { Market, Purchase };
+
+    // Latencias de las respuestas, en ms
+    struct Results {
+        std::vector<double> market;       // Con el catálogo
+        std::vector<double> market_busy;  // Rechazados con un error (p. ej. por sobrecarga)
+        std::vector<double> purchase;     // Compras, confirmadas o no
+        double seconds;                   // Plazo en el que se enviaron los pedidos
+    };
+
+private:
+    struct Pending {
+        Request request;
+        Clock::time_point sent;
+    };
+
+    /*
+     * Una conexión y la respuesta en curso: primero se juntan el comando
+     * y el largo que le sigue (`header`), y con eso se sabe cuántos bytes
+     * faltan para terminarla (`remaining`).
+     * */
+    struct Connection {
+        std::unique_ptr<Protocol> protocol;
+        std::deque<Pending> pending;
+        std::string output;  // Pedidos que el socket todavía no aceptó
+        uint8_t header[3];
+        size_t header_size;
+        size_t remaining;
+    };
+
+    std::vector<Connection> connections;
+    std::string purchase_request;
+    // Tamaño en el cable de la respuesta con el catálogo, comando incluido
+    size_t catalog_size;
+    std::vector<uint8_t> read_buffer;
+    std::vector<struct pollfd> poll_fds;
+
+    void send(Connection& connection, Request request);
+    void flush(Connection& connection);
+    // Avanza sobre `size` bytes recibidos; retorna cuántas respuestas se completaron
+    size_t parse_replies(Connection& connection, const uint8_t* data, size_t size,
+                         Results& results);
+    void complete_reply(Connection& connection, Results& results);
+    // Espera hasta `timeout_ms` y atiende lo que llegó; retorna las respuestas
+    size_t receive(int timeout_ms, Results& results, std::vector<size_t>& answered);
+    void drain(Results& results);
+    size_t pending_count() const;
+
+public:
+    /*
+     * Abre `count` conexiones a `port` de loopback y registra cada una.
+     * Las compras piden `car_name`.
+     * */
+    LoadGenerator(const std::string& port, size_t count, const std::string& car_name);
+
+    // Lazo cerrado durante `duration`; la conexión i pide siempre `request_of(i)`
+    Results run_closed(Clock::duration duration,
+                       const std::function<Request(size_t connection)>& request_of);
+
+    // Lazo abierto: `rate` pedidos por segundo, una fracción `purchases` de ellos compras
+    Results run_open(Clock::duration duration, double rate, double purchases);
+
+    // Bytes de cada respuesta con el catálogo
+    size_t get_catalog_size() const { return catalog_size; }
+
+    // Imprime cantidad, p50, p99 y máximo de `latencies` (los reordena)
+    static void print_latencies(const char* name, std::vector<double>& latencies);
+
+    LoadGenerator(const LoadGenerator&) = delete;
+    LoadGenerator& operator=(const LoadGenerator&) = delete;
+};
+
+#endif  // TEST_LOAD_GENERATOR_H
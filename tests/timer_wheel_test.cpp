@@ -0,0 +1,287 @@
+/*
+ * Pruebas de la rueda de timers (véase `TimerWheel`).
+ *
+ * El tiempo es virtual: se llama a `advance` con instantes armados a mano
+ * y se salta de un vencimiento al siguiente con `next_timeout_ms`, como
+ * el loop del server. Si la rueda despertara tarde, algún timer vencería
+ * más de un tick después de su plazo.
+ *
+ *   - 100k timers con plazos de todos los niveles, de los que un 10% se
+ *     cancela desde el callback de otro timer y otro 10% se reagenda
+ *     desde su propio callback: cada uno vence las veces que corresponde,
+ *     entre su plazo y a lo sumo un tick después.
+ *   - Los bordes entre niveles (64, 4096 y 2^18 ticks, y ±1) desde
+ *     distintas posiciones de la rueda.
+ *   - Cancelar, reagendar, destruir un timer agendado y reagendarse con
+ *     plazo 0 desde el callback.
+ * */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../server_src/server_timer_wheel.h"
+
+namespace {
+
+using Clock = TimerWheel::Clock;
+
+int failures = 0;
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        std::cout << "  FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+/*
+ * Rueda con reloj virtual en ticks enteros. La rueda toma su origen al
+ * construirse, entre `before` y `after`: tomando la base medio tick
+ * después de `before`, el instante `base + k * TICK` es el tick k.
+ * */
+struct VirtualWheel {
+    Clock::time_point before;
+    TimerWheel wheel;
+    Clock::time_point after;
+    Clock::time_point base;
+    uint64_t tick;
+    uint64_t wakeups;
+
+    VirtualWheel():
+            before(Clock::now()),
+            wheel(),
+            after(Clock::now()),
+            base(before + TimerWheel::TICK / 2),
+            tick(0),
+            wakeups(0) {}
+
+    bool aligned() const { return after - before < TimerWheel::TICK / 2; }
+
+    Clock::time_point now() const { return base + tick * TimerWheel::TICK; }
+
+    // Despierta cuando lo pide la rueda (sin pasar de `limit`) y la avanza
+    void wake(uint64_t limit) {
+        int timeout = wheel.next_timeout_ms(now());
+        auto wait = std::chrono::milliseconds(timeout);
+        uint64_t ticks = (wait + TimerWheel::TICK - Clock::duration(1)) / TimerWheel::TICK;
+        tick = std::min<uint64_t>(tick + std::max<uint64_t>(ticks, 1), limit);
+        wheel.advance(now());
+        wakeups++;
+    }
+
+    void run_until(uint64_t target) {
+        while (tick < target && wheel.size() > 0) {
+            wake(target);
+        }
+        if (tick < target) {
+            tick = target;
+            wheel.advance(now());
+        }
+    }
+
+    // Hasta que venza el último timer
+    void run_until_idle() {
+        while (wheel.size() > 0) {
+            wake(UINT64_MAX);
+        }
+    }
+};
+
+// Un timer con lo que se espera de él
+struct Probe {
+    std::unique_ptr<TimerWheel::Timer> timer;
+    Clock::time_point deadline;
+    int fired = 0;
+    int expected = 1;
+    bool on_time = true;
+};
+
+void expire_probe(VirtualWheel& virtual_wheel, Probe& probe) {
+    probe.fired++;
+    Clock::time_point now = virtual_wheel.now();
+    // Un plazo de 0 (o justo sobre un tick) vence en el tick siguiente
+    if (now < probe.deadline || now - probe.deadline > TimerWheel::TICK) {
+        probe.on_time = false;
+    }
+}
+
+void schedule_probe(VirtualWheel& virtual_wheel, Probe& probe, Clock::duration delay) {
+    probe.deadline = virtual_wheel.now() + delay;
+    virtual_wheel.wheel.schedule(*probe.timer, delay);
+}
+
+void test_many_timers() {
+    const size_t TIMERS = 100000;
+    // Hasta 2^19 ticks: pasa por los cuatro niveles
+    const uint64_t MAX_TICKS = uint64_t(1) << 19;
+
+    VirtualWheel virtual_wheel;
+    check(virtual_wheel.aligned(), "virtual clock aligned with the wheel origin");
+
+    std::mt19937_64 random(1);
+    auto random_delay = [&]() {
+        // Uniforme en el exponente: tantos plazos cortos como largos
+        uint64_t limit = uint64_t(1) << (random() % 20);
+        uint64_t ticks = random() % std::min(limit, MAX_TICKS);
+        return std::chrono::milliseconds(ticks * 10 + random() % 10);
+    };
+
+    std::vector<Probe> probes(TIMERS);
+    std::vector<std::unique_ptr<TimerWheel::Timer>> cancelers;
+    for (size_t i = 0; i < TIMERS; i++) {
+        Probe& probe = probes[i];
+        if (i % 10 == 1) {
+            // Se reagenda una vez desde su propio callback
+            probe.expected = 2;
+            probe.timer = std::make_unique<TimerWheel::Timer>([&, i]() {
+                Probe& self = probes[i];
+                expire_probe(virtual_wheel, self);
+                if (self.fired == 1) {
+                    schedule_probe(virtual_wheel, self, random_delay());
+                }
+            });
+        } else {
+            probe.timer = std::make_unique<TimerWheel::Timer>(
+                    [&, i]() { expire_probe(virtual_wheel, probes[i]); });
+        }
+        Clock::duration delay = random_delay();
+        schedule_probe(virtual_wheel, probe, delay);
+
+        if (i % 10 == 2 && delay >= 2 * TimerWheel::TICK) {
+            // Lo cancela otro timer a mitad de camino
+            probe.expected = 0;
+            cancelers.push_back(std::make_unique<TimerWheel::Timer>(
+                    [&, i]() { virtual_wheel.wheel.cancel(*probes[i].timer); }));
+            virtual_wheel.wheel.schedule(*cancelers.back(), delay / 2 - TimerWheel::TICK);
+        }
+    }
+    check(virtual_wheel.wheel.size() == TIMERS + cancelers.size(), "every timer scheduled");
+
+    std::clock_t cpu_start = std::clock();
+    virtual_wheel.run_until_idle();
+    double cpu = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+    size_t wrong_count = 0;
+    size_t late_or_early = 0;
+    for (const Probe& probe: probes) {
+        wrong_count += probe.fired != probe.expected ? 1 : 0;
+        late_or_early += probe.on_time ? 0 : 1;
+    }
+    check(wrong_count == 0, "every timer fires exactly as often as expected");
+    check(late_or_early == 0, "every timer fires within one tick after its deadline");
+    check(virtual_wheel.wheel.size() == 0, "nothing left scheduled");
+
+    std::cout << "  " << TIMERS << " timers (" << cancelers.size() << " cancelled): "
+              << virtual_wheel.tick << " ticks in " << virtual_wheel.wakeups << " wakeups, "
+              << cpu * 1000 << " ms of CPU" << std::endl;
+    if (wrong_count > 0 || late_or_early > 0) {
+        std::cout << "  " << wrong_count << " fired a wrong number of times, " << late_or_early
+                  << " off their deadline" << std::endl;
+    }
+}
+
+void test_level_boundaries() {
+    const uint64_t BOUNDARIES[] = {64, 4096, uint64_t(1) << 18};
+    // Posición de la rueda al agendar: al principio, a mitad de un slot, justo antes
+    // de dar la vuelta al nivel 0 y en medio de una vuelta del nivel 1
+    const uint64_t STARTS[] = {0, 37, 63, 64 * 5 + 17};
+
+    size_t wrong = 0;
+    size_t cases = 0;
+    for (uint64_t boundary: BOUNDARIES) {
+        for (uint64_t start: STARTS) {
+            for (uint64_t ticks: {boundary - 1, boundary, boundary + 1}) {
+                VirtualWheel virtual_wheel;
+                check(virtual_wheel.aligned(), "virtual clock aligned with the wheel origin");
+                virtual_wheel.run_until(start);
+
+                uint64_t fired_at = 0;
+                int fired = 0;
+                TimerWheel::Timer timer([&]() {
+                    fired++;
+                    fired_at = virtual_wheel.tick;
+                });
+                virtual_wheel.wheel.schedule(timer, ticks * TimerWheel::TICK);
+                virtual_wheel.run_until_idle();
+
+                cases++;
+                if (fired != 1 || fired_at != start + ticks) {
+                    wrong++;
+                    std::cout << "  delay " << ticks << " ticks from tick " << start
+                              << ": fired " << fired << " times, at tick " << fired_at
+                              << std::endl;
+                }
+            }
+        }
+    }
+    check(wrong == 0, "timers at level boundaries fire exactly on their tick");
+    std::cout << "  " << cases << " boundary cases" << std::endl;
+}
+
+void test_cancel_and_reschedule() {
+    VirtualWheel virtual_wheel;
+    TimerWheel& wheel = virtual_wheel.wheel;
+    check(virtual_wheel.aligned(), "virtual clock aligned with the wheel origin");
+
+    int cancelled_fired = 0;
+    TimerWheel::Timer cancelled([&]() { cancelled_fired++; });
+    wheel.schedule(cancelled, std::chrono::seconds(1));
+    wheel.cancel(cancelled);
+    wheel.cancel(cancelled);
+    check(!cancelled.is_scheduled() && wheel.size() == 0, "cancel unschedules (twice is harmless)");
+
+    // Reagendar uno ya agendado lo mueve: vence una sola vez, en el plazo nuevo
+    uint64_t moved_at = 0;
+    int moved_fired = 0;
+    TimerWheel::Timer moved([&]() {
+        moved_fired++;
+        moved_at = virtual_wheel.tick;
+    });
+    wheel.schedule(moved, std::chrono::seconds(5));
+    wheel.schedule(moved, std::chrono::milliseconds(200));
+    check(wheel.size() == 1, "rescheduling does not duplicate a timer");
+
+    // Destruir un timer agendado lo cancela
+    {
+        TimerWheel::Timer destroyed([&]() { cancelled_fired++; });
+        wheel.schedule(destroyed, std::chrono::milliseconds(100));
+    }
+    check(wheel.size() == 1, "destroying a scheduled timer cancels it");
+
+    // Reagendarse con plazo 0 desde el callback vence en el tick siguiente, no en el mismo
+    std::vector<uint64_t> repeats;
+    TimerWheel::Timer repeating([&]() {
+        repeats.push_back(virtual_wheel.tick);
+        if (repeats.size() < 3) {
+            wheel.schedule(repeating, Clock::duration::zero());
+        }
+    });
+    wheel.schedule(repeating, std::chrono::milliseconds(50));
+
+    virtual_wheel.run_until_idle();
+    check(cancelled_fired == 0, "cancelled timers never fire");
+    check(moved_fired == 1 && moved_at == 20, "a moved timer fires once at its new deadline");
+    check(repeats == std::vector<uint64_t>({5, 6, 7}),
+          "a timer rescheduled from its callback fires on the following ticks");
+}
+
+}  // namespace
+
+int main() {
+    std::cout << "Timer wheel" << std::endl;
+    test_many_timers();
+    test_level_boundaries();
+    test_cancel_and_reschedule();
+
+    if (failures > 0) {
+        std::cout << failures << " timer wheel checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All timer wheel checks passed" << std::endl;
+    return 0;
+}
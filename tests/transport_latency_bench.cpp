@@ -0,0 +1,78 @@
+/*
+ * Latencia de ida y vuelta de un pedido chico por memoria compartida
+ * contra TCP de loopback (véase `Socket::connect_shm`).
+ *
+ * Un mismo cliente registrado pide su auto actual uno tras otro (el
+ * server contesta con un error corto) y se mide cuánto tarda cada
+ * respuesta, primero por TCP y después por memoria compartida.
+ * */
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "../common_src/common_constants.h"
+#include "../common_src/common_protocol.h"
+#include "../common_src/common_socket.h"
+
+#include "test_bench_server.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int WARMUP = 1000;
+const int ROUND_TRIPS = 20000;
+
+void round_trip(Protocol& client) {
+    client.send_current_car_request();
+    if (client.receive_command() != SEND_ERROR_MESSAGE) {
+        throw std::runtime_error("unexpected current car");
+    }
+    client.receive_error_notification();
+}
+
+void bench_transport(Socket socket, const char* name) {
+    Protocol client(std::move(socket));
+    client.send_user_registration(UserDto("bench"));
+    if (client.receive_command() != SEND_INITIAL_MONEY) {
+        throw std::runtime_error("registration failed");
+    }
+    client.receive_initial_balance();
+
+    for (int i = 0; i < WARMUP; i++) {
+        round_trip(client);
+    }
+    std::vector<double> latencies;
+    latencies.reserve(ROUND_TRIPS);
+    for (int i = 0; i < ROUND_TRIPS; i++) {
+        Clock::time_point start = Clock::now();
+        round_trip(client);
+        latencies.push_back(
+                std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    double mean = std::accumulate(latencies.begin(), latencies.end(), 0.0) / ROUND_TRIPS;
+    std::cout << "  " << std::left << std::setw(8) << name << std::right << std::fixed
+              << std::setprecision(1) << "p50 " << std::setw(7) << latencies[ROUND_TRIPS / 2]
+              << " us   p99 " << std::setw(7) << latencies[ROUND_TRIPS * 99 / 100]
+              << " us   mean " << std::setw(7) << mean << " us" << std::endl;
+}
+
+}  // namespace
+
+int main() {
+    BenchServer server(3, 100000);
+
+    std::cout << "Round trip of " << ROUND_TRIPS << " small requests, one at a time"
+              << std::endl;
+    bench_transport(Socket("127.0.0.1", server.get_port().c_str()), "tcp");
+    bench_transport(Socket::connect_shm(server.get_port().c_str()), "shm");
+    return 0;
+}